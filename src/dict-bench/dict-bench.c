@@ -0,0 +1,419 @@
+/** @defgroup dict-bench Moduł dict-bench
+	Pomiary wydajności biblioteki dictionary i programu dict-check.
+  */
+/** @file
+  Implementacja programu mierzącego wydajność operacji na słowniku.
+  Dla każdego rozmiaru słownika program w osobnym procesie (żeby szczyt
+  zajętej pamięci dotyczył tylko tego rozmiaru) mierzy czas każdej
+  operacji i wypisuje wiersz raportu z przepustowością, percentylami
+  czasu operacji i szczytem zajętej pamięci.
+  @ingroup dict-bench
+  @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+  @date 2015-08-09
+ */
+
+#include "dictionary.h"
+#include "generator.h"
+#include <fcntl.h>
+#include <locale.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+  Największa liczba mierzonych podpowiedzi dla jednego rozmiaru.
+  */
+#define BENCH_HINTS 10000
+
+/**
+  Liczba powtórzeń zapisu, wczytania i przebiegu dict-check.
+  */
+#define BENCH_REPEATS 5
+
+/**
+  Najmniejsza liczba słów tekstu sprawdzanego przez dict-check.
+  */
+#define BENCH_TEXT_MIN 200000
+
+/**
+  Ustawienia pomiarów.
+  */
+struct bench
+{
+	uint64_t seed; ///< Ziarno generatora.
+	const char *checker; ///< Ścieżka programu dict-check lub NULL.
+	FILE *report; ///< Raport.
+	char dict_name[64]; ///< Plik zapisywanego słownika.
+	char text_name[64]; ///< Plik tekstu dla dict-check.
+};
+
+/** @name Funkcje pomocnicze
+  @{
+ */
+
+/**
+ * Zwraca bieżący czas monotoniczny.
+ * @return Czas w nanosekundach.
+ */
+uint64_t now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t) t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+/**
+ * Porównuje dwie liczby; komparator dla qsort.
+ * @param[in] a Pierwsza liczba.
+ * @param[in] b Druga liczba.
+ * @return <0, 0 lub >0 zgodnie z porządkiem liczb.
+ */
+int compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * Wypisuje wiersz raportu. Przepustowość liczona jest z łącznego czasu
+ * operacji, a percentyle z czasów pojedynczych operacji, które są przy
+ * tym sortowane.
+ * @param[in] bench Ustawienia.
+ * @param[in] op Nazwa operacji.
+ * @param[in] size Liczba słów słownika.
+ * @param[in,out] latency Czasy operacji w nanosekundach.
+ * @param[in] count Liczba operacji.
+ * @param[in] rss Szczyt zajętej pamięci w kilobajtach.
+ */
+void report(const struct bench *bench, const char *op, size_t size,
+			uint64_t *latency, size_t count, long rss)
+{
+	uint64_t total = 0;
+	for (size_t i = 0; i < count; i++)
+		total += latency[i];
+	qsort(latency, count, sizeof(uint64_t), compare_u64);
+	fprintf(bench->report, "%s\t%zu\t%zu\t%.0f\t%llu\t%llu\t%llu\t%llu\t%ld\n",
+			op, size, count, total ? count * 1e9 / total : 0.0,
+			(unsigned long long) latency[count / 2],
+			(unsigned long long) latency[count * 9 / 10],
+			(unsigned long long) latency[count * 99 / 100],
+			(unsigned long long) latency[count - 1], rss);
+}
+
+/**
+ * Zwraca szczyt pamięci zajętej przez proces.
+ * @return Rozmiar w kilobajtach.
+ */
+long peak_rss(void)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+/**
+ * Uruchamia dict-check na tekście i czeka na jego zakończenie.
+ * @param[in] bench Ustawienia.
+ * @param[in] verbose Czy uruchomić z opcją -v.
+ * @param[out] rss Szczyt pamięci zajętej przez dict-check w kilobajtach.
+ * @return Czas działania w nanosekundach lub 0, jeśli się nie powiodło.
+ */
+uint64_t run_checker(const struct bench *bench, int verbose, long *rss)
+{
+	uint64_t start = now();
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		int in = open(bench->text_name, O_RDONLY);
+		int out = open("/dev/null", O_WRONLY);
+		if (in < 0 || out < 0 || dup2(in, 0) < 0 || dup2(out, 1) < 0
+			|| dup2(out, 2) < 0)
+			_exit(127);
+		if (verbose)
+			execl(bench->checker, bench->checker, "-v", bench->dict_name,
+				  (char *) NULL);
+		else
+			execl(bench->checker, bench->checker, bench->dict_name,
+				  (char *) NULL);
+		_exit(127);
+	}
+	int status;
+	struct rusage usage;
+	if (pid < 0 || wait4(pid, &status, 0, &usage) != pid
+		|| !WIFEXITED(status) || WEXITSTATUS(status) == 127)
+		return 0;
+	*rss = usage.ru_maxrss;
+	return now() - start;
+}
+
+/**
+ * Mierzy przebiegi dict-check na tekście ze słów słownika.
+ * Operacją jest jedno słowo tekstu: przepustowość to słowa na sekundę,
+ * a percentyle to czasy przebiegów podzielone przez liczbę słów.
+ * @param[in] bench Ustawienia.
+ * @param[in] words Słowa słownika.
+ * @param[in] size Liczba słów słownika.
+ * @return <0 jeśli operacja się nie powiedzie, 0 w p.p.
+ */
+int bench_checker(const struct bench *bench, wchar_t * const *words,
+				  size_t size)
+{
+	size_t length = size < BENCH_TEXT_MIN ? BENCH_TEXT_MIN : size;
+	FILE *f = fopen(bench->text_name, "w");
+	if (!f || generator_text(bench->seed + 2, words, size, length, f) < 0)
+		return -1;
+	if (fclose(f))
+		return -1;
+	uint64_t latency[BENCH_REPEATS];
+	for (int verbose = 0; verbose <= 1; verbose++)
+	{
+		long rss = 0;
+		for (int r = 0; r < BENCH_REPEATS; r++)
+		{
+			uint64_t t = run_checker(bench, verbose, &rss);
+			if (t == 0)
+				return -1;
+			latency[r] = t / length;
+		}
+		/* Czasy są na słowo, więc przepustowość to słowa na sekundę. */
+		report(bench, verbose ? "check-v" : "check", size, latency,
+			   BENCH_REPEATS, rss);
+	}
+	unlink(bench->text_name);
+	return 0;
+}
+
+/**
+ * Mierzy operacje na słowniku jednego rozmiaru.
+ * @param[in] bench Ustawienia.
+ * @param[in] size Liczba słów słownika.
+ * @return <0 jeśli operacja się nie powiedzie, 0 w p.p.
+ */
+int bench_size(const struct bench *bench, size_t size)
+{
+	wchar_t **words = generator_words(bench->seed, size);
+	wchar_t **misses = generator_words(bench->seed + 1, size);
+	uint64_t *latency = malloc((size > BENCH_REPEATS ? size : BENCH_REPEATS)
+							   * sizeof(uint64_t));
+	struct dictionary *dict = dictionary_new();
+	if (!words || !misses || !latency || !dict)
+		return -1;
+	struct generator g;
+	generator_init(&g, bench->seed + 3);
+
+	for (size_t i = 0; i < size; i++)
+	{
+		uint64_t t = now();
+		dictionary_insert(dict, words[i]);
+		latency[i] = now() - t;
+	}
+	report(bench, "insert", size, latency, size, peak_rss());
+
+	/* Na przemian słowa ze słownika i spoza niego, w losowej kolejności. */
+	for (size_t i = 0; i < size; i++)
+	{
+		const wchar_t *word = i % 2 ? misses[generator_below(&g, size)]
+			: words[generator_below(&g, size)];
+		uint64_t t = now();
+		dictionary_find(dict, word);
+		latency[i] = now() - t;
+	}
+	report(bench, "find", size, latency, size, peak_rss());
+
+	size_t hints = size < BENCH_HINTS ? size : BENCH_HINTS;
+	wchar_t typo[GENERATOR_MAX_WORD + 2];
+	struct word_list list;
+	word_list_init(&list);
+	for (size_t i = 0; i < hints; i++)
+	{
+		generator_misspell(&g, words[generator_below(&g, size)], typo);
+		uint64_t t = now();
+		dictionary_hints_into(dict, typo, &list);
+		latency[i] = now() - t;
+	}
+	word_list_done(&list);
+	report(bench, "hints", size, latency, hints, peak_rss());
+
+	for (size_t i = 0; i < BENCH_REPEATS; i++)
+	{
+		uint64_t t = now();
+		FILE *f = fopen(bench->dict_name, "w");
+		if (!f || dictionary_save(dict, f) || fclose(f))
+			return -1;
+		latency[i] = now() - t;
+	}
+	report(bench, "save", size, latency, BENCH_REPEATS, peak_rss());
+
+	for (size_t i = 0; i < BENCH_REPEATS; i++)
+	{
+		uint64_t t = now();
+		FILE *f = fopen(bench->dict_name, "r");
+		struct dictionary *loaded = f ? dictionary_load(f) : NULL;
+		if (!loaded)
+			return -1;
+		fclose(f);
+		latency[i] = now() - t;
+		dictionary_done(loaded);
+	}
+	report(bench, "load", size, latency, BENCH_REPEATS, peak_rss());
+
+	if (bench->checker && bench_checker(bench, words, size) < 0)
+		return -1;
+	unlink(bench->dict_name);
+
+	/* Usuwanie w innej kolejności niż wstawianie. */
+	for (size_t i = size; i > 1; i--)
+	{
+		size_t j = generator_below(&g, i);
+		wchar_t *word = words[i - 1];
+		words[i - 1] = words[j];
+		words[j] = word;
+	}
+	for (size_t i = 0; i < size; i++)
+	{
+		uint64_t t = now();
+		dictionary_delete(dict, words[i]);
+		latency[i] = now() - t;
+	}
+	report(bench, "delete", size, latency, size, peak_rss());
+
+	dictionary_done(dict);
+	free(latency);
+	generator_words_done(words, size);
+	generator_words_done(misses, size);
+	return 0;
+}
+
+/**
+ * Wypisuje słowa lub tekst z generatora.
+ * @param[in] what "words" lub "text".
+ * @param[in] n Liczba słów.
+ * @param[in] seed Ziarno.
+ * @return <0 jeśli operacja się nie powiedzie, 0 w p.p.
+ */
+int generate(const char *what, size_t n, uint64_t seed)
+{
+	wchar_t **words = generator_words(seed, n);
+	if (!words)
+		return -1;
+	int result = 0;
+	if (strcmp(what, "text") == 0)
+		result = generator_text(seed + 2, words, n, n, stdout);
+	else
+		for (size_t i = 0; i < n; i++)
+		{
+			generator_write(words[i], stdout);
+			putchar('\n');
+		}
+	generator_words_done(words, n);
+	return result || ferror(stdout) ? -1 : 0;
+}
+
+/**@}*/
+
+/**
+ * Funkcja main.
+ * Poprawne wywołanie programu to:
+ * ./dict-bench [-c dict-check] [-o report] [-r seed] [-s size,...]
+ * Program mierzy wstawianie, wyszukiwanie, podpowiedzi, zapis, wczytanie
+ * i usuwanie dla słowników o podanych rozmiarach (domyślnie 10000,
+ * 100000 i 1000000 słów), a z opcją -c także przebiegi programu
+ * dict-check bez i z opcją -v. Raport zapisywany jest w pliku `report`
+ * (domyślnie na standardowe wyjście) w wierszach oddzielonych
+ * tabulacjami, z nagłówkiem: operacja, rozmiar słownika, liczba
+ * operacji, operacje na sekundę, percentyle 50, 90 i 99 oraz najdłuższy
+ * czas operacji w nanosekundach i szczyt zajętej pamięci w kilobajtach.
+ * Dla tego samego ziarna dane są zawsze te same, więc raporty z różnych
+ * wersji programu można porównywać wiersz po wierszu.
+ *
+ * Wywołanie ./dict-bench -g words|text N [-r seed] wypisuje N słów
+ * z generatora, po jednym w wierszu, lub tekst z N słów utworzony z tych
+ * słów tak samo jak tekst dla dict-check.
+ */
+int main(int argc, char *argv[])
+{
+	struct bench bench = { 1, NULL, stdout, "", "" };
+	const char *sizes = "10000,100000,1000000";
+	const char *output = NULL;
+	const char *what = NULL;
+	size_t n = 0;
+	int i;
+	for (i = 1; i + 1 < argc; i += 2)
+		if (strcmp(argv[i], "-c") == 0)
+			bench.checker = argv[i + 1];
+		else if (strcmp(argv[i], "-o") == 0)
+			output = argv[i + 1];
+		else if (strcmp(argv[i], "-r") == 0)
+			bench.seed = strtoull(argv[i + 1], NULL, 10);
+		else if (strcmp(argv[i], "-s") == 0)
+			sizes = argv[i + 1];
+		else if (strcmp(argv[i], "-g") == 0 && i + 2 < argc)
+		{
+			what = argv[i + 1];
+			n = strtoull(argv[i + 2], NULL, 10);
+			i++;
+		}
+		else
+			break;
+	if (i != argc || (what && strcmp(what, "words") && strcmp(what, "text")))
+	{
+		printf("usage: %s [-c dict-check] [-o report] [-r seed] "
+			   "[-s size,...]\n"
+			   "       %s -g words|text N [-r seed]\n", argv[0], argv[0]);
+		return 0;
+	}
+	setlocale(LC_ALL, "pl_PL.UTF-8");
+	if (what)
+	{
+		if (generate(what, n, bench.seed) < 0)
+		{
+			fprintf(stderr, "Failed to generate %s\n", what);
+			exit(1);
+		}
+		return 0;
+	}
+	if (output && !(bench.report = fopen(output, "w")))
+	{
+		fprintf(stderr, "Failed to open report\n");
+		exit(1);
+	}
+	sprintf(bench.dict_name, "dict-bench-%d.dict", (int) getpid());
+	sprintf(bench.text_name, "dict-bench-%d.txt", (int) getpid());
+	fprintf(bench.report, "op\tsize\tcount\tops_per_s\tp50_ns\tp90_ns"
+			"\tp99_ns\tmax_ns\tpeak_rss_kb\n");
+	for (const char *s = sizes; *s; s += strspn(s, ","))
+	{
+		char *end;
+		size_t size = strtoull(s, &end, 10);
+		if (end == s || size == 0)
+			break;
+		s = end;
+		fflush(bench.report);
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			int result = bench_size(&bench, size);
+			fflush(bench.report);
+			_exit(result < 0 ? 1 : 0);
+		}
+		int status;
+		if (pid < 0 || waitpid(pid, &status, 0) != pid
+			|| !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			unlink(bench.dict_name);
+			unlink(bench.text_name);
+			fprintf(stderr, "Failed to measure size %zu\n", size);
+			exit(1);
+		}
+	}
+	if (output)
+		fclose(bench.report);
+	return 0;
+}
@@ -0,0 +1,261 @@
+/** @file
+  Implementacja generatora danych testowych dla dict-bench.
+
+  @ingroup dict-bench
+  @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+  @date 2015-08-09
+ */
+
+#include "generator.h"
+#include "dictionary.h"
+#include "utf8.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+  Liczba elementów tablicy.
+  */
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+/**
+  Nagłosy sylab; powtórzenia zwiększają częstość.
+  */
+static const wchar_t *onsets[] =
+{
+	L"", L"", L"b", L"c", L"ch", L"cz", L"d", L"dz", L"g", L"j", L"k",
+	L"k", L"l", L"ł", L"m", L"m", L"n", L"n", L"p", L"p", L"r", L"rz",
+	L"s", L"sz", L"ś", L"t", L"t", L"w", L"w", L"z", L"ż", L"ź", L"ć",
+	L"pr", L"kr", L"gr", L"tr", L"pl", L"sk", L"st", L"wr", L"dr", L"f",
+	L"h", L"ń"
+};
+
+/**
+  Samogłoski sylab; powtórzenia zwiększają częstość.
+  */
+static const wchar_t *nuclei[] =
+{
+	L"a", L"a", L"a", L"e", L"e", L"i", L"i", L"o", L"o", L"o", L"u",
+	L"y", L"y", L"ą", L"ę", L"ó", L"ia", L"ie", L"io"
+};
+
+/**
+  Wygłosy sylab.
+  */
+static const wchar_t *codas[] =
+{
+	L"n", L"m", L"r", L"s", L"ł", L"j", L"k", L"st", L"ść", L"ń"
+};
+
+/**
+  Końcówki fleksyjne.
+  */
+static const wchar_t *suffixes[] =
+{
+	L"ami", L"ach", L"ego", L"emu", L"owie", L"ski", L"ska", L"skiego",
+	L"ek", L"ów", L"ość", L"ić", L"ać", L"ował", L"owa", L"nie", L"ją",
+	L"cie", L"iem", L"om"
+};
+
+/**
+  Litery wstawiane i zamieniane w literówkach.
+  */
+static const wchar_t letters[] = L"aąbcćdeęfghijklłmnńoóprsśtuwyzźż";
+
+/** @name Funkcje pomocnicze
+  @{
+ */
+
+/**
+ * Losuje liczbę 64-bitową (SplitMix64).
+ * @param[in,out] g Generator.
+ * @return Liczba.
+ */
+static uint64_t next(struct generator *g)
+{
+	uint64_t z = (g->state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+/**
+ * Dokleja napis do słowa, jeśli się zmieści.
+ * @param[in,out] word Słowo.
+ * @param[in,out] len Długość słowa.
+ * @param[in] part Napis.
+ */
+static void append(wchar_t *word, size_t *len, const wchar_t *part)
+{
+	size_t n = wcslen(part);
+	if (*len + n > GENERATOR_MAX_WORD)
+		return;
+	wmemcpy(word + *len, part, n);
+	*len += n;
+	word[*len] = L'\0';
+}
+
+/**
+ * Zapisuje słowo w UTF-8.
+ * @param[in] word Słowo.
+ * @param[in] capital Czy zacząć wielką literą (tylko litery ASCII).
+ * @param[in,out] out Strumień.
+ */
+static void write_word(const wchar_t *word, int capital, FILE *out)
+{
+	char buffer[(GENERATOR_MAX_WORD + 2) * UTF8_MAX];
+	size_t len = 0;
+	for (const wchar_t *w = word; *w; w++)
+		len += utf8_encode(w == word && capital && *w >= L'a' && *w <= L'z'
+						   ? *w - L'a' + L'A' : *w, buffer + len);
+	fwrite(buffer, 1, len, out);
+}
+
+/**@}*/
+/** @name Elementy interfejsu
+  @{
+ */
+
+void generator_write(const wchar_t *word, FILE *out)
+{
+	write_word(word, 0, out);
+}
+
+void generator_init(struct generator *g, uint64_t seed)
+{
+	g->state = seed;
+}
+
+uint64_t generator_below(struct generator *g, uint64_t n)
+{
+	return next(g) % n;
+}
+
+void generator_word(struct generator *g, wchar_t *word)
+{
+	size_t len = 0;
+	word[0] = L'\0';
+	int syllables = 1 + generator_below(g, 3);
+	for (int i = 0; i < syllables; i++)
+	{
+		append(word, &len, onsets[generator_below(g, COUNT(onsets))]);
+		append(word, &len, nuclei[generator_below(g, COUNT(nuclei))]);
+		if (generator_below(g, 4) == 0)
+			append(word, &len, codas[generator_below(g, COUNT(codas))]);
+	}
+	if (generator_below(g, 2) == 0)
+		append(word, &len, suffixes[generator_below(g, COUNT(suffixes))]);
+}
+
+void generator_misspell(struct generator *g, const wchar_t *word,
+						wchar_t *out)
+{
+	size_t len = wcslen(word);
+	size_t at = generator_below(g, len + 1);
+	wchar_t letter = letters[generator_below(g, COUNT(letters) - 1)];
+	int edit = len > 1 ? generator_below(g, 3) : 0;
+	if (edit == 0)
+	{
+		/* Wstawienie litery. */
+		wmemcpy(out, word, at);
+		out[at] = letter;
+		wcscpy(out + at + 1, word + at);
+		return;
+	}
+	if (at == len)
+		at--;
+	wcscpy(out, word);
+	if (edit == 1)
+		/* Usunięcie litery. */
+		wcscpy(out + at, word + at + 1);
+	else
+		/* Zamiana litery na inną. */
+		out[at] = letter != word[at] ? letter
+			: letters[(wcschr(letters, letter) - letters + 1)
+					  % (COUNT(letters) - 1)];
+}
+
+wchar_t ** generator_words(uint64_t seed, size_t n)
+{
+	wchar_t **words = calloc(n ? n : 1, sizeof(wchar_t *));
+	struct dictionary *seen = dictionary_new();
+	if (words == NULL || seen == NULL)
+	{
+		free(words);
+		dictionary_done(seen);
+		return NULL;
+	}
+	struct generator g;
+	generator_init(&g, seed);
+	wchar_t word[GENERATOR_MAX_WORD + 1];
+	for (size_t i = 0; i < n; )
+	{
+		generator_word(&g, word);
+		int inserted = dictionary_insert(seen, word);
+		if (inserted < 0)
+		{
+			generator_words_done(words, i);
+			dictionary_done(seen);
+			return NULL;
+		}
+		if (inserted == 0)
+			continue;
+		size_t size = (wcslen(word) + 1) * sizeof(wchar_t);
+		if ((words[i] = malloc(size)) == NULL)
+		{
+			generator_words_done(words, i);
+			dictionary_done(seen);
+			return NULL;
+		}
+		memcpy(words[i++], word, size);
+	}
+	dictionary_done(seen);
+	return words;
+}
+
+void generator_words_done(wchar_t **words, size_t n)
+{
+	if (words == NULL)
+		return;
+	for (size_t i = 0; i < n; i++)
+		free(words[i]);
+	free(words);
+}
+
+int generator_text(uint64_t seed, wchar_t * const *words, size_t n,
+				   size_t length, FILE *out)
+{
+	struct generator g;
+	generator_init(&g, seed);
+	wchar_t typo[GENERATOR_MAX_WORD + 2];
+	int capital = 1;
+	for (size_t i = 0; i < length; i++)
+	{
+		/* Słowa z początku listy są najczęstsze. */
+		const wchar_t *word =
+			words[generator_below(&g, generator_below(&g, n) + 1)];
+		if (generator_below(&g, 20) == 0)
+		{
+			generator_misspell(&g, word, typo);
+			word = typo;
+		}
+		write_word(word, capital, out);
+		capital = 0;
+		uint64_t r = generator_below(&g, 120);
+		if (i + 1 == length)
+			fputs(".\n", out);
+		else if (r < 10)
+		{
+			fputs(". ", out);
+			capital = 1;
+		}
+		else if (r < 22)
+			fputs(", ", out);
+		else if (i % 12 == 11)
+			putc('\n', out);
+		else
+			putc(' ', out);
+	}
+	return ferror(out) ? -1 : 0;
+}
+
+/**@}*/
@@ -0,0 +1,104 @@
+/** @file
+    Interfejs generatora danych testowych dla dict-bench.
+
+    Generator tworzy słowa złożone z polskich sylab i końcówek fleksyjnych,
+    z polskimi znakami diakrytycznymi, oraz teksty z tych słów z literówkami.
+    Dla tego samego ziarna wynik jest zawsze taki sam, niezależnie od
+    platformy i locale.
+
+    @ingroup dict-bench
+    @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+    @date 2015-08-09
+ */
+
+#ifndef __GENERATOR_H__
+#define __GENERATOR_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <wchar.h>
+
+/**
+  Maksymalna długość generowanego słowa bez kończącego znaku '\0'.
+  */
+#define GENERATOR_MAX_WORD 31
+
+/**
+  Stan generatora liczb pseudolosowych.
+  */
+struct generator
+{
+    uint64_t state; ///< Stan.
+};
+
+/**
+  Inicjuje generator.
+  @param[out] g Generator.
+  @param[in] seed Ziarno.
+  */
+void generator_init(struct generator *g, uint64_t seed);
+
+/**
+  Losuje liczbę.
+  @param[in,out] g Generator.
+  @param[in] n Górne ograniczenie, n > 0.
+  @return Liczba z przedziału [0, n).
+  */
+uint64_t generator_below(struct generator *g, uint64_t n);
+
+/**
+  Losuje słowo.
+  @param[in,out] g Generator.
+  @param[out] word Bufor na co najmniej GENERATOR_MAX_WORD + 1 znaków.
+  */
+void generator_word(struct generator *g, wchar_t *word);
+
+/**
+  Tworzy słowo różniące się od danego jedną literą: wstawioną, usuniętą
+  lub zamienioną, czyli takie, dla którego słowo może być podpowiedzią.
+  @param[in,out] g Generator.
+  @param[in] word Słowo.
+  @param[out] out Bufor na co najmniej GENERATOR_MAX_WORD + 2 znaków.
+  */
+void generator_misspell(struct generator *g, const wchar_t *word,
+                        wchar_t *out);
+
+/**
+  Tworzy listę różnych słów.
+  Listę należy zniszczyć za pomocą generator_words_done().
+  @param[in] seed Ziarno.
+  @param[in] n Liczba słów.
+  @return Tablica słów lub NULL, jeśli zabrakło pamięci.
+  */
+wchar_t ** generator_words(uint64_t seed, size_t n);
+
+/**
+  Niszczy listę słów.
+  @param[in] words Tablica słów lub NULL.
+  @param[in] n Liczba słów.
+  */
+void generator_words_done(wchar_t **words, size_t n);
+
+/**
+  Zapisuje słowo w UTF-8.
+  @param[in] word Słowo.
+  @param[in,out] out Strumień.
+  */
+void generator_write(const wchar_t *word, FILE *out);
+
+/**
+  Zapisuje w UTF-8 tekst ze słów listy: częstość słów maleje z ich
+  numerem na liście, co dwudzieste słowo ma literówkę, część słów
+  zaczyna się wielką literą, a słowa rozdzielone są spacjami,
+  znakami interpunkcyjnymi i końcami wierszy.
+  @param[in] seed Ziarno.
+  @param[in] words Tablica słów.
+  @param[in] n Liczba słów w tablicy.
+  @param[in] length Liczba słów tekstu.
+  @param[in,out] out Strumień.
+  @return <0 jeśli operacja się nie powiedzie, 0 w p.p.
+  */
+int generator_text(uint64_t seed, wchar_t * const *words, size_t n,
+                   size_t length, FILE *out);
+
+#endif /* __GENERATOR_H__ */
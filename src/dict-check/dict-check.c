@@ -9,162 +9,561 @@
  */
 
 #include "dictionary.h"
+#include "hint_cache.h"
+#include "journal.h"
+#include "tokenizer.h"
+#include <pthread.h>
 #include <string.h>
 #include <locale.h>
-#include <wctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-/** Maksymalna długość słowa.
-	Maksymalna długość słowa bez kończącego znaku '\0'
+/** Liczba słów, dla których pamiętane są podpowiedzi.
   */
-#define MAX_WORD_LENGTH 63
+#define HINT_CACHE_SIZE 4096
+
+/** Największa liczba słów sprawdzanych w słowniku jedną partią.
+  */
+#define CHECK_BATCH 1024
+
+/**
+  Słowo czekające w partii na sprawdzenie.
+  Położenia zapisane są jako przesunięcia, bo bufory partii mogą być
+  przenoszone przy powiększaniu.
+  */
+struct batch_word
+{
+	size_t text; ///< Początek słowa w buforze tekstu.
+	size_t wide; ///< Początek oryginalnej postaci słowa w buforze liter.
+	size_t lower; ///< Początek słowa małymi literami w buforze liter.
+	int line; ///< Wiersz słowa.
+	int column; ///< Numer pierwszej litery słowa w wierszu.
+};
+
+/**
+  Partia fragmentów wejścia zebranych do sprawdzenia.
+  Tekst zbierany jest od pierwszego słowa partii, a słowa sprawdzane są
+  naraz przez dictionary_find_batch().
+  */
+struct check_batch
+{
+	char *text; ///< Bajty zebranych fragmentów.
+	size_t text_size; ///< Liczba bajtów fragmentów.
+	size_t text_capacity; ///< Rozmiar bufora tekstu.
+	wchar_t *letters; ///< Słowa partii, zakończone L'\0'.
+	size_t letters_size; ///< Liczba zajętych znaków bufora liter.
+	size_t letters_capacity; ///< Rozmiar bufora liter.
+	struct batch_word *words; ///< Słowa partii.
+	const wchar_t **lower; ///< Słowa małymi literami, do wyszukania.
+	bool *found; ///< Wyniki wyszukiwania.
+	size_t size; ///< Liczba słów partii.
+	bool keep_wide; ///< Czy zachować też oryginalną postać słów.
+	struct word_list hints; ///< Lista podpowiedzi, używana ponownie.
+};
+
+/**
+  Sprawdzenie jednego pliku w trybie wielowątkowym.
+  Wynik trzymany jest w pamięci, dopóki nie zostaną wypisane wyniki
+  wszystkich wcześniejszych plików.
+  */
+struct check_job
+{
+	const char *path; ///< Ścieżka do pliku.
+	char *out; ///< Sprawdzony tekst.
+	size_t out_size; ///< Długość sprawdzonego tekstu.
+	char *err; ///< Podpowiedzi i komunikaty o błędach.
+	size_t err_size; ///< Długość podpowiedzi i komunikatów.
+	int failed; ///< Czy pliku nie udało się otworzyć.
+	int done; ///< Czy sprawdzanie pliku się zakończyło.
+};
+
+/**
+  Kolejka zadań jednego wątku: przedział numerów plików.
+  Wątek bierze zadania od początku swojej kolejki, a wątki, którym
+  skończyła się praca, kradną je od końca.
+  */
+struct work_queue
+{
+	pthread_mutex_t lock; ///< Blokada kolejki.
+	size_t begin; ///< Pierwsze niewzięte zadanie.
+	size_t end; ///< Koniec niewziętych zadań.
+};
+
+/**
+  Pula wątków sprawdzających pliki.
+  Słownik jest współdzielony przez wszystkie wątki tylko do odczytu.
+  */
+struct work_pool
+{
+	struct dictionary *dict; ///< Słownik.
+	int v; ///< Czy wypisywać podpowiedzi.
+	struct check_job *jobs; ///< Zadania.
+	struct work_queue *queues; ///< Kolejki kolejnych wątków.
+	int thread_count; ///< Liczba wątków.
+	pthread_mutex_t lock; ///< Blokada pól 'done' zadań.
+	pthread_cond_t finished; ///< Sygnalizowana po zakończeniu zadania.
+};
+
+/**
+  Argument wątku puli.
+  */
+struct worker
+{
+	struct work_pool *pool; ///< Pula.
+	int id; ///< Numer wątku i jego kolejki.
+};
 
 /** @name Funkcje pomocnicze
   @{
  */
 
-/** Zamienia słowo na złożone z małych liter.
-  @param[in,out] word Modyfikowane słowo.
-  @return 0, jeśli słowo nie jest złożone z samych liter, 1 w p.p.
- */
-int make_lowercase(wchar_t *word)
-{
-	for (wchar_t *w = word; *w; ++w)
-		if (!iswalpha(*w))
-			return 0;
-		else
-			*w = towlower(*w);
-	return 1;
-}
-
 /**
- * Wypisuje na stderr podpowiedzi dla słowa 'word'.
+ * Wypisuje do 'err' podpowiedzi dla słowa 'word'.
+ * Powtarzające się słowa obsługiwane są z pamięci podręcznej 'cache'.
  * @param[in] dict Słownik.
+ * @param[in,out] cache Pamięć podręczna podpowiedzi.
+ * @param[in,out] list Lista na podpowiedzi.
+ * @param[in,out] err Strumień na podpowiedzi.
  * @param[in] w Wiersz.
  * @param[in] z Znak.
  * @param[in] word Słowo.
  * @param[in] word_lower_case Słowo wyłącznie małymi literami.
  */
-void write_hints(struct dictionary *dict, int w, int z, wchar_t *word,
-				 wchar_t *word_lower_case)
+void write_hints(struct dictionary *dict, struct hint_cache *cache,
+				 struct word_list *list, FILE *err, int w, int z,
+				 const wchar_t *word, const wchar_t *word_lower_case)
 {
-	struct word_list list;
-	dictionary_hints(dict, word_lower_case, &list);
-	const wchar_t * const *a = word_list_get(&list);
-	fprintf(stderr, "%d,%d %ls: ", w, z, word);
-	for (size_t i = 0; i < word_list_size(&list); ++i)
+	hint_cache_hints_into(cache, dict, word_lower_case, list);
+	const wchar_t * const *a = word_list_get(list);
+	fprintf(err, "%d,%d %ls: ", w, z, word);
+	for (size_t i = 0; i < word_list_size(list); ++i)
 	{
 		if (i)
-			fprintf(stderr, " ");
-		fprintf(stderr, "%ls", a[i]);
+			fprintf(err, " ");
+		fprintf(err, "%ls", a[i]);
 	}
-	fprintf(stderr, "\n");
-	word_list_done(&list);
+	fprintf(err, "\n");
 }
 
 /**
- * Przetwarza stdin.
- * Wczytywany jeden znak wejścia. Jeśli nie jest literą, zostaje przepisany
- * na stdin. W p.p. zostają wczytywane znaki dopóki są literami. Utworzone przez
- * nie słowo przepisywane jest na stdin, z dopisanym na początku '#' jeśli słowo
- * to nie występuje w słowniku 'dict'.
- * @param[in] dict Słownik.
- * @param[in] v Należy wpisać 0, jeśli program uruchomiony z parametrem -v.
- * @param[in] w Aktualny wiersz.
- * @param[in] z Aktualny numer znaku.
- * @return 0 jeśli EOF, 1 w p.p.
+ * Inicjuje pustą partię.
+ * @param[out] batch Partia.
+ * @param[in] keep_wide Czy zachowywać oryginalną postać słów, potrzebną
+ * tylko do podpowiedzi.
+ * @return 0 jeśli się udało, -1 jeśli zabrakło pamięci.
  */
-int read(struct dictionary *dict, int v, int *w, int *z)
+int batch_init(struct check_batch *batch, bool keep_wide)
 {
-	wchar_t c[2] = L"";
-	if (fgetws (c, 2, stdin) == NULL)
+	batch->keep_wide = keep_wide;
+	batch->text = NULL;
+	batch->text_size = batch->text_capacity = 0;
+	batch->letters = NULL;
+	batch->letters_size = batch->letters_capacity = 0;
+	batch->size = 0;
+	word_list_init(&batch->hints);
+	batch->words = malloc(CHECK_BATCH * sizeof(struct batch_word));
+	batch->lower = malloc(CHECK_BATCH * sizeof(const wchar_t *));
+	batch->found = malloc(CHECK_BATCH * sizeof(bool));
+	if (!batch->words || !batch->lower || !batch->found)
+		return -1;
+	return 0;
+}
+
+/**
+ * Zwalnia pamięć partii.
+ * @param[in,out] batch Partia.
+ */
+void batch_done(struct check_batch *batch)
+{
+	free(batch->text);
+	free(batch->letters);
+	free(batch->words);
+	free(batch->lower);
+	free(batch->found);
+	word_list_done(&batch->hints);
+}
+
+/**
+ * Zapewnia miejsce na 'size' elementów w buforze, powiększając go
+ * geometrycznie.
+ * @param[in,out] buffer Bufor.
+ * @param[in,out] capacity Rozmiar bufora w elementach.
+ * @param[in] size Potrzebna liczba elementów.
+ * @param[in] element Rozmiar elementu.
+ * @return 0 jeśli się udało, -1 jeśli zabrakło pamięci.
+ */
+int batch_reserve(void **buffer, size_t *capacity, size_t size,
+				  size_t element)
+{
+	if (size <= *capacity)
 		return 0;
-	(*z)++;
-	if (c[0] == L'\n')
+	size_t new_capacity = 2 * size + 4096;
+	void *new_buffer = realloc(*buffer, new_capacity * element);
+	if (!new_buffer)
+		return -1;
+	*buffer = new_buffer;
+	*capacity = new_capacity;
+	return 0;
+}
+
+/**
+ * Dopisuje fragment wejścia do partii.
+ * @param[in,out] batch Partia.
+ * @param[in] token Fragment.
+ * @return 0 jeśli się udało, -1 jeśli zabrakło pamięci.
+ */
+int batch_add(struct check_batch *batch, const struct token *token)
+{
+	if (batch_reserve((void **) &batch->text, &batch->text_capacity,
+					  batch->text_size + token->len, 1))
+		return -1;
+	if (token->word)
 	{
-		(*w)++;
-		*z = 0;
+		size_t len = token->length + 1;
+		size_t total = batch->keep_wide ? 2 * len : len;
+		if (batch_reserve((void **) &batch->letters, &batch->letters_capacity,
+						  batch->letters_size + total, sizeof(wchar_t)))
+			return -1;
+		struct batch_word *word = &batch->words[batch->size++];
+		word->text = batch->text_size;
+		word->lower = batch->letters_size;
+		word->wide = batch->letters_size + len;
+		word->line = token->line;
+		word->column = token->column;
+		wmemcpy(batch->letters + word->lower, token->lower, len);
+		if (batch->keep_wide)
+			wmemcpy(batch->letters + word->wide, token->wide, len);
+		batch->letters_size += total;
 	}
-	if (!iswalpha(c[0])) {
-		printf("%ls", c);
+	memcpy(batch->text + batch->text_size, token->text, token->len);
+	batch->text_size += token->len;
+	return 0;
+}
+
+/**
+ * Sprawdza słowa partii i wypisuje zebrane fragmenty, a następnie
+ * opróżnia partię.
+ * @param[in,out] batch Partia.
+ * @param[in] dict Słownik.
+ * @param[in,out] cache Pamięć podręczna podpowiedzi.
+ * @param[in,out] out Strumień na sprawdzony tekst.
+ * @param[in,out] err Strumień na podpowiedzi.
+ * @param[in] v Czy wypisywać podpowiedzi.
+ */
+void batch_flush(struct check_batch *batch, struct dictionary *dict,
+				 struct hint_cache *cache, FILE *out, FILE *err, int v)
+{
+	for (size_t i = 0; i < batch->size; i++)
+		batch->lower[i] = batch->letters + batch->words[i].lower;
+	dictionary_find_batch(dict, batch->lower, batch->size, batch->found);
+	size_t written = 0;
+	for (size_t i = 0; i < batch->size; i++)
+	{
+		struct batch_word *word = &batch->words[i];
+		if (batch->found[i])
+			continue;
+		fwrite(batch->text + written, 1, word->text - written, out);
+		written = word->text;
+		putc('#', out);
+		if (v)
+			write_hints(dict, cache, &batch->hints, err, word->line,
+						word->column, batch->letters + word->wide,
+						batch->lower[i]);
 	}
-	else
+	fwrite(batch->text + written, 1, batch->text_size - written, out);
+	batch->text_size = 0;
+	batch->letters_size = 0;
+	batch->size = 0;
+}
+
+/**
+ * Przetwarza strumień 'in'.
+ * Znaki niebędące literami przepisywane są na 'out'. Słowa, czyli ciągi
+ * liter, przepisywane są na 'out' z dopisanym na początku '#', jeśli
+ * słowo nie występuje w słowniku 'dict'. Słowo, po którym kończy się
+ * wejście, nie jest przepisywane.
+ * Słowa sprawdzane są w słowniku partiami po co najwyżej CHECK_BATCH,
+ * a tekst od pierwszego słowa partii czeka na wypisanie do jej
+ * sprawdzenia.
+ * @param[in] dict Słownik.
+ * @param[in,out] cache Pamięć podręczna podpowiedzi.
+ * @param[in,out] in Strumień wejściowy.
+ * @param[in,out] out Strumień na sprawdzony tekst.
+ * @param[in,out] err Strumień na podpowiedzi.
+ * @param[in] v Należy wpisać 1, jeśli program uruchomiony z parametrem -v.
+ * @return 0 jeśli się udało, -1 jeśli zabrakło pamięci.
+ */
+int check_stream(struct dictionary *dict, struct hint_cache *cache, FILE *in,
+				 FILE *out, FILE *err, int v)
+{
+	struct tokenizer tokenizer;
+	struct check_batch batch;
+	if (batch_init(&batch, v) || !tokenizer_init(&tokenizer, in))
 	{
-		wchar_t word[MAX_WORD_LENGTH + 1] = L"";
-		wcscat(word, c);
-		while (iswalpha(c[0]))
-		{
-			if (fgetws (c, 2, stdin) == NULL)
-				return 0;
-			if (iswalpha(c[0]))
-				wcscat(word, c);
-		}
-		wchar_t word_lower_case[MAX_WORD_LENGTH + 1];
-		wcscpy(word_lower_case, word);
-		word_lower_case[wcslen(word) + 1] = L'\0';
-		make_lowercase(word_lower_case);
-		if (dictionary_find(dict, word_lower_case))
-		{
-			printf("%ls", word);
-		}
-		else
+		batch_done(&batch);
+		return -1;
+	}
+	int status = 0;
+	struct token token;
+	/* Fragmenty przed pierwszym słowem partii nie muszą czekać. */
+	while (tokenizer_next(&tokenizer, &token))
+	{
+		if (!token.word && batch.size == 0)
+			fwrite(token.text, 1, token.len, out);
+		else if (batch_add(&batch, &token))
 		{
-			printf("#%ls", word);
-			if (v)
-				write_hints(dict, *w, *z, word, word_lower_case);
+			status = -1;
+			break;
 		}
-		if (c[0] == L'\n')
+		if (batch.size == CHECK_BATCH
+			|| batch.text_size >= TOKENIZER_BLOCK_SIZE)
+			batch_flush(&batch, dict, cache, out, err, v);
+	}
+	batch_flush(&batch, dict, cache, out, err, v);
+	tokenizer_done(&tokenizer);
+	batch_done(&batch);
+	return status;
+}
+
+/**
+ * Bierze zadanie z własnej kolejki wątku, a gdy ta jest pusta, kradnie
+ * zadanie z końca kolejki innego wątku.
+ * @param[in,out] pool Pula.
+ * @param[in] id Numer wątku.
+ * @param[out] job Numer wziętego zadania.
+ * @return 0 jeśli nie zostało już żadne zadanie, 1 w p.p.
+ */
+int take_job(struct work_pool *pool, int id, size_t *job)
+{
+	for (int k = 0; k < pool->thread_count; k++)
+	{
+		struct work_queue *queue = &pool->queues[(id + k) % pool->thread_count];
+		pthread_mutex_lock(&queue->lock);
+		int found = queue->begin < queue->end;
+		if (found)
+			*job = k == 0 ? queue->begin++ : --queue->end;
+		pthread_mutex_unlock(&queue->lock);
+		if (found)
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * Sprawdza jeden plik, zapisując wynik w pamięci.
+ * @param[in] pool Pula.
+ * @param[in,out] cache Pamięć podręczna podpowiedzi wątku.
+ * @param[in,out] job Zadanie.
+ */
+void check_file(struct work_pool *pool, struct hint_cache *cache,
+				struct check_job *job)
+{
+	FILE *out = open_memstream(&job->out, &job->out_size);
+	FILE *err = open_memstream(&job->err, &job->err_size);
+	if (!out || !err)
+	{
+		fprintf(stderr, "Failed to allocate output buffer\n");
+		exit(1);
+	}
+	FILE *in = fopen(job->path, "r");
+	if (in)
+	{
+		if (check_stream(pool->dict, cache, in, out, err, pool->v))
 		{
-			(*w)++;
-			*z = 0;
+			fprintf(stderr, "Failed to allocate input buffer\n");
+			exit(1);
 		}
-		else
+		fclose(in);
+	}
+	else
+	{
+		fprintf(err, "Failed to open %s\n", job->path);
+		job->failed = 1;
+	}
+	fclose(out);
+	fclose(err);
+}
+
+/**
+ * Funkcja wątku puli: sprawdza pliki, dopóki są zadania.
+ * @param[in] arg Argument wątku (struct worker).
+ * @return NULL.
+ */
+void * work(void *arg)
+{
+	struct worker *worker = arg;
+	struct work_pool *pool = worker->pool;
+	struct hint_cache *cache = hint_cache_new(HINT_CACHE_SIZE);
+	if (!cache)
+	{
+		fprintf(stderr, "Failed to create hint cache\n");
+		exit(1);
+	}
+	size_t i;
+	while (take_job(pool, worker->id, &i))
+	{
+		check_file(pool, cache, &pool->jobs[i]);
+		pthread_mutex_lock(&pool->lock);
+		pool->jobs[i].done = 1;
+		pthread_cond_broadcast(&pool->finished);
+		pthread_mutex_unlock(&pool->lock);
+	}
+	hint_cache_done(cache);
+	return NULL;
+}
+
+/**
+ * Sprawdza pliki równolegle na 'thread_count' wątkach.
+ * Wyniki wypisywane są w kolejności plików, na stdout sprawdzony tekst,
+ * a na stderr podpowiedzi, tak jakby każdy plik był po kolei podany
+ * na wejście programu.
+ * @param[in] dict Słownik.
+ * @param[in] v Czy wypisywać podpowiedzi.
+ * @param[in] thread_count Liczba wątków.
+ * @param[in] paths Ścieżki do plików.
+ * @param[in] count Liczba plików.
+ * @return 0 jeśli udało się otworzyć wszystkie pliki, 1 w p.p.
+ */
+int check_files(struct dictionary *dict, int v, int thread_count,
+				char **paths, size_t count)
+{
+	if ((size_t) thread_count > count)
+		thread_count = count;
+	struct work_pool pool;
+	pool.dict = dict;
+	pool.v = v;
+	pool.thread_count = thread_count;
+	pool.jobs = calloc(count, sizeof(struct check_job));
+	pool.queues = calloc(thread_count, sizeof(struct work_queue));
+	struct worker *workers = calloc(thread_count, sizeof(struct worker));
+	pthread_t *threads = calloc(thread_count, sizeof(pthread_t));
+	if (!pool.jobs || !pool.queues || !workers || !threads)
+	{
+		fprintf(stderr, "Failed to create thread pool\n");
+		exit(1);
+	}
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.finished, NULL);
+	for (size_t i = 0; i < count; i++)
+		pool.jobs[i].path = paths[i];
+	for (int t = 0; t < thread_count; t++)
+	{
+		pthread_mutex_init(&pool.queues[t].lock, NULL);
+		pool.queues[t].begin = count * t / thread_count;
+		pool.queues[t].end = count * (t + 1) / thread_count;
+		workers[t].pool = &pool;
+		workers[t].id = t;
+	}
+	for (int t = 0; t < thread_count; t++)
+		if (pthread_create(&threads[t], NULL, work, &workers[t]))
 		{
-			*z += wcslen(word);
+			fprintf(stderr, "Failed to create thread\n");
+			exit(1);
 		}
-		printf("%ls", c);
+	int status = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		struct check_job *job = &pool.jobs[i];
+		pthread_mutex_lock(&pool.lock);
+		while (!job->done)
+			pthread_cond_wait(&pool.finished, &pool.lock);
+		pthread_mutex_unlock(&pool.lock);
+		fwrite(job->out, 1, job->out_size, stdout);
+		fwrite(job->err, 1, job->err_size, stderr);
+		free(job->out);
+		free(job->err);
+		if (job->failed)
+			status = 1;
 	}
-	return 1;
+	for (int t = 0; t < thread_count; t++)
+		pthread_join(threads[t], NULL);
+	for (int t = 0; t < thread_count; t++)
+		pthread_mutex_destroy(&pool.queues[t].lock);
+	pthread_cond_destroy(&pool.finished);
+	pthread_mutex_destroy(&pool.lock);
+	free(threads);
+	free(workers);
+	free(pool.queues);
+	free(pool.jobs);
+	return status;
 }
 
 /**@}*/
 
 /**
  * Funkcja main.
- * Jedyne poprawne wywołanie programu to:
- * ./dict-check dict lub ./dict-check -v dict
+ * Poprawne wywołanie programu to:
+ * ./dict-check [-v] [-j N] dict [file...]
+ * Bez plików sprawdzane jest stdin. Podane pliki sprawdzane są
+ * na N wątkach (domyślnie jednym), które współdzielą raz wczytany słownik;
+ * wynik jest taki sam jak przy kolejnym podaniu każdego pliku na stdin.
  */
 int main(int argc, char *argv[]){
-	char *filename;
-	int v;
-	if (argc == 2)
+	int v = 0;
+	int thread_count = 1;
+	int i;
+	for (i = 1; i < argc - 1; i++)
+		if (strcmp(argv[i], "-v") == 0)
+			v = 1;
+		else if (strcmp(argv[i], "-j") == 0 && i + 2 < argc
+				 && (thread_count = atoi(argv[i + 1])) > 0)
+			i++;
+		else
+			break;
+	if (i >= argc || thread_count <= 0 || argv[i][0] == '-')
 	{
-		filename = argv[1];
-		v = 0;
+		printf("usage: %s [-v] [-j N] dict [file...]\n", argv[0]);
+		return 0;
 	}
-	else if (argc == 3 && strcmp(argv[1], "-v") == 0)
+	char *filename = argv[i];
+	setlocale(LC_ALL, "pl_PL.UTF-8");
+	struct dictionary *dict = dictionary_load_mmap(filename);
+	if (!dict)
 	{
-		filename = argv[2];
-		v = 1;
+		FILE *f = fopen(filename, "r");
+		if (!f || !(dict = dictionary_load(f)))
+		{
+			fprintf(stderr, "Failed to load dictionary\n");
+			exit(1); //czy to tu zadziala ?
+		}
+		fclose(f);
 	}
-	else
+	/* Indeks podpowiedzi zapisany obok słownika przez dict-convert -i. */
+	char *index_name = malloc(strlen(filename) + sizeof(".idx"));
+	sprintf(index_name, "%s.idx", filename);
+	FILE *f = fopen(index_name, "r");
+	if (f)
 	{
-		printf("usage: %s filename OR %s -v filename\n", argv[0], argv[0]);
-		return 0;
+		dictionary_load_hint_index(dict, f);
+		fclose(f);
 	}
-	setlocale(LC_ALL, "pl_PL.UTF-8");
-	FILE *f = fopen(filename, "r");
-	struct dictionary *dict;
-	if (!f || !(dict = dictionary_load(f)))
+	free(index_name);
+	/* Zmiany dopisane do dziennika przez dict-editor -j; odtwarzane po
+	   wczytaniu indeksu, który jest wtedy poprawiany na bieżąco. */
+	if (journal_replay(dict, filename) < 0)
 	{
 		fprintf(stderr, "Failed to load dictionary\n");
-		exit(1); //czy to tu zadziala ?
+		exit(1);
+	}
+	if (i + 1 < argc)
+	{
+		int status = check_files(dict, v, thread_count, argv + i + 1,
+								 argc - i - 1);
+		dictionary_done(dict);
+		return status;
+	}
+	struct hint_cache *cache = hint_cache_new(HINT_CACHE_SIZE);
+	if (!cache)
+	{
+		fprintf(stderr, "Failed to create hint cache\n");
+		exit(1);
+	}
+	if (check_stream(dict, cache, stdin, stdout, stderr, v))
+	{
+		fprintf(stderr, "Failed to allocate input buffer\n");
+		exit(1);
 	}
-	fclose(f);
-	int w = 1;
-	int z = 0;
-	do {} while (read(dict, v, &w, &z));
+	hint_cache_done(cache);
 	dictionary_done(dict);
 	return 0;
 }
@@ -0,0 +1,353 @@
+/** @file
+  Implementacja tokenizera tekstu sprawdzanego przez dict-check.
+  @ingroup dict-check
+  @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+  @date 2015-07-12
+ */
+
+#include "tokenizer.h"
+#include <langinfo.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wctype.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/** @name Funkcje pomocnicze
+  @{
+ */
+
+/**
+ * Sprawdza, czy bajt jest literą ASCII.
+ * @param[in] b Bajt.
+ * @return Wartość logiczna.
+ */
+static bool ascii_letter(unsigned char b)
+{
+	return (unsigned char) ((b | 0x20) - 'a') < 26;
+}
+
+/**
+ * Sprawdza, czy bajt jest znakiem ASCII, który można przepisać bez
+ * dalszego badania: nie jest literą, końcem wiersza ani znakiem '\0'.
+ * @param[in] b Bajt.
+ * @return Wartość logiczna.
+ */
+static bool ascii_plain(unsigned char b)
+{
+	return b < 0x80 && b != '\n' && b != '\0' && !ascii_letter(b);
+}
+
+/**
+ * Zwraca długość początkowego ciągu bajtów spełniających ascii_plain().
+ * @param[in] p Bajty.
+ * @param[in] len Liczba bajtów.
+ * @return Długość ciągu.
+ */
+static size_t skip_plain(const char *p, size_t len)
+{
+	size_t i = 0;
+#ifdef __SSE2__
+	/* Po dodaniu 0x1f do bajtu z ustawionym bitem 0x20 litery trafiają
+	   na najmniejsze 26 wartości ze znakiem. Bajty spoza ASCII mają
+	   ustawiony najstarszy bit. */
+	const __m128i case_bit = _mm_set1_epi8(0x20);
+	const __m128i bias = _mm_set1_epi8((char) (0x80 - 'a'));
+	const __m128i limit = _mm_set1_epi8((char) (0x80 + 26));
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i *) (p + i));
+		__m128i folded = _mm_add_epi8(_mm_or_si128(x, case_bit), bias);
+		__m128i special = _mm_or_si128(_mm_cmplt_epi8(folded, limit),
+			_mm_or_si128(_mm_cmpeq_epi8(x, newline), _mm_cmpeq_epi8(x, zero)));
+		int mask = _mm_movemask_epi8(_mm_or_si128(special, x));
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+#endif
+	while (i < len && ascii_plain(p[i]))
+		i++;
+	return i;
+}
+
+/**
+ * Dopełnia bufor, zachowując bajty od początku bieżącego fragmentu.
+ * Bufor jest powiększany, jeśli fragment zajmuje go całego.
+ * @param[in,out] t Tokenizer.
+ * @return Wartość logiczna czy przybyły nowe bajty.
+ */
+static bool refill(struct tokenizer *t)
+{
+	if (t->eof)
+		return false;
+	if (t->start > 0)
+	{
+		memmove(t->buffer, t->buffer + t->start, t->end - t->start);
+		t->pos -= t->start;
+		t->end -= t->start;
+		t->start = 0;
+	}
+	if (t->end == t->capacity)
+	{
+		char *buffer = realloc(t->buffer, 2 * t->capacity);
+		if (buffer == NULL)
+		{
+			t->eof = true;
+			return false;
+		}
+		t->buffer = buffer;
+		t->capacity *= 2;
+	}
+	size_t n = fread(t->buffer + t->end, 1, t->capacity - t->end, t->in);
+	t->end += n;
+	if (n == 0)
+		t->eof = true;
+	return n > 0;
+}
+
+/**
+ * Dekoduje znak spoza ASCII z pozycji czytania.
+ * Dwubajtowe znaki UTF-8 (m.in. wszystkie polskie litery) dekodowane są
+ * bezpośrednio, a pozostałe przez mbrtowc(), tak jak robi to fgetws().
+ * @param[in,out] t Tokenizer; bufor może zostać dopełniony.
+ * @param[out] c Znak.
+ * @return Liczba bajtów znaku lub 0, jeśli bajty nie tworzą znaku.
+ */
+static size_t decode(struct tokenizer *t, wchar_t *c)
+{
+	while (t->end - t->pos < MB_CUR_MAX && refill(t))
+		;
+	const unsigned char *s = (const unsigned char *) t->buffer + t->pos;
+	size_t left = t->end - t->pos;
+	if (t->utf8 && s[0] >= 0xc2 && s[0] <= 0xdf && left >= 2
+		&& (s[1] & 0xc0) == 0x80)
+	{
+		*c = ((wchar_t) (s[0] & 0x1f) << 6) | (s[1] & 0x3f);
+		return 2;
+	}
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+	size_t n = mbrtowc(c, (const char *) s, left, &state);
+	if (n == (size_t) -1 || n == (size_t) -2 || n == 0)
+		return 0;
+	return n;
+}
+
+/**
+ * Dopisuje literę do buforów słowa.
+ * @param[in,out] t Tokenizer.
+ * @param[in] len Bieżąca długość słowa.
+ * @param[in] c Litera.
+ * @param[in] lower Litera zamieniona na małą.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+static bool append_letter(struct tokenizer *t, size_t len, wchar_t c,
+						  wchar_t lower)
+{
+	if (len + 1 >= t->word_capacity)
+	{
+		size_t capacity = 2 * t->word_capacity;
+		wchar_t *wide = realloc(t->wide, capacity * sizeof(wchar_t));
+		if (wide == NULL)
+			return false;
+		t->wide = wide;
+		wchar_t *new_lower = realloc(t->lower, capacity * sizeof(wchar_t));
+		if (new_lower == NULL)
+			return false;
+		t->lower = new_lower;
+		t->word_capacity = capacity;
+	}
+	t->wide[len] = c;
+	t->lower[len] = lower;
+	return true;
+}
+
+/**
+ * Oddaje słowo od początku bieżącego fragmentu do pozycji czytania.
+ * @param[in,out] t Tokenizer.
+ * @param[out] token Słowo.
+ * @param[in] len Liczba liter słowa.
+ */
+static void emit_word(struct tokenizer *t, struct token *token, size_t len)
+{
+	t->wide[len] = t->lower[len] = L'\0';
+	token->text = t->buffer + t->start;
+	token->len = t->pos - t->start;
+	token->word = true;
+	token->wide = t->wide;
+	token->lower = t->lower;
+	token->length = len;
+	token->line = t->line;
+	token->column = t->column + 1;
+	t->column += len;
+}
+
+/**
+ * Czyta słowo zaczynające się na pozycji czytania.
+ * @param[in,out] t Tokenizer.
+ * @param[out] token Słowo.
+ * @return true jeśli przeczytano słowo, false jeśli wejście skończyło się
+ * przed pierwszym znakiem po słowie, a pole `last_word` nie jest ustawione.
+ */
+static bool read_word(struct tokenizer *t, struct token *token)
+{
+	size_t len = 0;
+	for (;;)
+	{
+		if (t->pos == t->end && !refill(t))
+		{
+			t->done = true;
+			if (!t->last_word)
+				return false;
+			emit_word(t, token, len);
+			return true;
+		}
+		unsigned char b = t->buffer[t->pos];
+		wchar_t c = b;
+		wchar_t lower = b | 0x20;
+		size_t n = 1;
+		if (b >= 0x80)
+		{
+			if ((n = decode(t, &c)) == 0)
+			{
+				t->invalid = true;
+				break;
+			}
+			lower = towlower(c);
+		}
+		if (b < 0x80 ? !ascii_letter(b) : !iswalpha(c))
+		{
+			emit_word(t, token, len);
+			return true;
+		}
+		if (!append_letter(t, len, c, lower))
+			break;
+		len++;
+		t->pos += n;
+	}
+	t->done = true;
+	return false;
+}
+
+/**@}*/
+/** @name Elementy interfejsu
+  @{
+ */
+
+bool tokenizer_init(struct tokenizer *tokenizer, FILE *in)
+{
+	const char *codeset = nl_langinfo(CODESET);
+	tokenizer->in = in;
+	tokenizer->capacity = TOKENIZER_BLOCK_SIZE;
+	tokenizer->buffer = malloc(tokenizer->capacity);
+	tokenizer->start = tokenizer->pos = tokenizer->end = 0;
+	tokenizer->eof = tokenizer->done = tokenizer->invalid = false;
+	tokenizer->last_word = false;
+	tokenizer->utf8 = strcmp(codeset, "UTF-8") == 0;
+	tokenizer->word_capacity = 64;
+	tokenizer->wide = malloc(tokenizer->word_capacity * sizeof(wchar_t));
+	tokenizer->lower = malloc(tokenizer->word_capacity * sizeof(wchar_t));
+	tokenizer->line = 1;
+	tokenizer->column = 0;
+	if (!tokenizer->buffer || !tokenizer->wide || !tokenizer->lower)
+	{
+		tokenizer_done(tokenizer);
+		return false;
+	}
+	return true;
+}
+
+void tokenizer_reset(struct tokenizer *tokenizer, FILE *in)
+{
+	tokenizer->in = in;
+	tokenizer->start = tokenizer->pos = tokenizer->end = 0;
+	tokenizer->eof = tokenizer->done = tokenizer->invalid = false;
+	tokenizer->line = 1;
+	tokenizer->column = 0;
+}
+
+void tokenizer_done(struct tokenizer *tokenizer)
+{
+	free(tokenizer->buffer);
+	free(tokenizer->wide);
+	free(tokenizer->lower);
+	tokenizer->buffer = NULL;
+	tokenizer->wide = tokenizer->lower = NULL;
+}
+
+bool tokenizer_next(struct tokenizer *tokenizer, struct token *token)
+{
+	struct tokenizer *t = tokenizer;
+	t->start = t->pos;
+	/* Fragment między słowami oddajemy, zanim trzeba będzie dopełnić
+	   bufor lub przeczytać słowo, więc bufor rośnie tylko dla słów
+	   dłuższych od niego. */
+	while (!t->done)
+	{
+		if (t->pos == t->end)
+		{
+			if (t->pos > t->start)
+				break;
+			if (!refill(t))
+				t->done = true;
+			continue;
+		}
+		size_t n = skip_plain(t->buffer + t->pos, t->end - t->pos);
+		t->pos += n;
+		t->column += n;
+		if (t->pos == t->end)
+			continue;
+		unsigned char b = t->buffer[t->pos];
+		bool pending = t->pos > t->start;
+		if (b == '\n')
+		{
+			t->pos++;
+			t->line++;
+			t->column = 0;
+			continue;
+		}
+		if (b == '\0')
+		{
+			/* fgetws() zwraca '\0' jak każdy znak, ale wypisanie go
+			   przez "%ls" nic nie daje. */
+			if (pending)
+				break;
+			t->start = ++t->pos;
+			t->column++;
+			continue;
+		}
+		if (b < 0x80)
+		{
+			if (pending)
+				break;
+			return read_word(t, token);
+		}
+		if (pending && t->end - t->pos < MB_CUR_MAX && !t->eof)
+			break;
+		wchar_t c;
+		if ((n = decode(t, &c)) == 0)
+		{
+			t->done = t->invalid = true;
+			break;
+		}
+		if (iswalpha(c))
+		{
+			if (pending)
+				break;
+			return read_word(t, token);
+		}
+		t->pos += n;
+		t->column++;
+	}
+	if (t->pos == t->start)
+		return false;
+	token->text = t->buffer + t->start;
+	token->len = t->pos - t->start;
+	token->word = false;
+	return true;
+}
+
+/**@}*/
@@ -0,0 +1,128 @@
+/** @file
+    Interfejs tokenizera tekstu sprawdzanego przez dict-check.
+
+    Tokenizer czyta wejście dużymi blokami i dzieli je na fragmenty:
+    słowa (maksymalne ciągi liter w sensie iswalpha()) i fragmenty między
+    nimi. Fragmenty przekazywane są jako wskaźniki do bufora, bez
+    kopiowania; tylko litery słów są dekodowane do postaci szerokiej.
+    Znaki ASCII dekodowane są bez wywoływania funkcji biblioteki C,
+    a ciągi znaków ASCII niebędących literami pomijane są po 16 bajtów
+    naraz instrukcjami SSE2, jeśli są dostępne.
+
+    Zachowanie jest takie samo jak czytanie wejścia po jednym znaku przez
+    fgetws(): znaki liczone są od 1 w każdym wierszu, znaki '\0' są
+    pomijane, a niepoprawny ciąg bajtów kończy wejście. Słowo, po którym
+    wejście się kończy, nie jest zwracane, chyba że ustawiono pole
+    `last_word` tokenizera.
+
+    @ingroup dict-check
+    @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+    @date 2015-07-12
+ */
+
+#ifndef __TOKENIZER_H__
+#define __TOKENIZER_H__
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <wchar.h>
+
+/**
+  Początkowy rozmiar bufora wejścia w bajtach.
+  */
+#define TOKENIZER_BLOCK_SIZE (256 * 1024)
+
+/**
+  Fragment wejścia.
+  Wskaźniki są ważne do następnego wywołania tokenizer_next().
+  */
+struct token
+{
+    /// Bajty fragmentu w kodowaniu wejścia.
+    const char *text;
+    /// Liczba bajtów fragmentu.
+    size_t len;
+    /// Czy fragment jest słowem.
+    bool word;
+    /// Słowo w postaci szerokiej (tylko dla słów).
+    const wchar_t *wide;
+    /// Słowo małymi literami (tylko dla słów).
+    const wchar_t *lower;
+    /// Liczba liter słowa (tylko dla słów).
+    size_t length;
+    /// Wiersz pierwszej litery słowa, od 1.
+    int line;
+    /// Numer pierwszej litery słowa w wierszu, od 1.
+    int column;
+};
+
+/**
+  Struktura tokenizera.
+  */
+struct tokenizer
+{
+    /// Strumień wejściowy.
+    FILE *in;
+    /// Bufor wejścia.
+    char *buffer;
+    /// Rozmiar bufora.
+    size_t capacity;
+    /// Początek bieżącego fragmentu.
+    size_t start;
+    /// Pozycja czytania.
+    size_t pos;
+    /// Koniec danych w buforze.
+    size_t end;
+    /// Czy strumień się skończył.
+    bool eof;
+    /// Czy wejście się skończyło (także przez błąd kodowania).
+    bool done;
+    /// Czy wejście zakończył niepoprawny ciąg bajtów.
+    bool invalid;
+    /// Czy zwracać słowo, po którym wejście się kończy; domyślnie false.
+    bool last_word;
+    /// Czy kodowanie wejścia to UTF-8.
+    bool utf8;
+    /// Bufor na słowo w postaci szerokiej.
+    wchar_t *wide;
+    /// Bufor na słowo małymi literami.
+    wchar_t *lower;
+    /// Rozmiar buforów na słowo w znakach.
+    size_t word_capacity;
+    /// Bieżący wiersz.
+    int line;
+    /// Numer ostatnio przeczytanego znaku w wierszu.
+    int column;
+};
+
+/**
+  Inicjuje tokenizer. Kodowanie wejścia wynika z bieżącego locale.
+  @param[out] tokenizer Tokenizer.
+  @param[in,out] in Strumień wejściowy.
+  @return true jeśli się udało, false jeśli zabrakło pamięci.
+  */
+bool tokenizer_init(struct tokenizer *tokenizer, FILE *in);
+
+/**
+  Zaczyna czytanie nowego strumienia od początku, zachowując bufory
+  tokenizera.
+  @param[in,out] tokenizer Zainicjowany tokenizer.
+  @param[in,out] in Strumień wejściowy.
+  */
+void tokenizer_reset(struct tokenizer *tokenizer, FILE *in);
+
+/**
+  Zwalnia pamięć tokenizera.
+  @param[in,out] tokenizer Tokenizer.
+  */
+void tokenizer_done(struct tokenizer *tokenizer);
+
+/**
+  Czyta następny fragment wejścia.
+  @param[in,out] tokenizer Tokenizer.
+  @param[out] token Fragment.
+  @return true jeśli przeczytano fragment, false przy końcu wejścia.
+  */
+bool tokenizer_next(struct tokenizer *tokenizer, struct token *token);
+
+#endif /* __TOKENIZER_H__ */
@@ -0,0 +1,90 @@
+/** @defgroup dict-convert Moduł dict-convert
+	Konwerter formatów słownika.
+  */
+/** @file
+  Implementacja konwertera słownika między postacią tekstową a binarną.
+  @ingroup dict-convert
+  @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+  @date 2015-06-14
+ */
+
+#include "dictionary.h"
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Funkcja main.
+ * Poprawne wywołanie programu to:
+ * ./dict-convert [-t] [-w] [-m] [-i] input output.
+ * Domyślnie słownik zapisywany jest w postaci binarnej, a z opcją -t
+ * w postaci tekstowej. Plik wejściowy może być w dowolnej z tych postaci,
+ * a z opcją -w jest posortowaną listą słów w UTF-8. Opcja -m minimalizuje
+ * słownik przed zapisem (patrz dictionary_freeze()). Opcja -i zapisuje
+ * dodatkowo indeks podpowiedzi (patrz dictionary_index_hints()) do pliku
+ * output.idx, skąd wczytuje go dict-check.
+ */
+int main(int argc, char *argv[])
+{
+	int text = 0;
+	int words = 0;
+	int minimize = 0;
+	int index = 0;
+	int i;
+	for (i = 1; i < argc - 2; i++)
+		if (strcmp(argv[i], "-t") == 0)
+			text = 1;
+		else if (strcmp(argv[i], "-w") == 0)
+			words = 1;
+		else if (strcmp(argv[i], "-m") == 0)
+			minimize = 1;
+		else if (strcmp(argv[i], "-i") == 0)
+			index = 1;
+		else
+			break;
+	if (argc < 3 || i != argc - 2)
+	{
+		printf("usage: %s [-t] [-w] [-m] [-i] input output\n", argv[0]);
+		return 0;
+	}
+	char *input = argv[i];
+	char *output = argv[i + 1];
+	setlocale(LC_ALL, "pl_PL.UTF-8");
+	FILE *f = fopen(input, "r");
+	struct dictionary *dict;
+	if (!f || !(dict = words ? dictionary_build_sorted_file(f)
+							 : dictionary_load(f)))
+	{
+		fprintf(stderr, "Failed to load dictionary\n");
+		exit(1);
+	}
+	fclose(f);
+	if (minimize && dictionary_freeze(dict))
+	{
+		fprintf(stderr, "Failed to minimize dictionary\n");
+		exit(1);
+	}
+	f = fopen(output, "w");
+	if (!f || (text ? dictionary_save(dict, f) : dictionary_save_binary(dict, f))
+		|| fclose(f))
+	{
+		fprintf(stderr, "Failed to save dictionary\n");
+		exit(1);
+	}
+	if (index)
+	{
+		char *index_name = malloc(strlen(output) + sizeof(".idx"));
+		sprintf(index_name, "%s.idx", output);
+		f = fopen(index_name, "w");
+		if (dictionary_index_hints(dict) || !f
+			|| dictionary_save_hint_index(dict, f) || fclose(f))
+		{
+			fprintf(stderr, "Failed to save hint index\n");
+			exit(1);
+		}
+		free(index_name);
+	}
+	dictionary_done(dict);
+	return 0;
+}
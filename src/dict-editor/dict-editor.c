@@ -12,6 +12,7 @@
   */
 
 #include "dictionary.h"
+#include "journal.h"
 #include <assert.h>
 #include <locale.h>
 #include <stdio.h>
@@ -33,10 +34,12 @@ enum Command {
     DELETE,
     FIND,
     HINTS,
+    COMPLETE,
     SAVE,
     LOAD,
     QUIT,
     CLEAR,
+    STATS,
     COMMANDS_COUNT };
 
 
@@ -49,10 +52,12 @@ static const char *commands[] =
     "delete",
     "find",
     "hints",
+    "complete",
     "save",
     "load",
     "quit",
-    "clear"
+    "clear",
+    "stats"
 };
 
 /** Maksymalna długość komendy.
@@ -67,6 +72,15 @@ static const char *commands[] =
     Maksymalna długość nazwy pliku bez kończącego znaku '\0'
   */
 #define MAX_FILE_LENGTH 511
+/** Liczba słów wypisywanych przez `complete`.
+  */
+#define COMPLETE_COUNT 10
+
+/** Czy zapisywać słownik w trybie z dziennikiem.
+    W tym trybie `save` do pliku, z którego słownik wczytano lub do którego
+    go ostatnio zapisano, dopisuje tylko zmiany od poprzedniego zapisu.
+  */
+static bool journaled = false;
 
 
 /** Wczytuje wejście do napotkania znaku nowej linii.
@@ -108,12 +122,45 @@ int make_lowercase(wchar_t *word)
 }
 
 
+/** Zapamiętuje zmianę słownika w dzienniku, jeśli jest.
+  @param[in,out] journal Dziennik lub NULL.
+  @param[in] insert true dla wstawienia, false dla usunięcia słowa.
+  @param[in] word Słowo.
+ */
+static void record(struct journal *journal, bool insert, const wchar_t *word)
+{
+    if (journal && journal_record(journal, insert, word) < 0)
+    {
+        fprintf(stderr, "Failed to record change\n");
+        exit(1);
+    }
+}
+
+
+/** Wypisuje słowa listy w jednym wierszu, rozdzielone spacjami.
+  @param[in] list Lista słów.
+ */
+static void print_list(const struct word_list *list)
+{
+    const wchar_t * const *a = word_list_get(list);
+    for (size_t i = 0; i < word_list_size(list); ++i)
+    {
+        if (i)
+            printf(" ");
+        printf("%ls", a[i]);
+    }
+    printf("\n");
+}
+
+
 /** Przetwarza komendę operującą na słowniku.
   @param[in,out] dict Słownik, na którym wykonywane są operacje.
+  @param[in,out] journal Dziennik słownika lub NULL.
   @param[in] c Komenda.
   @return 0, jeśli należy zakończyć proram, 1 w p.p.
  */
-static int dict_command(struct dictionary **dict, enum Command c) 
+static int dict_command(struct dictionary **dict, struct journal *journal,
+                        enum Command c) 
 {
     wchar_t word[MAX_WORD_LENGTH+1];
     if (scanf("%" xstr(MAX_WORD_LENGTH) "ls", word) <= 0)
@@ -129,14 +176,25 @@ static int dict_command(struct dictionary **dict, enum Command c)
     switch (c)
     {
         case INSERT:
-            if (dictionary_insert(*dict, word))
-                printf("inserted: %ls\n", word);
-            else
-                return ignored();
-            break;
+            {
+                int result = dictionary_insert(*dict, word);
+                if (result < 0)
+                    fprintf(stderr, "Failed to insert '%ls'\n", word);
+                else if (result)
+                {
+                    record(journal, true, word);
+                    printf("inserted: %ls\n", word);
+                }
+                else
+                    return ignored();
+                break;
+            }
         case DELETE:
             if (dictionary_delete(*dict, word))
+            {
+                record(journal, false, word);
                 printf("deleted: %ls\n", word);
+            }
             else
                 return ignored();
             break;
@@ -150,14 +208,19 @@ static int dict_command(struct dictionary **dict, enum Command c)
             {
                 struct word_list list;
                 dictionary_hints(*dict, word, &list);
-                const wchar_t * const *a = word_list_get(&list);
-                for (size_t i = 0; i < word_list_size(&list); ++i)
+                print_list(&list);
+                word_list_done(&list);
+                break;
+            }
+        case COMPLETE:
+            {
+                struct word_list list;
+                if (dictionary_complete(*dict, word, COMPLETE_COUNT, &list) < 0)
                 {
-                    if (i)
-                        printf(" ");
-                    printf("%ls", a[i]);
+                    fprintf(stderr, "Failed to complete '%ls'\n", word);
+                    exit(1);
                 }
-                printf("\n");
+                print_list(&list);
                 word_list_done(&list);
                 break;
             }
@@ -170,11 +233,16 @@ static int dict_command(struct dictionary **dict, enum Command c)
 
 
 /** Przetwarza komendę operującą na plikach.
+  Wczytanie odtwarza dziennik pliku. Zapis do pliku związanego z dziennikiem
+  dopisuje do niego zmiany, a do innego pliku zapisuje cały słownik
+  i usuwa jego dziennik.
   @param[in,out] dict Słownik, na którym wykonywane są operacje.
+  @param[in,out] journal Dziennik słownika lub NULL.
   @param[in] c Komenda.
   @return 0, jeśli należy zakończyć proram, 1 w p.p.
  */
-static int file_command(struct dictionary **dict, enum Command c) 
+static int file_command(struct dictionary **dict, struct journal **journal,
+                        enum Command c) 
 {
     char filename[MAX_FILE_LENGTH+1];
     if (scanf("%" xstr(MAX_FILE_LENGTH) "s", filename) <= 0)
@@ -186,26 +254,37 @@ static int file_command(struct dictionary **dict, enum Command c)
     {
         case SAVE:
             {
-                FILE *f = fopen(filename, "w");
-                if (!f || dictionary_save(*dict, f))
+                int result;
+                if (*journal && !strcmp(journal_path(*journal), filename))
+                    result = journal_commit(*journal, *dict);
+                else
+                {
+                    journal_done(*journal);
+                    *journal = NULL;
+                    result = journal_save(*dict, filename);
+                    if (!result && journaled
+                        && !(*journal = journal_new(filename)))
+                        result = -1;
+                }
+                if (result)
                 {
                     fprintf(stderr, "Failed to save dictionary\n");
                     exit(1);
                 }
-                fclose(f);
                 printf("dictionary saved in file %s\n", filename);
                 break;
             }
         case LOAD:
             {
-                FILE *f = fopen(filename, "r");
-                struct dictionary *new_dict;
-                if (!f || !(new_dict = dictionary_load(f)))
+                journal_done(*journal);
+                *journal = NULL;
+                struct dictionary *new_dict = journal_load(filename);
+                if (!new_dict
+                    || (journaled && !(*journal = journal_new(filename))))
                 {
                     fprintf(stderr, "Failed to load dictionary\n");
                     exit(1);
                 }
-                fclose(f);
                 printf("dictionary loaded from file %s\n", filename);
                 dictionary_done(*dict);
                 *dict = new_dict;
@@ -220,11 +299,60 @@ static int file_command(struct dictionary **dict, enum Command c)
 
 
 
+/** Wypisuje histogram bez pustych przedziałów końcowych.
+  @param[in] name Nazwa histogramu.
+  @param[in] histogram Histogram z DICTIONARY_HISTOGRAM przedziałami.
+ */
+static void print_histogram(const char *name, const size_t *histogram)
+{
+    int last = DICTIONARY_HISTOGRAM - 1;
+    while (last > 0 && !histogram[last])
+        --last;
+    printf("%s:", name);
+    for (int i = 0; i <= last; ++i)
+        printf(" %d%s=%zu", i, i == DICTIONARY_HISTOGRAM - 1 ? "+" : "",
+               histogram[i]);
+    printf("\n");
+}
+
+
+/** Wypisuje zajętość pamięci i kształt słownika.
+  @param[in] dict Słownik.
+ */
+static void print_stats(const struct dictionary *dict)
+{
+    struct dictionary_memory usage;
+    if (dictionary_memory_usage(dict, &usage) < 0)
+    {
+        fprintf(stderr, "Failed to measure dictionary\n");
+        exit(1);
+    }
+    printf("words: %zu\n", usage.words);
+    printf("longest word: %zu\n", dictionary_max_length(dict));
+    printf("nodes: %zu\n", usage.nodes);
+    printf("node bytes: %zu\n", usage.node_bytes);
+    printf("child bytes: %zu\n", usage.child_bytes);
+    printf("overhead bytes: %zu\n", usage.overhead_bytes);
+    printf("leaked bytes: %zu\n", usage.leaked_bytes);
+    printf("other bytes: %zu\n", usage.other_bytes);
+    printf("total bytes: %zu\n", usage.total_bytes);
+    printf("single-child nodes: %zu (%.1f%%)\n", usage.single_child,
+           usage.nodes ? 100.0 * usage.single_child / usage.nodes : 0.0);
+    printf("compressed letters: %zu\n", usage.prefix_letters);
+    print_histogram("fanout", usage.fanout);
+    print_histogram("depth", usage.depth);
+    wchar_t alphabet[DICTIONARY_ALPHABET];
+    dictionary_alphabet(dict, alphabet);
+    printf("alphabet: %ls\n", alphabet);
+}
+
+
 /** Przetwarza jedną komendę.
   @param[in,out] dict Słownik, na którym wykonywane są operacje
+  @param[in,out] journal Dziennik słownika lub NULL
   @return 0, jeśli należy zakończyć proram, 1 w p.p.
  */
-int try_process_command(struct dictionary **dict)
+int try_process_command(struct dictionary **dict, struct journal **journal)
 {
     char cmd[MAX_COMMAND_LENGTH+1];
     if (scanf("%" xstr(MAX_COMMAND_LENGTH) "s", cmd) <= 0)
@@ -251,29 +379,48 @@ int try_process_command(struct dictionary **dict)
     {
         dictionary_done(*dict);
         *dict = dictionary_new();
+        journal_done(*journal);
+        *journal = NULL;
         printf("cleared\n");
         skip_line();
         return 1;
     }
+    else if (c == STATS)
+    {
+        print_stats(*dict);
+        skip_line();
+        return 1;
+    }
     else if (c < SAVE)
     {
-        return dict_command(dict, c);
+        return dict_command(dict, *journal, c);
     }
     else
     {
-        return file_command(dict, c);
+        return file_command(dict, journal, c);
     }
 }
 
 /**
   Funkcja main.
   Główna funkcja programu do testowania słownika. 
+  Poprawne wywołanie programu to:
+  ./dict-editor [-j]
+  Z opcją -j słownik zapisywany jest w trybie z dziennikiem.
  */
-int main(void)
+int main(int argc, char *argv[])
 {
+    if (argc > 2 || (argc == 2 && strcmp(argv[1], "-j")))
+    {
+        printf("usage: %s [-j]\n", argv[0]);
+        return 0;
+    }
+    journaled = argc == 2;
     setlocale(LC_ALL, "pl_PL.UTF-8");
     struct dictionary *dict = dictionary_new();
-    do {} while (try_process_command(&dict));
+    struct journal *journal = NULL;
+    do {} while (try_process_command(&dict, &journal));
+    journal_done(journal);
     dictionary_done(dict);
     return 0;
 }
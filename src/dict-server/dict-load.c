@@ -0,0 +1,311 @@
+/** @file
+  Implementacja klienta obciążającego serwer dict-server.
+  Klient wysyła żądania wieloma połączeniami naraz, w każdym trzymając
+  wiele żądań bez odpowiedzi, i wypisuje przepustowość oraz percentyle
+  czasu odpowiedzi.
+  @ingroup dict-server
+  @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+  @date 2015-07-26
+ */
+
+#include "protocol.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+  Ustawienia obciążenia wspólne dla wszystkich połączeń.
+  */
+struct load
+{
+	const char *path; ///< Ścieżka gniazda serwera.
+	enum protocol_kind kind; ///< Rodzaj wysyłanych żądań.
+	char **words; ///< Treści żądań, wysyłane po kolei w kółko.
+	size_t word_count; ///< Liczba treści.
+	size_t requests; ///< Liczba żądań na jedno połączenie.
+	size_t depth; ///< Największa liczba żądań bez odpowiedzi.
+};
+
+/**
+  Połączenie klienta i zmierzone w nim czasy odpowiedzi.
+  */
+struct client
+{
+	const struct load *load; ///< Ustawienia.
+	size_t first; ///< Numer pierwszej treści wysyłanej przez połączenie.
+	double *latency; ///< Czasy odpowiedzi kolejnych żądań w sekundach.
+	int failed; ///< Czy połączenie się nie powiodło.
+};
+
+/** @name Funkcje pomocnicze
+  @{
+ */
+
+/**
+ * Zwraca bieżący czas monotoniczny.
+ * @return Czas w sekundach.
+ */
+double now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/**
+ * Łączy się z serwerem.
+ * @param[in] path Ścieżka gniazda.
+ * @return Deskryptor połączenia lub -1.
+ */
+int connect_to(const char *path)
+{
+	struct sockaddr_un address;
+	if (strlen(path) >= sizeof(address.sun_path))
+		return -1;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd >= 0 && connect(fd, (struct sockaddr *) &address, sizeof(address)))
+	{
+		close(fd);
+		fd = -1;
+	}
+	return fd;
+}
+
+/**
+ * Funkcja wątku połączenia: wysyła żądania, trzymając co najwyżej
+ * `depth` bez odpowiedzi, i mierzy czas od wysłania żądania do
+ * odebrania odpowiedzi.
+ * @param[in,out] arg Połączenie (struct client).
+ * @return NULL.
+ */
+void * run_client(void *arg)
+{
+	struct client *client = arg;
+	const struct load *load = client->load;
+	double *sent = malloc(load->requests * sizeof(double));
+	client->latency = malloc(load->requests * sizeof(double));
+	struct buffer in = { NULL, 0, 0 };
+	struct buffer out = { NULL, 0, 0 };
+	int fd = connect_to(load->path);
+	if (fd < 0 || !sent || !client->latency)
+	{
+		client->failed = 1;
+		goto end;
+	}
+	size_t next = 0;
+	size_t answered = 0;
+	while (answered < load->requests)
+	{
+		/* Dopełniamy okno żądań i wysyłamy je jednym zapisem. */
+		out.size = 0;
+		double t = now();
+		for (; next < load->requests && next - answered < load->depth; next++)
+		{
+			const char *word =
+				load->words[(client->first + next) % load->word_count];
+			if (!frame_append(&out, load->kind, word, strlen(word)))
+			{
+				client->failed = 1;
+				goto end;
+			}
+			sent[next] = t;
+		}
+		if (!write_all(fd, out.data, out.size)
+			|| !buffer_reserve(&in, PROTOCOL_HEADER + 4096))
+		{
+			client->failed = 1;
+			goto end;
+		}
+		ssize_t n = read(fd, in.data + in.size, in.capacity - in.size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+		{
+			client->failed = 1;
+			goto end;
+		}
+		in.size += n;
+		t = now();
+		size_t used = 0;
+		long frame;
+		char kind;
+		const char *payload;
+		size_t len;
+		while ((frame = frame_parse(in.data + used, in.size - used, &kind,
+									&payload, &len)) > 0)
+		{
+			client->latency[answered] = t - sent[answered];
+			answered++;
+			used += frame;
+		}
+		if (frame < 0)
+		{
+			client->failed = 1;
+			goto end;
+		}
+		memmove(in.data, in.data + used, in.size - used);
+		in.size -= used;
+	}
+end:
+	if (fd >= 0)
+		close(fd);
+	free(in.data);
+	free(out.data);
+	free(sent);
+	return NULL;
+}
+
+/**
+ * Porównuje dwie liczby; komparator dla qsort.
+ * @param[in] a Pierwsza liczba.
+ * @param[in] b Druga liczba.
+ * @return <0, 0 lub >0 zgodnie z porządkiem liczb.
+ */
+int compare_double(const void *a, const void *b)
+{
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * Wczytuje słowa oddzielone białymi znakami.
+ * @param[in,out] f Plik.
+ * @param[out] count Liczba słów.
+ * @return Tablica słów lub NULL, jeśli plik nie zawiera słów.
+ */
+char ** read_words(FILE *f, size_t *count)
+{
+	char **words = NULL;
+	size_t capacity = 0;
+	char word[1024];
+	*count = 0;
+	while (fscanf(f, "%1023s", word) == 1)
+	{
+		if (*count == capacity)
+		{
+			capacity = 2 * capacity + 1024;
+			char **grown = realloc(words, capacity * sizeof(char *));
+			if (!grown)
+				break;
+			words = grown;
+		}
+		if (!(words[*count] = strdup(word)))
+			break;
+		(*count)++;
+	}
+	if (*count == 0)
+	{
+		free(words);
+		return NULL;
+	}
+	return words;
+}
+
+/**@}*/
+
+/**
+ * Funkcja main.
+ * Poprawne wywołanie programu to:
+ * ./dict-load [-c C] [-d D] [-n N] [-o find|hints|check] socket words
+ * Program otwiera C połączeń (domyślnie 4) z serwerem dict-server
+ * i w każdym wysyła N żądań (domyślnie 100000) ze słowami z pliku
+ * `words`, trzymając w połączeniu co najwyżej D żądań bez odpowiedzi
+ * (domyślnie 16). Wynik wypisywany jest w wierszach `klucz wartość`:
+ * liczba żądań, czas, żądania na sekundę i percentyle czasu odpowiedzi
+ * w mikrosekundach.
+ */
+int main(int argc, char *argv[])
+{
+	struct load load = { NULL, PROTOCOL_FIND, NULL, 0, 100000, 16 };
+	int connections = 4;
+	int i;
+	for (i = 1; i + 1 < argc - 2; i += 2)
+		if (strcmp(argv[i], "-c") == 0)
+			connections = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-d") == 0)
+			load.depth = atol(argv[i + 1]);
+		else if (strcmp(argv[i], "-n") == 0)
+			load.requests = atol(argv[i + 1]);
+		else if (strcmp(argv[i], "-o") == 0)
+			load.kind = strcmp(argv[i + 1], "hints") == 0 ? PROTOCOL_HINTS
+				: strcmp(argv[i + 1], "check") == 0 ? PROTOCOL_CHECK
+				: PROTOCOL_FIND;
+		else
+			break;
+	if (i != argc - 2 || connections <= 0 || load.depth == 0
+		|| load.requests == 0)
+	{
+		printf("usage: %s [-c C] [-d D] [-n N] [-o find|hints|check] "
+			   "socket words\n", argv[0]);
+		return 0;
+	}
+	load.path = argv[i];
+	FILE *f = fopen(argv[i + 1], "r");
+	if (!f || !(load.words = read_words(f, &load.word_count)))
+	{
+		fprintf(stderr, "Failed to read words\n");
+		exit(1);
+	}
+	fclose(f);
+	struct client *clients = calloc(connections, sizeof(struct client));
+	pthread_t *threads = calloc(connections, sizeof(pthread_t));
+	if (!clients || !threads)
+	{
+		fprintf(stderr, "Failed to create clients\n");
+		exit(1);
+	}
+	double start = now();
+	for (int c = 0; c < connections; c++)
+	{
+		clients[c].load = &load;
+		clients[c].first = load.word_count * c / connections;
+		if (pthread_create(&threads[c], NULL, run_client, &clients[c]))
+		{
+			fprintf(stderr, "Failed to create thread\n");
+			exit(1);
+		}
+	}
+	for (int c = 0; c < connections; c++)
+		pthread_join(threads[c], NULL);
+	double elapsed = now() - start;
+	size_t total = load.requests * connections;
+	double *latency = malloc(total * sizeof(double));
+	int failed = !latency;
+	for (int c = 0; c < connections; c++)
+	{
+		failed |= clients[c].failed;
+		if (!failed)
+			memcpy(latency + c * load.requests, clients[c].latency,
+				   load.requests * sizeof(double));
+		free(clients[c].latency);
+	}
+	if (failed)
+	{
+		fprintf(stderr, "Failed to talk to server\n");
+		exit(1);
+	}
+	qsort(latency, total, sizeof(double), compare_double);
+	printf("requests %zu\n", total);
+	printf("seconds %.3f\n", elapsed);
+	printf("qps %.0f\n", total / elapsed);
+	printf("p50_us %.1f\n", latency[total / 2] * 1e6);
+	printf("p99_us %.1f\n", latency[total * 99 / 100] * 1e6);
+	printf("max_us %.1f\n", latency[total - 1] * 1e6);
+	for (size_t w = 0; w < load.word_count; w++)
+		free(load.words[w]);
+	free(load.words);
+	free(latency);
+	free(clients);
+	free(threads);
+	return 0;
+}
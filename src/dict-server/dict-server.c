@@ -0,0 +1,858 @@
+/** @defgroup dict-server Moduł dict-server
+	Serwer sprawdzający pisownię.
+  */
+/** @file
+  Implementacja serwera, który raz wczytuje słownik i odpowiada na
+  żądania przez gniazdo lokalne (patrz protocol.h).
+  @ingroup dict-server
+  @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+  @date 2015-07-26
+ */
+
+#define _GNU_SOURCE
+
+#include "dictionary.h"
+#include "hint_cache.h"
+#include "journal.h"
+#include "protocol.h"
+#include "tokenizer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <locale.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <wctype.h>
+
+/** Liczba słów, dla których każdy wątek pamięta podpowiedzi.
+  */
+#define HINT_CACHE_SIZE 4096
+
+/** Liczba bajtów czytanych z połączenia naraz.
+  */
+#define READ_BLOCK (64 * 1024)
+
+/** Liczba połączeń czekających na przyjęcie przez jądro.
+  */
+#define LISTEN_BACKLOG 64
+
+/** Liczba żądań jednego połączenia, które mogą naraz czekać na odpowiedź;
+  dalsze żądania czekają w buforze połączenia.
+  */
+#define CONNECTION_JOBS 64
+
+/** Liczba niewysłanych bajtów odpowiedzi, powyżej której serwer przestaje
+  czytać żądania z połączenia.
+  */
+#define OUTPUT_LIMIT (1 << 20)
+
+/**
+  Zadanie dla puli wątków: jedno żądanie i odpowiedź na nie.
+  Zadania razem z buforami są używane ponownie.
+  */
+struct job
+{
+	struct connection *connection; ///< Połączenie, z którego przyszło żądanie.
+	struct job *next; ///< Następne zadanie w kolejce serwera.
+	struct job *later; ///< Następne żądanie z tego samego połączenia.
+	char kind; ///< Rodzaj żądania.
+	struct buffer request; ///< Treść żądania.
+	struct buffer reply; ///< Odpowiedź.
+	bool ok; ///< Czy udało się przygotować odpowiedź.
+	bool done; ///< Czy wątek główny odebrał już wykonane zadanie.
+};
+
+/**
+  Połączenie z klientem, używane tylko przez wątek główny.
+  */
+struct connection
+{
+	int fd; ///< Deskryptor połączenia.
+	struct buffer in; ///< Odebrane bajty, jeszcze niepodzielone na żądania.
+	struct buffer out; ///< Odpowiedzi czekające na wysłanie.
+	size_t sent; ///< Liczba wysłanych już bajtów z `out`.
+	struct job *first; ///< Najstarsze żądanie, na które nie odpowiedziano.
+	struct job *last; ///< Najnowsze żądanie, na które nie odpowiedziano.
+	size_t jobs; ///< Liczba żądań, na które nie odpowiedziano.
+	bool reading; ///< Czy klient może jeszcze przysłać żądania.
+	bool broken; ///< Czy połączenie jest zerwane; odpowiedzi są porzucane.
+};
+
+/**
+  Serwer: słownik, połączenia i kolejki zadań.
+  Wątek główny czeka za pomocą poll() na wszystkich połączeniach naraz
+  i każde odebrane w całości żądanie przekazuje jako zadanie wątkom puli,
+  więc połączenie nie zajmuje wątku, gdy czeka na dane. Odpowiedzi
+  wykonanych zadań wątek główny wysyła w kolejności żądań każdego
+  połączenia. Słownik jest współdzielony przez wszystkie wątki tylko
+  do odczytu.
+  */
+struct server
+{
+	struct dictionary *dict; ///< Słownik.
+	pthread_mutex_t lock; ///< Blokada kolejek `todo` i `finished`.
+	pthread_cond_t ready; ///< Sygnalizowana po dodaniu zadań do `todo`.
+	struct job *todo; ///< Zadania czekające na wątek, od najstarszego.
+	struct job *todo_last; ///< Ostatnie zadanie w `todo`.
+	struct job *finished; ///< Wykonane zadania nieodebrane przez wątek główny.
+	int stopping; ///< Czy serwer kończy działanie.
+	int wake[2]; ///< Potok budzący wątek główny po wykonaniu zadań.
+	struct connection **connections; ///< Otwarte połączenia.
+	size_t connection_count; ///< Liczba otwartych połączeń.
+	size_t connection_capacity; ///< Rozmiar tablicy `connections`.
+	struct pollfd *polled; ///< Potok, gniazdo nasłuchujące i połączenia.
+	struct job *spare; ///< Nieużywane zadania.
+};
+
+/**
+  Stan wątku puli, używany ponownie dla kolejnych zadań.
+  */
+struct session
+{
+	struct server *server; ///< Serwer.
+	struct hint_cache *cache; ///< Pamięć podręczna podpowiedzi.
+	struct tokenizer tokenizer; ///< Tokenizer tekstów do sprawdzenia.
+	struct buffer *out; ///< Odpowiedź na bieżące żądanie.
+	wchar_t *word; ///< Słowo z żądania małymi literami.
+	size_t word_capacity; ///< Rozmiar bufora słowa w znakach.
+	struct word_list hints; ///< Lista podpowiedzi, używana ponownie.
+};
+
+/**
+  Czy odebrano sygnał zakończenia działania.
+  */
+static volatile sig_atomic_t stop_requested;
+
+/** @name Funkcje pomocnicze
+  @{
+ */
+
+/**
+ * Zapamiętuje sygnał zakończenia działania.
+ * @param[in] sig Numer sygnału.
+ */
+void on_signal(int sig)
+{
+	(void) sig;
+	stop_requested = 1;
+}
+
+/**
+ * Dekoduje słowo z żądania i zamienia jego litery na małe.
+ * @param[in,out] session Sesja; wynik trafia do `session->word`.
+ * @param[in] data Bajty słowa.
+ * @param[in] len Liczba bajtów.
+ * @return true jeśli się udało, false jeśli bajty nie tworzą słowa
+ * lub zabrakło pamięci.
+ */
+bool decode_word(struct session *session, const char *data, size_t len)
+{
+	if (len + 1 > session->word_capacity)
+	{
+		wchar_t *word = realloc(session->word, (len + 1) * sizeof(wchar_t));
+		if (!word)
+			return false;
+		session->word = word;
+		session->word_capacity = len + 1;
+	}
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+	size_t n = 0;
+	while (len > 0)
+	{
+		wchar_t c;
+		size_t used = mbrtowc(&c, data, len, &state);
+		if (used == 0 || used == (size_t) -1 || used == (size_t) -2)
+			return false;
+		session->word[n++] = towlower(c);
+		data += used;
+		len -= used;
+	}
+	session->word[n] = L'\0';
+	return true;
+}
+
+/**
+ * Dopisuje słowo do bufora w kodowaniu locale.
+ * @param[in,out] out Bufor.
+ * @param[in] word Słowo.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+bool append_word(struct buffer *out, const wchar_t *word)
+{
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+	for (; *word; word++)
+	{
+		if (!buffer_reserve(out, MB_CUR_MAX))
+			return false;
+		size_t n = wcrtomb(out->data + out->size, *word, &state);
+		if (n != (size_t) -1)
+			out->size += n;
+	}
+	return true;
+}
+
+/**
+ * Dopisuje do odpowiedzi podpowiedzi dla słowa `session->word`.
+ * @param[in,out] session Sesja.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+bool answer_hints(struct session *session)
+{
+	struct word_list *list = &session->hints;
+	hint_cache_hints_into(session->cache, session->server->dict,
+						  session->word, list);
+	const wchar_t * const *a = word_list_get(list);
+	size_t start;
+	bool ok = frame_begin(session->out, PROTOCOL_HINTS, &start);
+	for (size_t i = 0; ok && i < word_list_size(list); i++)
+		ok = (i == 0 || buffer_append(session->out, " ", 1))
+			&& append_word(session->out, a[i]);
+	if (ok)
+		frame_end(session->out, start);
+	return ok;
+}
+
+/**
+ * Dopisuje do odpowiedzi sprawdzony tekst, tak jak wypisałby go
+ * dict-check, łącznie ze słowem na końcu tekstu. Tekst z niepoprawnym
+ * ciągiem bajtów dostaje odpowiedź PROTOCOL_ERROR.
+ * @param[in,out] session Sesja.
+ * @param[in] text Tekst.
+ * @param[in] len Długość tekstu.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+bool answer_check(struct session *session, const char *text, size_t len)
+{
+	static const char invalid_text[] = "invalid text";
+	size_t start;
+	if (!frame_begin(session->out, PROTOCOL_CHECK, &start))
+		return false;
+	if (len > 0)
+	{
+		FILE *in = fmemopen((void *) text, len, "r");
+		if (!in)
+			return false;
+		tokenizer_reset(&session->tokenizer, in);
+		struct token token;
+		bool ok = true;
+		while (ok && tokenizer_next(&session->tokenizer, &token))
+		{
+			if (token.word
+				&& !dictionary_find(session->server->dict, token.lower))
+				ok = buffer_append(session->out, "#", 1);
+			ok = ok && buffer_append(session->out, token.text, token.len);
+		}
+		fclose(in);
+		if (!ok)
+			return false;
+		if (session->tokenizer.invalid)
+		{
+			session->out->size = start;
+			return frame_append(session->out, PROTOCOL_ERROR, invalid_text,
+								sizeof(invalid_text) - 1);
+		}
+	}
+	frame_end(session->out, start);
+	return true;
+}
+
+/**
+ * Dopisuje do odpowiedzi odpowiedź na jedno żądanie.
+ * @param[in,out] session Sesja.
+ * @param[in] kind Rodzaj żądania.
+ * @param[in] payload Treść żądania.
+ * @param[in] len Długość treści.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+bool answer(struct session *session, char kind, const char *payload,
+			size_t len)
+{
+	static const char invalid_word[] = "invalid word";
+	static const char unknown_kind[] = "unknown request";
+	switch (kind)
+	{
+		case PROTOCOL_FIND:
+		case PROTOCOL_HINTS:
+			if (!decode_word(session, payload, len))
+				return frame_append(session->out, PROTOCOL_ERROR,
+									invalid_word, sizeof(invalid_word) - 1);
+			if (kind == PROTOCOL_HINTS)
+				return answer_hints(session);
+			char found = dictionary_find(session->server->dict, session->word);
+			return frame_append(session->out, PROTOCOL_FIND, &found, 1);
+		case PROTOCOL_CHECK:
+			return answer_check(session, payload, len);
+	}
+	return frame_append(session->out, PROTOCOL_ERROR, unknown_kind,
+						sizeof(unknown_kind) - 1);
+}
+
+/**
+ * Czeka na zadanie do wykonania przez wątek.
+ * @param[in,out] server Serwer.
+ * @return Zadanie lub NULL, jeśli serwer kończy działanie.
+ */
+struct job * take_job(struct server *server)
+{
+	pthread_mutex_lock(&server->lock);
+	while (server->todo == NULL && !server->stopping)
+		pthread_cond_wait(&server->ready, &server->lock);
+	struct job *job = NULL;
+	if (!server->stopping)
+	{
+		job = server->todo;
+		server->todo = job->next;
+	}
+	pthread_mutex_unlock(&server->lock);
+	return job;
+}
+
+/**
+ * Oddaje wykonane zadanie wątkowi głównemu i budzi go, jeśli nie ma
+ * jeszcze innych wykonanych zadań do odebrania.
+ * @param[in,out] server Serwer.
+ * @param[in] job Wykonane zadanie.
+ */
+void finish_job(struct server *server, struct job *job)
+{
+	pthread_mutex_lock(&server->lock);
+	bool wake = server->finished == NULL;
+	job->next = server->finished;
+	server->finished = job;
+	pthread_mutex_unlock(&server->lock);
+	if (wake)
+		while (write(server->wake[1], "", 1) < 0 && errno == EINTR)
+			;
+}
+
+/**
+ * Funkcja wątku puli: wykonuje kolejne zadania.
+ * @param[in] arg Sesja wątku (struct session).
+ * @return NULL.
+ */
+void * work(void *arg)
+{
+	struct session *session = arg;
+	struct job *job;
+	while ((job = take_job(session->server)) != NULL)
+	{
+		job->reply.size = 0;
+		session->out = &job->reply;
+		job->ok = answer(session, job->kind, job->request.data,
+						 job->request.size);
+		finish_job(session->server, job);
+	}
+	return NULL;
+}
+
+/**
+ * Zwalnia pamięć zadania.
+ * @param[in] job Zadanie.
+ */
+void free_job(struct job *job)
+{
+	free(job->request.data);
+	free(job->reply.data);
+	free(job);
+}
+
+/**
+ * Dodaje na koniec kolejki połączenia zadanie dla nowego żądania,
+ * używając ponownie nieużywanego zadania, jeśli jest.
+ * @param[in,out] server Serwer.
+ * @param[in,out] connection Połączenie.
+ * @return Zadanie lub NULL, jeśli zabrakło pamięci.
+ */
+struct job * new_job(struct server *server, struct connection *connection)
+{
+	struct job *job = server->spare;
+	if (job)
+		server->spare = job->next;
+	else if (!(job = calloc(1, sizeof(struct job))))
+		return NULL;
+	job->connection = connection;
+	job->next = job->later = NULL;
+	job->request.size = job->reply.size = 0;
+	job->ok = true;
+	job->done = false;
+	if (connection->last)
+		connection->last->later = job;
+	else
+		connection->first = job;
+	connection->last = job;
+	connection->jobs++;
+	return job;
+}
+
+/**
+ * Dzieli odebrane bajty połączenia na żądania i przekazuje je wątkom
+ * puli, dopóki połączenie nie ma CONNECTION_JOBS żądań bez odpowiedzi.
+ * Na zbyt długą ramkę odpowiada błędem i przestaje czytać połączenie.
+ * @param[in,out] server Serwer.
+ * @param[in,out] connection Połączenie.
+ */
+void dispatch(struct server *server, struct connection *connection)
+{
+	static const char too_long[] = "frame too long";
+	struct job *first = NULL, *last = NULL;
+	size_t used = 0;
+	long frame;
+	char kind;
+	const char *payload;
+	size_t len;
+	while (!connection->broken && connection->jobs < CONNECTION_JOBS
+		   && used < connection->in.size
+		   && (frame = frame_parse(connection->in.data + used,
+								   connection->in.size - used, &kind,
+								   &payload, &len)) != 0)
+	{
+		struct job *job = new_job(server, connection);
+		if (!job)
+		{
+			connection->broken = true;
+			break;
+		}
+		if (frame < 0)
+		{
+			job->ok = frame_append(&job->reply, PROTOCOL_ERROR, too_long,
+								   sizeof(too_long) - 1);
+			job->done = true;
+			connection->reading = false;
+			used = connection->in.size;
+			break;
+		}
+		used += frame;
+		job->kind = kind;
+		if (len > 0 && !buffer_append(&job->request, payload, len))
+		{
+			job->ok = false;
+			job->done = true;
+			break;
+		}
+		if (last)
+			last->next = job;
+		else
+			first = job;
+		last = job;
+	}
+	if (used > 0)
+	{
+		memmove(connection->in.data, connection->in.data + used,
+				connection->in.size - used);
+		connection->in.size -= used;
+	}
+	if (first)
+	{
+		pthread_mutex_lock(&server->lock);
+		if (server->todo)
+			server->todo_last->next = first;
+		else
+			server->todo = first;
+		server->todo_last = last;
+		if (first == last)
+			pthread_cond_signal(&server->ready);
+		else
+			pthread_cond_broadcast(&server->ready);
+		pthread_mutex_unlock(&server->lock);
+	}
+}
+
+/**
+ * Odbiera od wątków puli wykonane zadania.
+ * @param[in,out] server Serwer.
+ */
+void collect(struct server *server)
+{
+	char bytes[64];
+	while (read(server->wake[0], bytes, sizeof(bytes)) > 0)
+		;
+	pthread_mutex_lock(&server->lock);
+	struct job *job = server->finished;
+	server->finished = NULL;
+	pthread_mutex_unlock(&server->lock);
+	for (; job; job = job->next)
+		job->done = true;
+}
+
+/**
+ * Przenosi do bufora wyjściowego połączenia gotowe odpowiedzi na
+ * najstarsze żądania i wysyła z niego tyle, ile się da bez czekania.
+ * @param[in,out] server Serwer.
+ * @param[in,out] connection Połączenie.
+ */
+void respond(struct server *server, struct connection *connection)
+{
+	struct job *job;
+	while ((job = connection->first) != NULL && job->done)
+	{
+		connection->first = job->later;
+		if (!connection->first)
+			connection->last = NULL;
+		connection->jobs--;
+		if (!job->ok)
+			connection->broken = true;
+		else if (!connection->broken && connection->out.size == 0)
+		{
+			/* Zamiana buforów oszczędza kopiowania odpowiedzi. */
+			struct buffer out = connection->out;
+			connection->out = job->reply;
+			job->reply = out;
+		}
+		else if (!connection->broken
+				 && !buffer_append(&connection->out, job->reply.data,
+								   job->reply.size))
+			connection->broken = true;
+		job->next = server->spare;
+		server->spare = job;
+	}
+	while (!connection->broken && connection->sent < connection->out.size)
+	{
+		ssize_t n = write(connection->fd,
+						  connection->out.data + connection->sent,
+						  connection->out.size - connection->sent);
+		if (n > 0)
+			connection->sent += n;
+		else if (n < 0 && errno == EINTR)
+			continue;
+		else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+		else
+			connection->broken = true;
+	}
+	if (connection->sent == connection->out.size || connection->broken)
+		connection->out.size = connection->sent = 0;
+}
+
+/**
+ * Czyta z połączenia dostępne bajty.
+ * @param[in,out] connection Połączenie.
+ */
+void receive(struct connection *connection)
+{
+	if (!buffer_reserve(&connection->in, READ_BLOCK))
+	{
+		connection->broken = true;
+		return;
+	}
+	ssize_t n = read(connection->fd, connection->in.data + connection->in.size,
+					 READ_BLOCK);
+	if (n > 0)
+		connection->in.size += n;
+	else if (n == 0)
+		connection->reading = false;
+	else if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+		connection->broken = true;
+}
+
+/**
+ * Zamyka połączenie i zwalnia jego pamięć razem z zadaniami.
+ * @param[in] connection Połączenie.
+ */
+void close_connection(struct connection *connection)
+{
+	close(connection->fd);
+	while (connection->first)
+	{
+		struct job *job = connection->first;
+		connection->first = job->later;
+		free_job(job);
+	}
+	free(connection->in.data);
+	free(connection->out.data);
+	free(connection);
+}
+
+/**
+ * Przyjmuje wszystkie czekające połączenia.
+ * @param[in,out] server Serwer.
+ * @param[in] listener Gniazdo nasłuchujące.
+ */
+void accept_connections(struct server *server, int listener)
+{
+	int fd;
+	while ((fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK)) >= 0)
+	{
+		if (server->connection_count == server->connection_capacity)
+		{
+			size_t capacity = 2 * server->connection_capacity + 16;
+			struct connection **connections = realloc(server->connections,
+				capacity * sizeof(struct connection *));
+			if (connections)
+				server->connections = connections;
+			struct pollfd *polled = realloc(server->polled,
+				(capacity + 2) * sizeof(struct pollfd));
+			if (polled)
+				server->polled = polled;
+			if (!connections || !polled)
+			{
+				close(fd);
+				continue;
+			}
+			server->connection_capacity = capacity;
+		}
+		struct connection *connection = calloc(1, sizeof(struct connection));
+		if (!connection)
+		{
+			close(fd);
+			continue;
+		}
+		connection->fd = fd;
+		connection->reading = true;
+		server->connections[server->connection_count++] = connection;
+	}
+}
+
+/**
+ * Tworzy gniazdo lokalne nasłuchujące pod podaną ścieżką, usuwając
+ * pozostały po poprzednim uruchomieniu plik gniazda.
+ * @param[in] path Ścieżka gniazda.
+ * @return Deskryptor gniazda lub -1, jeśli operacja się nie powiedzie.
+ */
+int open_listener(const char *path)
+{
+	struct sockaddr_un address;
+	if (strlen(path) >= sizeof(address.sun_path))
+		return -1;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (fd < 0)
+		return -1;
+	unlink(path);
+	if (bind(fd, (struct sockaddr *) &address, sizeof(address))
+		|| listen(fd, LISTEN_BACKLOG))
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/**
+ * Wczytuje słownik tak jak dict-check: w postaci binarnej lub tekstowej,
+ * razem z indeksem podpowiedzi i dziennikiem zmian zapisanymi obok.
+ * @param[in] filename Ścieżka słownika.
+ * @return Słownik lub NULL, jeśli operacja się nie powiedzie.
+ */
+struct dictionary * load_dictionary(const char *filename)
+{
+	struct dictionary *dict = dictionary_load_mmap(filename);
+	if (!dict)
+	{
+		FILE *f = fopen(filename, "r");
+		if (!f)
+			return NULL;
+		dict = dictionary_load(f);
+		fclose(f);
+		if (!dict)
+			return NULL;
+	}
+	char *index_name = malloc(strlen(filename) + sizeof(".idx"));
+	sprintf(index_name, "%s.idx", filename);
+	FILE *f = fopen(index_name, "r");
+	if (f)
+	{
+		dictionary_load_hint_index(dict, f);
+		fclose(f);
+	}
+	free(index_name);
+	if (journal_replay(dict, filename) < 0)
+	{
+		dictionary_done(dict);
+		return NULL;
+	}
+	return dict;
+}
+
+/**
+ * Pętla wątku głównego: przyjmuje połączenia, czyta żądania, przekazuje
+ * je wątkom puli i wysyła odpowiedzi, dopóki nie przyjdzie sygnał
+ * zakończenia działania.
+ * @param[in,out] server Serwer.
+ * @param[in] listener Gniazdo nasłuchujące.
+ * @param[in] signals Maska sygnałów na czas czekania; poza czekaniem
+ * sygnały zakończenia działania są zablokowane.
+ */
+void event_loop(struct server *server, int listener, const sigset_t *signals)
+{
+	while (!stop_requested)
+	{
+		size_t count = server->connection_count;
+		struct pollfd *polled = server->polled;
+		polled[0] = (struct pollfd) { server->wake[0], POLLIN, 0 };
+		polled[1] = (struct pollfd) { listener, POLLIN, 0 };
+		for (size_t i = 0; i < count; i++)
+		{
+			struct connection *connection = server->connections[i];
+			short events = 0;
+			if (connection->reading && connection->jobs < CONNECTION_JOBS
+				&& connection->out.size - connection->sent < OUTPUT_LIMIT)
+				events |= POLLIN;
+			if (connection->sent < connection->out.size)
+				events |= POLLOUT;
+			polled[i + 2] = (struct pollfd) { connection->fd, events, 0 };
+		}
+		if (ppoll(polled, count + 2, NULL, signals) < 0)
+			continue;
+		if (polled[0].revents)
+			collect(server);
+		for (size_t i = 0; i < count; i++)
+		{
+			struct connection *connection = server->connections[i];
+			if (polled[i + 2].revents & (POLLERR | POLLHUP))
+				connection->broken = true;
+			else if (polled[i + 2].revents & POLLIN)
+				receive(connection);
+		}
+		if (polled[1].revents & POLLIN)
+			accept_connections(server, listener);
+		for (size_t i = server->connection_count; i-- > 0; )
+		{
+			struct connection *connection = server->connections[i];
+			/* Odpowiedzi zwalniają miejsce na żądania czekające
+			   w buforze, a odpowiedź na błąd ramki jest gotowa od razu. */
+			respond(server, connection);
+			dispatch(server, connection);
+			respond(server, connection);
+			if (connection->jobs == 0 && (connection->broken
+				|| (!connection->reading && connection->out.size == 0)))
+			{
+				close_connection(connection);
+				server->connections[i] =
+					server->connections[--server->connection_count];
+			}
+		}
+	}
+}
+
+/**@}*/
+
+/**
+ * Funkcja main.
+ * Poprawne wywołanie programu to:
+ * ./dict-server [-j N] dict socket
+ * Serwer wczytuje słownik raz i odpowiada na żądania przychodzące przez
+ * gniazdo lokalne `socket` na N wątkach (domyślnie tylu, ile jest
+ * procesorów). SIGINT lub SIGTERM kończy działanie serwera.
+ */
+int main(int argc, char *argv[])
+{
+	long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+	int i = 1;
+	if (argc > 2 && strcmp(argv[1], "-j") == 0)
+	{
+		thread_count = atoi(argv[2]);
+		i = 3;
+	}
+	if (argc - i != 2 || thread_count <= 0)
+	{
+		printf("usage: %s [-j N] dict socket\n", argv[0]);
+		return 0;
+	}
+	setlocale(LC_ALL, "pl_PL.UTF-8");
+	struct server server;
+	server.dict = load_dictionary(argv[i]);
+	if (!server.dict)
+	{
+		fprintf(stderr, "Failed to load dictionary\n");
+		exit(1);
+	}
+	int listener = open_listener(argv[i + 1]);
+	if (listener < 0)
+	{
+		fprintf(stderr, "Failed to listen on %s\n", argv[i + 1]);
+		exit(1);
+	}
+	/* Sygnały odbiera tylko wątek główny, przerywając ppoll(). */
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = on_signal;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+	sigset_t blocked, previous;
+	sigemptyset(&blocked);
+	sigaddset(&blocked, SIGINT);
+	sigaddset(&blocked, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+
+	pthread_mutex_init(&server.lock, NULL);
+	pthread_cond_init(&server.ready, NULL);
+	server.todo = server.todo_last = server.finished = server.spare = NULL;
+	server.stopping = 0;
+	server.connections = NULL;
+	server.connection_count = server.connection_capacity = 0;
+	server.polled = malloc(2 * sizeof(struct pollfd));
+	struct session *sessions = calloc(thread_count, sizeof(struct session));
+	pthread_t *threads = calloc(thread_count, sizeof(pthread_t));
+	if (!server.polled || !sessions || !threads
+		|| pipe2(server.wake, O_NONBLOCK))
+	{
+		fprintf(stderr, "Failed to create thread pool\n");
+		exit(1);
+	}
+	for (long t = 0; t < thread_count; t++)
+	{
+		struct session *session = &sessions[t];
+		session->server = &server;
+		session->cache = hint_cache_new(HINT_CACHE_SIZE);
+		word_list_init(&session->hints);
+		if (!session->cache || !tokenizer_init(&session->tokenizer, NULL))
+		{
+			fprintf(stderr, "Failed to create thread pool\n");
+			exit(1);
+		}
+		/* Tekst żądania nie ciągnie się dalej, więc jego ostatnie słowo
+		   też sprawdzamy. */
+		session->tokenizer.last_word = true;
+		if (pthread_create(&threads[t], NULL, work, session))
+		{
+			fprintf(stderr, "Failed to create thread pool\n");
+			exit(1);
+		}
+	}
+
+	event_loop(&server, listener, &previous);
+
+	close(listener);
+	unlink(argv[i + 1]);
+	pthread_mutex_lock(&server.lock);
+	server.stopping = 1;
+	pthread_cond_broadcast(&server.ready);
+	pthread_mutex_unlock(&server.lock);
+	for (long t = 0; t < thread_count; t++)
+	{
+		pthread_join(threads[t], NULL);
+		hint_cache_done(sessions[t].cache);
+		word_list_done(&sessions[t].hints);
+		tokenizer_done(&sessions[t].tokenizer);
+		free(sessions[t].word);
+	}
+	for (size_t c = 0; c < server.connection_count; c++)
+		close_connection(server.connections[c]);
+	while (server.spare)
+	{
+		struct job *job = server.spare;
+		server.spare = job->next;
+		free_job(job);
+	}
+	close(server.wake[0]);
+	close(server.wake[1]);
+	pthread_cond_destroy(&server.ready);
+	pthread_mutex_destroy(&server.lock);
+	free(server.connections);
+	free(server.polled);
+	free(sessions);
+	free(threads);
+	dictionary_done(server.dict);
+	return 0;
+}
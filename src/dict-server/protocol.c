@@ -0,0 +1,128 @@
+/** @file
+  Implementacja protokołu serwera dict-server.
+  @ingroup dict-server
+  @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+  @date 2015-07-26
+ */
+
+#include "protocol.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** @name Funkcje pomocnicze
+  @{
+ */
+
+/**
+ * Zapisuje liczbę w kolejności sieciowej.
+ * @param[out] out Bufor na 4 bajty.
+ * @param[in] value Liczba.
+ */
+static void put_length(char *out, uint32_t value)
+{
+	out[0] = (char) (value >> 24);
+	out[1] = (char) (value >> 16);
+	out[2] = (char) (value >> 8);
+	out[3] = (char) value;
+}
+
+/**
+ * Odczytuje liczbę zapisaną w kolejności sieciowej.
+ * @param[in] in 4 bajty.
+ * @return Liczba.
+ */
+static uint32_t get_length(const char *in)
+{
+	const unsigned char *u = (const unsigned char *) in;
+	return (uint32_t) u[0] << 24 | (uint32_t) u[1] << 16
+		| (uint32_t) u[2] << 8 | u[3];
+}
+
+/**@}*/
+/** @name Elementy interfejsu
+  @{
+ */
+
+bool buffer_reserve(struct buffer *buffer, size_t extra)
+{
+	if (buffer->size + extra <= buffer->capacity)
+		return true;
+	size_t capacity = 2 * (buffer->size + extra) + 4096;
+	char *data = realloc(buffer->data, capacity);
+	if (data == NULL)
+		return false;
+	buffer->data = data;
+	buffer->capacity = capacity;
+	return true;
+}
+
+bool buffer_append(struct buffer *buffer, const void *data, size_t len)
+{
+	if (!buffer_reserve(buffer, len))
+		return false;
+	memcpy(buffer->data + buffer->size, data, len);
+	buffer->size += len;
+	return true;
+}
+
+bool frame_begin(struct buffer *buffer, enum protocol_kind kind,
+				 size_t *start)
+{
+	if (!buffer_reserve(buffer, PROTOCOL_HEADER))
+		return false;
+	*start = buffer->size;
+	buffer->data[buffer->size + 4] = (char) kind;
+	buffer->size += PROTOCOL_HEADER;
+	return true;
+}
+
+void frame_end(struct buffer *buffer, size_t start)
+{
+	put_length(buffer->data + start, buffer->size - start - 4);
+}
+
+bool frame_append(struct buffer *buffer, enum protocol_kind kind,
+				  const void *data, size_t len)
+{
+	size_t start;
+	if (!frame_begin(buffer, kind, &start) || !buffer_append(buffer, data, len))
+		return false;
+	frame_end(buffer, start);
+	return true;
+}
+
+long frame_parse(const char *data, size_t size, char *kind,
+				 const char **payload, size_t *len)
+{
+	if (size < 4)
+		return 0;
+	uint32_t length = get_length(data);
+	if (length == 0 || length > PROTOCOL_MAX_FRAME)
+		return -1;
+	if (size < 4 + (size_t) length)
+		return 0;
+	*kind = data[4];
+	*payload = data + PROTOCOL_HEADER;
+	*len = length - 1;
+	return 4 + (long) length;
+}
+
+bool write_all(int fd, const char *data, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t written = write(fd, data, len);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return false;
+		data += written;
+		len -= written;
+	}
+	return true;
+}
+
+/**@}*/
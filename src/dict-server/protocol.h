@@ -0,0 +1,135 @@
+/** @file
+    Interfejs protokołu serwera dict-server.
+
+    Każde żądanie i każda odpowiedź to ramka: długość reszty ramki
+    (4 bajty, kolejność sieciowa), bajt rodzaju i treść. Słowa i teksty
+    zapisane są w kodowaniu locale, tak jak wejście dict-check.
+
+    Żądania:
+      - PROTOCOL_FIND ze słowem; odpowiedź ma jeden bajt, 1 jeśli słowo
+        jest w słowniku, 0 w p.p.,
+      - PROTOCOL_HINTS ze słowem; odpowiedzią są podpowiedzi oddzielone
+        pojedynczymi spacjami, posortowane jak w dict-check,
+      - PROTOCOL_CHECK z tekstem; odpowiedzią jest tekst z '#' przed
+        każdym słowem spoza słownika, tak jak wyjście dict-check, także
+        przed słowem kończącym tekst; tekst z niepoprawnym ciągiem bajtów
+        dostaje odpowiedź PROTOCOL_ERROR.
+
+    Odpowiedź ma rodzaj żądania albo PROTOCOL_ERROR z opisem błędu.
+    Klient może wysłać wiele żądań bez czekania na odpowiedzi;
+    odpowiedzi przychodzą w kolejności żądań.
+
+    @ingroup dict-server
+    @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+    @date 2015-07-26
+ */
+
+#ifndef __PROTOCOL_H__
+#define __PROTOCOL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+  Rozmiar nagłówka ramki: długość i rodzaj.
+  */
+#define PROTOCOL_HEADER 5
+
+/**
+  Największa dopuszczalna długość ramki bez pola długości.
+  */
+#define PROTOCOL_MAX_FRAME (1 << 20)
+
+/**
+  Rodzaje ramek.
+  */
+enum protocol_kind
+{
+    PROTOCOL_FIND = 'f', ///< Wyszukanie słowa.
+    PROTOCOL_HINTS = 'h', ///< Podpowiedzi do słowa.
+    PROTOCOL_CHECK = 'c', ///< Sprawdzenie tekstu.
+    PROTOCOL_ERROR = 'e' ///< Błąd żądania.
+};
+
+/**
+  Bufor bajtów, rosnący geometrycznie.
+  */
+struct buffer
+{
+    /// Bajty bufora.
+    char *data;
+    /// Liczba zajętych bajtów.
+    size_t size;
+    /// Rozmiar bufora.
+    size_t capacity;
+};
+
+/**
+  Zapewnia miejsce na dodatkowe bajty w buforze.
+  @param[in,out] buffer Bufor.
+  @param[in] extra Liczba dodatkowych bajtów.
+  @return true jeśli się udało, false jeśli zabrakło pamięci.
+  */
+bool buffer_reserve(struct buffer *buffer, size_t extra);
+
+/**
+  Dopisuje bajty do bufora.
+  @param[in,out] buffer Bufor.
+  @param[in] data Bajty.
+  @param[in] len Liczba bajtów.
+  @return true jeśli się udało, false jeśli zabrakło pamięci.
+  */
+bool buffer_append(struct buffer *buffer, const void *data, size_t len);
+
+/**
+  Zaczyna ramkę na końcu bufora. Treść ramki dopisuje się potem
+  za pomocą buffer_append(), a ramkę zamyka frame_end().
+  @param[in,out] buffer Bufor.
+  @param[in] kind Rodzaj ramki.
+  @param[out] start Początek ramki w buforze.
+  @return true jeśli się udało, false jeśli zabrakło pamięci.
+  */
+bool frame_begin(struct buffer *buffer, enum protocol_kind kind,
+                 size_t *start);
+
+/**
+  Zamyka ramkę rozpoczętą przez frame_begin(), wpisując jej długość.
+  @param[in,out] buffer Bufor.
+  @param[in] start Początek ramki w buforze.
+  */
+void frame_end(struct buffer *buffer, size_t start);
+
+/**
+  Dopisuje do bufora całą ramkę.
+  @param[in,out] buffer Bufor.
+  @param[in] kind Rodzaj ramki.
+  @param[in] data Treść.
+  @param[in] len Długość treści.
+  @return true jeśli się udało, false jeśli zabrakło pamięci.
+  */
+bool frame_append(struct buffer *buffer, enum protocol_kind kind,
+                  const void *data, size_t len);
+
+/**
+  Odczytuje ramkę z początku danych.
+  @param[in] data Dane.
+  @param[in] size Liczba bajtów danych.
+  @param[out] kind Rodzaj ramki.
+  @param[out] payload Początek treści.
+  @param[out] len Długość treści.
+  @return Długość całej ramki, 0 jeśli dane nie zawierają jeszcze całej
+  ramki, -1 jeśli ramka jest dłuższa niż PROTOCOL_MAX_FRAME lub pusta.
+  */
+long frame_parse(const char *data, size_t size, char *kind,
+                 const char **payload, size_t *len);
+
+/**
+  Zapisuje do deskryptora wszystkie bajty.
+  @param[in] fd Deskryptor.
+  @param[in] data Bajty.
+  @param[in] len Liczba bajtów.
+  @return true jeśli się udało, false w p.p.
+  */
+bool write_all(int fd, const char *data, size_t len);
+
+#endif /* __PROTOCOL_H__ */
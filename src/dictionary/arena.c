@@ -0,0 +1,207 @@
+/** @file
+  Implementacja areny pamięci.
+
+  @ingroup dictionary
+  @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+  @date 2015-06-07
+ */
+
+#include "arena.h"
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+  Rozmiar pojedynczego slabu w bajtach.
+  Bloki większe niż połowa slabu dostają własny slab.
+ */
+#define SLAB_SIZE (64 * 1024)
+
+/**
+  Najmniejsza klasa rozmiaru.
+  Wolny blok musi pomieścić wskaźnik na następny wolny blok.
+ */
+#define MIN_CLASS 3
+
+/**
+  Nagłówek slabu.
+ */
+struct arena_slab
+{
+	struct arena_slab *next; ///< Następny slab na liście.
+	size_t size; ///< Rozmiar obszaru danych.
+};
+
+/** @name Funkcje pomocnicze
+  @{
+ */
+
+/**
+ * Wyznacza klasę rozmiaru dla bloku o podanym rozmiarze.
+ * @param[in] size Rozmiar bloku.
+ * @return Najmniejsze `c` takie, że `2^c` >= `size`.
+ */
+static unsigned size_class(size_t size)
+{
+	unsigned c = MIN_CLASS;
+	while (((size_t) 1 << c) < size)
+		c++;
+	return c;
+}
+
+/**
+ * Zwraca początek obszaru danych slabu.
+ * @param[in] slab Slab.
+ * @return Wskaźnik na dane.
+ */
+static char * slab_data(struct arena_slab *slab)
+{
+	return (char *) slab + sizeof(struct arena_slab);
+}
+
+/**
+ * Przydziela nowy slab i dołącza go do listy slabów areny.
+ * @param[in,out] arena Arena.
+ * @param[in] size Rozmiar obszaru danych.
+ * @return Nowy slab lub NULL, jeśli zabrakło pamięci.
+ */
+static struct arena_slab * new_slab(struct arena *arena, size_t size)
+{
+	struct arena_slab *slab = malloc(sizeof(struct arena_slab) + size);
+	if (slab == NULL)
+		return NULL;
+	slab->size = size;
+	slab->next = arena->slabs;
+	arena->slabs = slab;
+	return slab;
+}
+
+/**
+ * Rozdziela resztkę bieżącego slabu na listy wolnych bloków,
+ * aby nie marnować jej przy przejściu do nowego slabu.
+ * @param[in,out] arena Arena.
+ */
+static void release_tail(struct arena *arena)
+{
+	size_t left = arena->free_end - arena->free_begin;
+	for (unsigned c = size_class(SLAB_SIZE); c >= MIN_CLASS; c--)
+	{
+		size_t block = (size_t) 1 << c;
+		if (left >= block)
+		{
+			arena_free(arena, arena->free_begin, block);
+			arena->free_begin += block;
+			left -= block;
+		}
+	}
+	arena->free_begin = arena->free_end = NULL;
+}
+
+/**@}*/
+/** @name Elementy interfejsu
+  @{
+ */
+
+void arena_init(struct arena *arena)
+{
+	arena->slabs = NULL;
+	arena->free_begin = arena->free_end = NULL;
+	for (int c = 0; c < ARENA_CLASSES; c++)
+		arena->free_lists[c] = NULL;
+}
+
+void arena_done(struct arena *arena)
+{
+	struct arena_slab *slab = arena->slabs;
+	while (slab)
+	{
+		struct arena_slab *next = slab->next;
+		free(slab);
+		slab = next;
+	}
+	arena_init(arena);
+}
+
+void * arena_alloc(struct arena *arena, size_t size)
+{
+	unsigned c = size_class(size);
+	if (c >= ARENA_CLASSES)
+		return NULL;
+	STATS_ADD(allocations, 1);
+	STATS_ADD(allocated_bytes, (size_t) 1 << c);
+	void *block = arena->free_lists[c];
+	if (block != NULL)
+	{
+		arena->free_lists[c] = *(void **) block;
+		return block;
+	}
+	size_t block_size = (size_t) 1 << c;
+	if (block_size > SLAB_SIZE / 2)
+	{
+		struct arena_slab *slab = new_slab(arena, block_size);
+		return slab ? slab_data(slab) : NULL;
+	}
+	if ((size_t) (arena->free_end - arena->free_begin) < block_size)
+	{
+		release_tail(arena);
+		struct arena_slab *slab = new_slab(arena, SLAB_SIZE);
+		if (slab == NULL)
+			return NULL;
+		arena->free_begin = slab_data(slab);
+		arena->free_end = arena->free_begin + SLAB_SIZE;
+	}
+	block = arena->free_begin;
+	arena->free_begin += block_size;
+	return block;
+}
+
+void arena_free(struct arena *arena, void *ptr, size_t size)
+{
+	if (ptr == NULL)
+		return;
+	unsigned c = size_class(size);
+	*(void **) ptr = arena->free_lists[c];
+	arena->free_lists[c] = ptr;
+}
+
+void * arena_realloc(struct arena *arena, void *ptr, size_t old_size,
+                     size_t new_size)
+{
+	if (new_size == 0)
+	{
+		arena_free(arena, ptr, old_size);
+		return NULL;
+	}
+	if (ptr != NULL && size_class(old_size) == size_class(new_size))
+		return ptr;
+	void *block = arena_alloc(arena, new_size);
+	if (block == NULL)
+		return NULL;
+	if (ptr != NULL)
+	{
+		memcpy(block, ptr, old_size < new_size ? old_size : new_size);
+		arena_free(arena, ptr, old_size);
+	}
+	return block;
+}
+
+size_t arena_block_size(size_t size)
+{
+	return (size_t) 1 << size_class(size);
+}
+
+void arena_usage(const struct arena *arena, struct arena_usage *usage)
+{
+	usage->slab_bytes = usage->header_bytes = 0;
+	for (struct arena_slab *slab = arena->slabs; slab; slab = slab->next)
+	{
+		usage->slab_bytes += sizeof(struct arena_slab) + slab->size;
+		usage->header_bytes += sizeof(struct arena_slab);
+	}
+	usage->free_bytes = arena->free_end - arena->free_begin;
+	for (unsigned c = 0; c < ARENA_CLASSES; c++)
+		for (void *block = arena->free_lists[c]; block; block = *(void **) block)
+			usage->free_bytes += (size_t) 1 << c;
+}
+
+/**@}*/
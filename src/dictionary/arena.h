@@ -0,0 +1,111 @@
+/** @file
+    Interfejs areny pamięci dla węzłów słownika.
+
+    Arena przydziela pamięć z dużych bloków (slabów), a zwolnione
+    kawałki trzyma na listach wolnych bloków osobnych dla każdej klasy
+    rozmiaru (potęgi dwójki). Cała pamięć areny zwalniana jest naraz
+    przez arena_done(), w czasie proporcjonalnym do liczby slabów.
+
+    @ingroup dictionary
+    @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+    @date 2015-06-07
+ */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+/**
+  Liczba klas rozmiaru.
+  Klasa `c` obejmuje bloki rozmiaru `2^c` bajtów.
+  */
+#define ARENA_CLASSES 48
+
+/**
+  Struktura przechowująca arenę.
+  */
+struct arena
+{
+    /// Lista przydzielonych slabów.
+    struct arena_slab *slabs;
+    /// Początek wolnego miejsca w bieżącym slabie.
+    char *free_begin;
+    /// Koniec wolnego miejsca w bieżącym slabie.
+    char *free_end;
+    /// Listy wolnych bloków dla kolejnych klas rozmiaru.
+    void *free_lists[ARENA_CLASSES];
+};
+
+/**
+  Zajętość pamięci areny.
+  */
+struct arena_usage
+{
+    /// Pamięć wszystkich slabów razem z ich nagłówkami.
+    size_t slab_bytes;
+    /// Pamięć nagłówków slabów.
+    size_t header_bytes;
+    /// Wolne bloki i niewykorzystana reszta bieżącego slabu.
+    size_t free_bytes;
+};
+
+/**
+  Inicjuje arenę.
+  @param[in,out] arena Arena.
+  */
+void arena_init(struct arena *arena);
+
+/**
+  Zwalnia całą pamięć areny.
+  Wszystkie bloki przydzielone z areny przestają być ważne.
+  @param[in,out] arena Arena.
+  */
+void arena_done(struct arena *arena);
+
+/**
+  Przydziela blok pamięci.
+  @param[in,out] arena Arena.
+  @param[in] size Rozmiar bloku w bajtach, większy od zera.
+  @return Wskaźnik na blok lub NULL, jeśli zabrakło pamięci.
+  */
+void * arena_alloc(struct arena *arena, size_t size);
+
+/**
+  Zwraca blok do areny.
+  @param[in,out] arena Arena.
+  @param[in] ptr Blok przydzielony z tej areny lub NULL.
+  @param[in] size Rozmiar, z jakim blok został przydzielony.
+  */
+void arena_free(struct arena *arena, void *ptr, size_t size);
+
+/**
+  Zmienia rozmiar bloku.
+  Jeśli oba rozmiary należą do tej samej klasy, zwraca ten sam blok.
+  W p.p. przenosi zawartość do nowego bloku, a stary zwalnia.
+  @param[in,out] arena Arena.
+  @param[in] ptr Blok przydzielony z tej areny lub NULL.
+  @param[in] old_size Dotychczasowy rozmiar bloku (0 gdy `ptr` == NULL).
+  @param[in] new_size Nowy rozmiar bloku (0 oznacza zwolnienie).
+  @return Wskaźnik na blok, NULL gdy `new_size` == 0 lub zabrakło pamięci.
+  */
+void * arena_realloc(struct arena *arena, void *ptr, size_t old_size,
+                     size_t new_size);
+
+/**
+  Zwraca rozmiar bloku, który arena faktycznie przydziela na żądanie
+  podanego rozmiaru.
+  @param[in] size Żądany rozmiar bloku w bajtach.
+  @return Rozmiar bloku w bajtach.
+  */
+size_t arena_block_size(size_t size);
+
+/**
+  Liczy zajętość pamięci areny. Działa w czasie proporcjonalnym do
+  liczby slabów i wolnych bloków.
+  @param[in] arena Arena.
+  @param[out] usage Zajętość pamięci.
+  */
+void arena_usage(const struct arena *arena, struct arena_usage *usage);
+
+#endif /* __ARENA_H__ */
@@ -6,9 +6,21 @@
  */
 
 #include "dictionary.h"
+#include "arena.h"
+#include "graph.h"
+#include "hint_index.h"
+#include "stats.h"
+#include "symbol_table.h"
+#include "text_io.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define _GNU_SOURCE
 /**
@@ -17,28 +29,254 @@
  */
 
 #define NULL_MARKER L'#'
+
+/**
+  Największa długość skompresowanej ścieżki jednego węzła.
+ */
+#define PREFIX_MAX UINT8_MAX
+
+/**
+  Rodzaje węzłów drzewa, według największej liczby dzieci.
+ */
+enum node_kind
+{
+	NODE_0, ///< Liść bez dzieci.
+	NODE_4, ///< Do 4 dzieci, klucze posortowane obok wskaźników.
+	NODE_16, ///< Do 16 dzieci, klucze porównywane naraz instrukcjami SSE2.
+	NODE_48, ///< Do 48 dzieci, pozycja dziecka wskazywana przez kod klucza.
+	NODE_256 ///< Dziecko pod każdym kodem klucza.
+};
+
+/**
+  Węzeł drzewa TRIE, czyli nagłówek wspólny dla wszystkich rodzajów.
+  Węzeł odpowiada kluczowi krawędzi od ojca i `prefix_len` kolejnym
+  kodom skompresowanej ścieżki, zapisanym zaraz za strukturą swojego
+  rodzaju. Poza korzeniem węzeł, w którym nie kończy się słowo, ma
+  zwykle co najmniej dwoje dzieci; wyjątkiem są ścieżki słów dłuższych
+  niż PREFIX_MAX, których nie da się skleić w jeden węzeł.
+  Węzeł pamięta też największą wagę słowa w swoim poddrzewie, dzięki
+  czemu dictionary_complete() pomija poddrzewa bez dość częstych słów.
+ */
+struct node
+{
+	uint8_t kind; ///< Rodzaj węzła, enum node_kind.
+	uint8_t terminal; ///< Czy na końcu ścieżki kończy się słowo.
+	uint8_t prefix_len; ///< Długość skompresowanej ścieżki.
+	uint8_t count; ///< Ilość dzieci.
+	uint32_t weight; ///< Waga słowa kończącego się w węźle lub 0.
+	uint32_t max_weight; ///< Największa waga słowa w poddrzewie węzła.
+};
+
+/**
+  Węzeł z co najwyżej 4 dzieci.
+ */
+struct node4
+{
+	struct node header; ///< Nagłówek.
+	uint8_t keys[4]; ///< Posortowane kody kluczy dzieci.
+	struct node *children[4]; ///< Dzieci w kolejności kluczy.
+};
+
+/**
+  Węzeł z co najwyżej 16 dzieci.
+ */
+struct node16
+{
+	struct node header; ///< Nagłówek.
+	uint8_t keys[16]; ///< Posortowane kody kluczy dzieci.
+	struct node *children[16]; ///< Dzieci w kolejności kluczy.
+};
+
+/**
+  Węzeł z co najwyżej 48 dzieci.
+ */
+struct node48
+{
+	struct node header; ///< Nagłówek.
+	uint8_t index[SYMBOL_LIMIT]; ///< Pozycja dziecka + 1 dla każdego kodu lub 0.
+	struct node *children[48]; ///< Dzieci w dowolnej kolejności.
+};
+
+/**
+  Węzeł z miejscem na dziecko dla każdego kodu.
+ */
+struct node256
+{
+	struct node header; ///< Nagłówek.
+	struct node *children[SYMBOL_LIMIT]; ///< Dzieci według kodów lub NULL.
+};
+
+/**
+  Rozmiary struktur kolejnych rodzajów węzłów, bez skompresowanej ścieżki.
+ */
+static const size_t node_sizes[] = {
+	sizeof(struct node), sizeof(struct node4), sizeof(struct node16),
+	sizeof(struct node48), sizeof(struct node256)
+};
+
+/**
+  Największe ilości dzieci kolejnych rodzajów węzłów.
+ */
+static const unsigned node_capacity[] = { 0, 4, 16, 48, SYMBOL_LIMIT };
+
+/**
+  Ilości dzieci, przy których węzeł zamieniany jest na mniejszy rodzaj.
+  Są mniejsze niż pojemność mniejszego rodzaju, żeby wstawianie i usuwanie
+  na granicy nie zmieniało rodzaju za każdym razem.
+ */
+static const unsigned node_shrink[] = { 0, 0, 3, 12, 40 };
+
+/**
+  Epoka czytelnika, który w tej chwili nie czyta słownika.
+ */
+#define EPOCH_IDLE UINT64_MAX
+
+/**
+  Wersja słownika opublikowana dla czytelników: korzeń drzewa razem
+  z tablicą symboli, według której zapisane są jego klucze. Czytelnik
+  odczytuje ją jednym wskaźnikiem, więc zawsze widzi zgodną parę.
+ */
+struct version
+{
+	struct node *root; ///< Korzeń drzewa.
+	struct symbol_table *symbols; ///< Kody liter drzewa.
+};
+
+/**
+  Blok odłączony od opublikowanej wersji, który mogą jeszcze czytać
+  czytelnicy, którzy zaczęli czytać przed jego odłączeniem.
+ */
+struct retired
+{
+	void *block; ///< Blok.
+	size_t size; ///< Rozmiar bloku z areny lub 0 dla bloku z malloc().
+	uint64_t epoch; ///< Epoka, w której blok został odłączony.
+};
+
 /**
-  Maksymalna wielkość alfabetu, zawierającego tylko te litery,
-  które zawierają słowa występujące w słowniku.
+  Czytelnik słownika. Każdy czytelnik zajmuje osobną linię pamięci
+  podręcznej, żeby ogłaszanie epok przez różne wątki się nie zakłócało.
  */
+struct dictionary_reader
+{
+	uint64_t epoch; ///< Epoka, w której czytelnik zaczął czytać, lub EPOCH_IDLE.
+	struct dictionary *dict; ///< Słownik.
+	struct dictionary_reader *next; ///< Następny czytelnik słownika.
+} __attribute__((aligned(64)));
 
-#define ALPHABET_SIZE 100
 /**
-  Maksymalna ilość wszystkich możliwych
-  modyfikacji słowa dla dictionary_hints.
-*/
+  Stan słownika, który czytają inne wątki niż zmieniający go pisarz.
+  Pisarz nie zmienia węzłów widocznych dla czytelników: zmieniane węzły
+  kopiuje razem z drogą od korzenia, a nową wersję publikuje na końcu
+  zmiany. Odłączone bloki zwalniane są, gdy wszyscy czytający zaczęli
+  czytać w późniejszej epoce.
+ */
+struct shared_state
+{
+	struct version *version; ///< Opublikowana wersja.
+	uint64_t epoch; ///< Bieżąca epoka, zwiększana przy każdej publikacji.
+	pthread_mutex_t lock; ///< Chroni listę czytelników.
+	struct dictionary_reader *readers; ///< Lista czytelników.
+	struct retired *retired; ///< Odłączone bloki w kolejności epok.
+	size_t retired_size; ///< Liczba odłączonych bloków.
+	size_t retired_capacity; ///< Rozmiar tablicy odłączonych bloków.
+	struct node **fresh; ///< Węzły utworzone w bieżącej zmianie.
+	size_t fresh_size; ///< Liczba nowych węzłów.
+	size_t fresh_capacity; ///< Rozmiar tablicy nowych węzłów.
+	bool tree_private; ///< Czy w bieżącej zmianie skopiowano całe drzewo.
+	bool symbols_private; ///< Czy w bieżącej zmianie skopiowano tablicę symboli.
+};
 
-#define HINTS_SIZE (1000 * 1000)
+/**
+  Podsumowanie słów słownika, uaktualniane przy każdej zmianie, żeby
+  pytania o nie nie wymagały przeglądania słownika.
+ */
+struct summary
+{
+	bool ready; ///< Czy podsumowanie jest wyliczone.
+	size_t words; ///< Liczba słów.
+	uint64_t letters[SYMBOL_LIMIT]; ///< Liczby wystąpień liter według kodów.
+	size_t *lengths; ///< Liczby słów według długości.
+	size_t lengths_size; ///< Rozmiar tablicy `lengths`.
+	size_t max_length; ///< Długość najdłuższego słowa.
+};
 
 /**
   Struktura przechowująca słownik.
-  Implementacja na drzewie TRIE.
+  Implementacja na drzewie TRIE z węzłami kilku rodzajów o różnej
+  pojemności i ze skompresowanymi ścieżkami. Węzły pochodzą z areny
+  należącej do słownika.
+  Klucze węzłów są kodami liter z tablicy symboli słownika.
+  Słownik wczytany w postaci binarnej lub zamrożony przez
+  dictionary_freeze() trzymany jest jako graf tylko do odczytu; drzewo
+  odtwarzane jest z niego dopiero przy pierwszej zmianie.
+  Po zarejestrowaniu czytelnika pola `root` i `symbols` należą do pisarza,
+  a czytelnicy korzystają z wersji opublikowanej w `shared`.
  */
 struct dictionary
 {
-	wchar_t key; ///< Klucz.
-	struct dictionary **children; ///< Tablica wskaźników na dzieci.
-	int children_size; ///< Ilość dzieci.
+	struct node *root; ///< Korzeń drzewa lub NULL, jeśli słownik jest grafem.
+	struct arena arena; ///< Arena, z której pochodzą węzły.
+	struct symbol_table *symbols; ///< Kody liter występujących w drzewie.
+	struct graph *graph; ///< Graf tylko do odczytu lub NULL.
+	struct hint_index *index; ///< Indeks podpowiedzi lub NULL.
+	uint64_t generation; ///< Liczba zmian słownika.
+	struct shared_state *shared; ///< Stan współdzielenia lub NULL.
+	struct summary *summary; ///< Podsumowanie słów, tylko dla pisarza.
+};
+
+/**
+  Kursor wskazujący pozycję w słowniku niezależnie od jego reprezentacji.
+  Pozycja w drzewie to miejsce na skompresowanej ścieżce węzła, więc
+  każdej literze słowa odpowiada jeden krok kursora.
+ */
+struct cursor
+{
+	const struct node *node; ///< Węzeł drzewa lub NULL, jeśli słownik jest grafem.
+	uint32_t vertex; ///< Węzeł grafu.
+	uint32_t offset; ///< Liczba przebytych kodów ścieżki węzła drzewa.
+};
+
+/**
+  Ramka stosu używanego przy nierekurencyjnym przechodzeniu słownika.
+ */
+struct frame
+{
+	struct cursor cursor; ///< Pozycja w słowniku.
+	uint32_t index; ///< Pozycja następnego dziecka lub liczba pozostałych.
+};
+
+/**
+  Stos ramek, rosnący geometrycznie.
+  Dzięki niemu głębokość słownika nie jest ograniczona rozmiarem stosu
+  wywołań.
+ */
+struct stack
+{
+	struct frame *frames; ///< Tablica ramek.
+	size_t size; ///< Liczba ramek na stosie.
+	size_t capacity; ///< Rozmiar tablicy ramek.
+};
+
+/**
+  Liczba wyszukiwań prowadzonych na przemian przez dictionary_find_batch().
+ */
+#define FIND_LANES 16
+
+/**
+  Rozmiar bufora podpowiedzi na stosie dictionary_hints(); dla dłuższych
+  słów bufor jest przydzielany.
+ */
+#define HINT_BUFFER_SIZE 64
+
+/**
+  Stan jednego wyszukiwania prowadzonego przez dictionary_find_batch().
+ */
+struct find_lane
+{
+	const wchar_t *word; ///< Reszta szukanego słowa.
+	const struct node *node; ///< Bieżący węzeł drzewa.
+	size_t slot; ///< Numer słowa w tablicy wyników.
 };
 
 /** @name Funkcje pomocnicze
@@ -46,462 +284,2721 @@ struct dictionary
  */
 
 /**
- * Tworzy węzeł o podanym kluczu 'key'.
- * @param[in] key Klucz.
- * @return Wskaźnik na utworzony węzeł.
+ * Zwraca skompresowaną ścieżkę węzła.
+ * @param[in] node Węzeł.
+ * @return Kody ścieżki.
  */
-static struct dictionary * create_node(wchar_t key)
+static uint8_t * node_prefix(const struct node *node)
 {
-	struct dictionary *node =
-		(struct dictionary *) malloc(sizeof(struct dictionary));
-	node->key = key;
-	node->children = NULL;
-	node->children_size = 0;
-	return node;
+	return (uint8_t *) node + node_sizes[node->kind];
+}
+
+/**
+ * Zwraca rozmiar bloku zajmowanego przez węzeł.
+ * @param[in] node Węzeł.
+ * @return Rozmiar w bajtach.
+ */
+static size_t node_size(const struct node *node)
+{
+	return node_sizes[node->kind] + node->prefix_len;
+}
+
+/**
+ * Zwraca tablicę kluczy węzła z posortowanymi kluczami (NODE_4 lub NODE_16).
+ * @param[in] node Węzeł.
+ * @return Klucze.
+ */
+static uint8_t * sorted_keys(const struct node *node)
+{
+	if (node->kind == NODE_4)
+		return ((struct node4 *) node)->keys;
+	return ((struct node16 *) node)->keys;
 }
 
 /**
-  Czyszczenie pamięci słownika.
-  @param[in,out] dict Słownik.
+ * Zwraca tablicę dzieci węzła z posortowanymi kluczami (NODE_4 lub NODE_16).
+ * @param[in] node Węzeł.
+ * @return Dzieci.
  */
-static void dictionary_free(struct dictionary *dict)
+static struct node ** sorted_children(const struct node *node)
 {
-	for(int i = 0; i < dict->children_size; i++)
+	if (node->kind == NODE_4)
+		return ((struct node4 *) node)->children;
+	return ((struct node16 *) node)->children;
+}
+
+/**
+ * Odkłada blok do zwolnienia, gdy nie będzie go już czytał żaden
+ * czytelnik.
+ * @param[in,out] dict Współdzielony słownik.
+ * @param[in] block Blok.
+ * @param[in] size Rozmiar bloku z areny lub 0 dla bloku z malloc().
+ */
+static void retire(struct dictionary *dict, void *block, size_t size)
+{
+	struct shared_state *shared = dict->shared;
+	if (shared->retired_size == shared->retired_capacity)
 	{
-		dictionary_free(*(dict->children + i));
+		size_t capacity = 2 * shared->retired_capacity + 64;
+		struct retired *retired =
+			realloc(shared->retired, capacity * sizeof(struct retired));
+		assert(retired != NULL);
+		shared->retired = retired;
+		shared->retired_capacity = capacity;
 	}
-	free(dict->children);
-	free(dict);
+	struct retired *entry = &shared->retired[shared->retired_size++];
+	entry->block = block;
+	entry->size = size;
+	entry->epoch = shared->epoch;
 }
 
 /**
- * Zwraca czy słowo 'word' znajduje się w liście słów
- * @param[in] list Lista słów
- * @param[in] word Słowo.
- * @return True jeśli słowo znajduje się w liście słów, false w p.p.
+ * Sprawdza, czy pisarz może zmieniać węzeł w miejscu, czyli czy węzeł
+ * nie jest widoczny dla czytelników.
+ * @param[in] dict Słownik.
+ * @param[in] node Węzeł.
+ * @return Wartość logiczna.
  */
-static bool word_list_find(const struct word_list *list, const wchar_t* word)
+static bool is_fresh(const struct dictionary *dict, const struct node *node)
 {
-	const wchar_t * const * a = word_list_get(list);
-	for (size_t i = 0; i < word_list_size(list); i++)
-		if (!wcscmp(a[i], word))
+	const struct shared_state *shared = dict->shared;
+	if (shared == NULL || shared->tree_private)
+		return true;
+	/* Nowych węzłów jednej zmiany jest tyle, ile wynosi długość drogi. */
+	for (size_t i = 0; i < shared->fresh_size; i++)
+		if (shared->fresh[i] == node)
 			return true;
 	return false;
 }
 
 /**
- * Wstawia dziecko do węzła 'dict', w kolejnosci leksykograficznej po kluczu
- * 'key' dziecka.
- * Uwaga: w 'dict'->children nie może byc węzła o 'key' == 'child'->key.
- * @param[in,out] dict Węzeł słownika.
- * @param[in] child Wstawiany węzeł.
+ * Zapamiętuje węzeł utworzony w bieżącej zmianie współdzielonego słownika.
+ * @param[in,out] dict Słownik.
+ * @param[in] node Nowy węzeł.
  */
-static void put_child(struct dictionary *dict, struct dictionary *child)
+static void mark_fresh(struct dictionary *dict, struct node *node)
 {
-	if (child == NULL)
+	struct shared_state *shared = dict->shared;
+	if (shared == NULL || shared->tree_private)
 		return;
-	int children_size = dict->children_size;
-	if (dict->children_size == 0)
-	{
-		dict->children = malloc(sizeof(struct dictionary *));
-		*dict->children = child;
-		dict->children_size++;
-	}
-	else
+	if (shared->fresh_size == shared->fresh_capacity)
 	{
-		dict->children = realloc(dict->children,
-			(children_size + 1) * sizeof(struct dictionary *));
-		assert(dict->children != NULL);
-		int i = children_size;
-		/* co jak == ? */
-		while (i > 0 &&
-			   wcscmp(&(*(dict->children + i - 1))->key, &child->key) > 0)
-		{
-			*(dict->children + i) = *(dict->children + i - 1);
-			i--;
-		}
-		*(dict->children + i) = child;
-		dict->children_size++;
+		size_t capacity = 2 * shared->fresh_capacity + 16;
+		struct node **fresh =
+			realloc(shared->fresh, capacity * sizeof(struct node *));
+		assert(fresh != NULL);
+		shared->fresh = fresh;
+		shared->fresh_capacity = capacity;
 	}
+	shared->fresh[shared->fresh_size++] = node;
 }
 
 /**
- * Zwraca czy w tablicy dzieci węzła 'dict', znajduje się dziecko o danym
- * kluczu 'key'.
- * @param[in] dict Węzeł słownika.
- * @param[in,out] found Wskażnik na dziecko.
- * @param[in] key Klucz.
- * @return True jeśli taki węzeł znajduje się, a na 'found' zapisywany
- * jest wskażnik na to dziecko. false i 'found' = NULL w p.p.
+ * Tworzy węzeł bez dzieci z miejscem na skompresowaną ścieżkę, którą
+ * wypełnia wołający.
+ * @param[in,out] dict Słownik, z którego areny pochodzi węzeł.
+ * @param[in] kind Rodzaj węzła.
+ * @param[in] prefix_len Długość ścieżki.
+ * @return Wskaźnik na utworzony węzeł.
  */
-static bool find_child(const struct dictionary *dict, struct dictionary **found,
-					  const wchar_t key)
+static struct node * create_node(struct dictionary *dict, enum node_kind kind,
+								 unsigned prefix_len)
 {
-	struct dictionary **children = dict->children;
-	if (NULL == children) {
-		*found = NULL;
-		return false;
-	}
-	int l = 0;
-	int r = dict->children_size - 1;
-	while (l < r)
-	{
-		int s = (l + r) / 2;
-		if (key > (*(children + s))->key)
-			l = s + 1;
-		else
-			r = s;
-	}
-	*found = *(children + l);
-	if ((*found)->key == key)
-	{
-		return true;
-	}
+	struct node *node = arena_alloc(&dict->arena,
+									node_sizes[kind] + prefix_len);
+	assert(node != NULL);
+	node->kind = kind;
+	node->terminal = 0;
+	node->prefix_len = prefix_len;
+	node->count = 0;
+	node->weight = 0;
+	node->max_weight = 0;
+	if (kind == NODE_48)
+		memset(((struct node48 *) node)->index, 0, SYMBOL_LIMIT);
+	else if (kind == NODE_256)
+		memset(((struct node256 *) node)->children, 0,
+			   SYMBOL_LIMIT * sizeof(struct node *));
+	mark_fresh(dict, node);
+	return node;
+}
+
+/**
+ * Zwraca węzeł do areny słownika. Węzeł widoczny dla czytelników
+ * zwalniany jest dopiero, gdy nikt go już nie czyta.
+ * @param[in,out] dict Słownik.
+ * @param[in] node Węzeł.
+ */
+static void free_node(struct dictionary *dict, struct node *node)
+{
+	if (is_fresh(dict, node))
+		arena_free(&dict->arena, node, node_size(node));
 	else
-	{
-		*found = NULL;
-		return false;
-	}
+		retire(dict, node, node_size(node));
 }
 
 /**
- * Usuwa dziecko 'child' z tablicy węzłów 'prev'.
- * @param[in,out] prev Węzeł z, którego usuwane jest dziecko.
- * @param[in] child Usuwany węzeł.
+ * Zmienia rozmiar bloku węzła, który nie jest widoczny dla czytelników.
+ * @param[in,out] dict Słownik.
+ * @param[in] node Węzeł.
+ * @param[in] old_size Dotychczasowy rozmiar bloku.
+ * @param[in] new_size Nowy rozmiar bloku.
+ * @return Węzeł, być może przeniesiony.
  */
-static void delete_child(struct dictionary *prev, struct dictionary *child)
+static struct node * resize_node(struct dictionary *dict, struct node *node,
+								 size_t old_size, size_t new_size)
 {
-	if (prev == NULL)
-		return;
-	assert(child->children_size == 0);
-	if (prev->children_size == 1)
-	{
-		free(child);
-		free(prev->children);
-		prev->children = NULL;
-		prev->children_size--;
-		return;
-	}
-	struct dictionary **new_children =
-		malloc((prev->children_size - 1) * sizeof(struct dictionary *));
-	int j = 0;
-	for (int i = 0; i < prev->children_size; i++)
+	struct node *moved = arena_realloc(&dict->arena, node, old_size, new_size);
+	assert(moved != NULL);
+	struct shared_state *shared = dict->shared;
+	if (moved != node && shared && !shared->tree_private)
+		for (size_t i = 0; i < shared->fresh_size; i++)
+			if (shared->fresh[i] == node)
+				shared->fresh[i] = moved;
+	return moved;
+}
+
+/**
+ * Kopiuje węzeł widoczny dla czytelników, a oryginał odkłada do
+ * zwolnienia.
+ * @param[in,out] dict Współdzielony słownik.
+ * @param[in] node Węzeł.
+ * @return Kopia.
+ */
+static struct node * copy_node(struct dictionary *dict, struct node *node)
+{
+	size_t size = node_size(node);
+	struct node *copy = arena_alloc(&dict->arena, size);
+	assert(copy != NULL);
+	memcpy(copy, node, size);
+	retire(dict, node, size);
+	return copy;
+}
+
+/**
+ * Przygotowuje węzeł do zmiany: jeśli jest widoczny dla czytelników,
+ * zastępuje go kopią. Ojciec węzła musi już należeć do pisarza.
+ * @param[in,out] dict Słownik.
+ * @param[in,out] ref Miejsce, w którym zapisany jest węzeł.
+ * @return Węzeł, który można zmieniać.
+ */
+static struct node * own(struct dictionary *dict, struct node **ref)
+{
+	if (is_fresh(dict, *ref))
+		return *ref;
+	struct node *copy = copy_node(dict, *ref);
+	mark_fresh(dict, copy);
+	return *ref = copy;
+}
+
+/**
+ * Zwraca czy w węźle 'node', znajduje się dziecko o danym kluczu 'key'.
+ * @param[in] node Węzeł słownika.
+ * @param[in] key Kod klucza.
+ * @return Wskaźnik na miejsce w węźle, w którym zapisane jest dziecko,
+ * lub NULL, jeśli takiego dziecka nie ma.
+ */
+static struct node ** find_child(const struct node *node, uint8_t key)
+{
+	STATS_ADD(child_probes, 1);
+	switch (node->kind)
 	{
-		if (*(prev->children + i) != child)
+		case NODE_4:
+		{
+			struct node4 *n = (struct node4 *) node;
+			for (unsigned i = 0; i < node->count; i++)
+				if (n->keys[i] == key)
+					return &n->children[i];
+			return NULL;
+		}
+		case NODE_16:
+		{
+			struct node16 *n = (struct node16 *) node;
+#ifdef __SSE2__
+			__m128i equal = _mm_cmpeq_epi8(_mm_set1_epi8((char) key),
+				_mm_loadu_si128((const __m128i *) n->keys));
+			unsigned mask = _mm_movemask_epi8(equal) & ((1u << node->count) - 1);
+			return mask ? &n->children[__builtin_ctz(mask)] : NULL;
+#else
+			for (unsigned i = 0; i < node->count; i++)
+				if (n->keys[i] == key)
+					return &n->children[i];
+			return NULL;
+#endif
+		}
+		case NODE_48:
+		{
+			struct node48 *n = (struct node48 *) node;
+			return n->index[key] ? &n->children[n->index[key] - 1] : NULL;
+		}
+		case NODE_256:
 		{
-			*(new_children + j) = *(prev->children + i);
-			j++;
+			struct node256 *n = (struct node256 *) node;
+			return n->children[key] ? &n->children[key] : NULL;
 		}
 	}
-	free(child);
-	free(prev->children);
-	prev->children = new_children;
-	prev->children_size--;
+	return NULL;
 }
 
 /**
- * Funkcja pomocnicza dictionary_delete.
- * Usuwa węzły reprezentujące slowo 'word' w słowniku 'dict'.
- * @param[in,out] dict Słownik.
- * @param[in] prev Wskaźnik na ojca. Jeśli 'dict' to root należy wstawić NULL.
- * @param[in] word Usuwane słowo.
- * @return 0 jeśli 'prev' po usunięciu węzła nie posiada już dzieci, 1 w p.p.
+ * Wyszukuje dziecko o najmniejszym kluczu, zaczynając od pozycji 'index'.
+ * Pozycją jest indeks w tablicy dzieci, a w węzłach NODE_48 i NODE_256
+ * kod klucza.
+ * @param[in] node Węzeł.
+ * @param[in,out] index Pozycja początkowa; po znalezieniu dziecka
+ * pozycja za nim.
+ * @param[out] key Kod klucza dziecka.
+ * @return Dziecko lub NULL, jeśli od tej pozycji nie ma już dzieci.
  */
-static int delete_helper(struct dictionary *dict, struct dictionary *prev,
-					  const wchar_t *word)
+static struct node * next_child(const struct node *node, uint32_t *index,
+								uint8_t *key)
 {
-	if (dict)
+	switch (node->kind)
 	{
-		if (*word == L'\0')
+		case NODE_0:
+			return NULL;
+		case NODE_4:
+		case NODE_16:
+			if (*index >= node->count)
+				return NULL;
+			*key = sorted_keys(node)[*index];
+			return sorted_children(node)[(*index)++];
+		case NODE_48:
 		{
-			if (dict->key == NULL_MARKER)
-			{
-				delete_child(prev, dict);
-				if (prev->children_size == 0)
-					return 1;
-				return 0;
-			}
+			const struct node48 *n = (const struct node48 *) node;
+			for (; *index < SYMBOL_LIMIT; (*index)++)
+				if (n->index[*index])
+				{
+					*key = *index;
+					return n->children[n->index[(*index)++] - 1];
+				}
+			return NULL;
 		}
-		else
+		case NODE_256:
 		{
-			struct dictionary *found = NULL;
-			word++;
-			if (*word == L'\0')
-				find_child(dict, &found, NULL_MARKER);
-			else
-				find_child(dict, &found, *word);
-			if (delete_helper(found, dict, word))
-			{
-				delete_child(prev, dict);
-				return (prev && prev->children_size == 0);
-			}
+			const struct node256 *n = (const struct node256 *) node;
+			for (; *index < SYMBOL_LIMIT; (*index)++)
+				if (n->children[*index])
+				{
+					*key = *index;
+					return n->children[(*index)++];
+				}
+			return NULL;
 		}
 	}
-	return 0;
+	return NULL;
 }
 
 /**
- * Funkcja pomocnicza dictionary_load.
- * Zwraca na 'dict' wskaznik do powstałego słownika, utworzonego na
- * podstawie pliku 'stream'.
- * @param[in,out] dict Słownik.
- * @param[in] stream Plik.
- * @return <0 jeśli operacja się nie powiedzie, 0 w p.p
+ * Dopisuje dziecko do węzła 'node', w którym musi być już na nie miejsce,
+ * zachowując porządek po kluczu.
+ * Jeśli dzieci przychodzą w kolejności kluczy, nic nie jest przesuwane.
+ * Uwaga: w 'node' nie może byc dziecka o kluczu 'key'.
+ * @param[in,out] node Węzeł słownika.
+ * @param[in] key Kod klucza dziecka.
+ * @param[in] child Wstawiany węzeł.
  */
-static int deserialize(struct dictionary **dict, FILE* stream)
+static void append_child(struct node *node, uint8_t key, struct node *child)
 {
-	int valid = 0;
-	wchar_t key;
-	if (fscanf(stream, "%1ls", &key) != EOF)
+	assert(node->count < node_capacity[node->kind]);
+	if (node->kind == NODE_4 || node->kind == NODE_16)
 	{
-		int size;
-		if (fscanf(stream, "%d", &size) != EOF)
+		uint8_t *keys = sorted_keys(node);
+		struct node **children = sorted_children(node);
+		int i = node->count;
+		while (i > 0 && keys[i - 1] > key)
 		{
-			*dict = create_node(key);
-			for (int i = 0; i < size; i++)
-			{
-				struct dictionary *child = NULL;
-				valid += deserialize(&child, stream);
-				put_child(*dict, child);
-			}
+			keys[i] = keys[i - 1];
+			children[i] = children[i - 1];
+			i--;
 		}
+		keys[i] = key;
+		children[i] = child;
 	}
-	if (ferror(stream))
-		valid += -1;
-	return valid;
+	else if (node->kind == NODE_48)
+	{
+		struct node48 *n = (struct node48 *) node;
+		n->children[node->count] = child;
+		n->index[key] = node->count + 1;
+	}
+	else
+		((struct node256 *) node)->children[key] = child;
+	node->count++;
 }
 
 /**
- * Usuwa ze słowa 'src' znak na pozycji 'pos'.
- * @param[in,out] src Słowo.
- * @param[in] pos Pozycja usunięcia.
- * @param[in] len Długość słowa.
+ * Przenosi węzeł do nowego bloku innego rodzaju, razem ze skompresowaną
+ * ścieżką i dziećmi.
+ * @param[in,out] dict Słownik.
+ * @param[in] node Węzeł, którego blok jest zwalniany.
+ * @param[in] kind Nowy rodzaj, mieszczący wszystkie dzieci węzła.
+ * @return Nowy węzeł.
  */
-static void delete_at(wchar_t *src, size_t pos, size_t len)
+static struct node * change_kind(struct dictionary *dict, struct node *node,
+								 enum node_kind kind)
 {
-	wchar_t *dst;
-	if (pos < 0)
-		return;
-	src += pos;
-	dst = src;
-	src++;
-	for (int i = pos + 1; i < len && *src != L'\0'; i++)
-		*dst++ = *src++;
-	*dst = L'\0';
+	struct node *copy = create_node(dict, kind, node->prefix_len);
+	copy->terminal = node->terminal;
+	copy->weight = node->weight;
+	copy->max_weight = node->max_weight;
+	memcpy(node_prefix(copy), node_prefix(node), node->prefix_len);
+	uint32_t index = 0;
+	uint8_t key;
+	struct node *child;
+	while ((child = next_child(node, &index, &key)))
+		append_child(copy, key, child);
+	free_node(dict, node);
+	return copy;
 }
 
 /**
- * Wstawia do słowa 'src' znak 'c' na pozycji 'pos'.
- * @param[in] src Słowo
- * @param[in] c Znak.
- * @param[in] pos Pozycja wstawiania.
- * @param[in] len Długość słowa.
- * @param[in,out] dst Wskaźnik na nowe słowo.
+ * Wstawia dziecko do węzła, w razie potrzeby zamieniając węzeł na
+ * większy rodzaj.
+ * Uwaga: w węźle nie może byc dziecka o kluczu 'key'.
+ * @param[in,out] dict Słownik.
+ * @param[in,out] ref Miejsce, w którym zapisany jest węzeł.
+ * @param[in] key Kod klucza dziecka.
+ * @param[in] child Wstawiany węzeł.
  */
-static void insert_at(const wchar_t *src, const wchar_t *c, size_t pos,
-					  size_t len, wchar_t **dst)
+static void put_child(struct dictionary *dict, struct node **ref,
+					  uint8_t key, struct node *child)
 {
-	wchar_t fst[pos + 1];
-	fst[0] = L'\0';
-	wchar_t snd[len - pos + 1];
-	snd[0] = L'\0';
-	wcsncpy(fst, src, pos);
-	fst[pos] = L'\0';
-	wcsncpy(snd, &src[pos], len - pos);
-	snd[len - pos] = L'\0';
-	wcscat(*dst, fst);
-	wcscat(*dst, c);
-	wcscat(*dst, snd);
+	if ((*ref)->count == node_capacity[(*ref)->kind])
+		*ref = change_kind(dict, *ref, (*ref)->kind + 1);
+	append_child(*ref, key, child);
 }
 
 /**
- * Zamienia w słowie 'src' znak na pozycji 'pos' na znak 'c'.
- * @param[in,out] src Słowo.
- * @param[in] c Znak.
- * @param[in] pos Pozycja zamiany.
- * @param[in] len Długość słowa.
+ * Usuwa z węzła dziecko o kluczu 'key', w razie potrzeby zamieniając
+ * węzeł na mniejszy rodzaj. Samo dziecko nie jest zwalniane.
+ * @param[in,out] dict Słownik.
+ * @param[in,out] ref Miejsce, w którym zapisany jest węzeł.
+ * @param[in] key Kod klucza usuwanego dziecka.
  */
-static void replace_at(wchar_t *src, const wchar_t c, size_t pos, size_t len)
+static void delete_child(struct dictionary *dict, struct node **ref,
+						 uint8_t key)
 {
-	if (pos < 0)
-		return;
-	src += pos;
-	*src = c;
+	struct node *node = *ref;
+	if (node->kind == NODE_4 || node->kind == NODE_16)
+	{
+		uint8_t *keys = sorted_keys(node);
+		struct node **children = sorted_children(node);
+		int j = 0;
+		for (int i = 0; i < node->count; i++)
+		{
+			if (keys[i] != key)
+			{
+				keys[j] = keys[i];
+				children[j] = children[i];
+				j++;
+			}
+		}
+	}
+	else if (node->kind == NODE_48)
+	{
+		/* Na zwolnione miejsce przenosimy ostatnie dziecko. */
+		struct node48 *n = (struct node48 *) node;
+		unsigned slot = n->index[key];
+		n->index[key] = 0;
+		if (slot != node->count)
+		{
+			unsigned last = 0;
+			while (n->index[last] != node->count)
+				last++;
+			n->children[slot - 1] = n->children[node->count - 1];
+			n->index[last] = slot;
+		}
+	}
+	else
+		((struct node256 *) node)->children[key] = NULL;
+	node->count--;
+	if (node->kind != NODE_0 && node->count <= node_shrink[node->kind])
+		*ref = change_kind(dict, node, node->kind - 1);
 }
 
 /**
- * Funkcja pomocnicza create_alphabet.
- * Konkatenuje do *ptra kolejne klucze węzłów słownika,
- * jeśli jeszcze sie w nim nie pojawiły.
- * @param[in] dict Słownik.
- * @param[in,out] ptra Wskażnik na "wide string" alfabetu.
+ * Odkłada nową ramkę na stos.
+ * @param[in,out] stack Stos.
+ * @param[in] cursor Pozycja w słowniku.
+ * @param[in] index Początkowa pozycja dziecka.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
  */
-static void alphabet_helper(const struct dictionary *dict, wchar_t *ptra)
+static bool stack_push(struct stack *stack, struct cursor cursor,
+					   uint32_t index)
 {
-	if (dict == NULL)
-	{
-		ptra = NULL;
-		return;
-	}
-	wchar_t k[2];
-	k[0] = dict->key;
-	k[1] = L'\0';
-	if (dict->key != NULL_MARKER && wcschr(ptra, k[0]) == NULL)
+	if (stack->size == stack->capacity)
 	{
-		wcscat(ptra, k);
+		size_t capacity = stack->capacity ? 2 * stack->capacity : 64;
+		struct frame *frames =
+			realloc(stack->frames, capacity * sizeof(struct frame));
+		if (frames == NULL)
+			return false;
+		STATS_ADD(allocations, 1);
+		STATS_ADD(allocated_bytes, capacity * sizeof(struct frame));
+		stack->frames = frames;
+		stack->capacity = capacity;
 	}
-	for (int i = 0; i < dict->children_size; i++)
-		alphabet_helper(*(dict->children + i), ptra);
+	struct frame *top = &stack->frames[stack->size++];
+	top->cursor = cursor;
+	top->index = index;
+	return true;
 }
 
 /**
- * Tworzy alfabet, zawierający tylko te litery, które zawierają
- * słowa występujące w słowniku.
- * @param[in] dict Słownik.
- * @return "Wide string" alfabetu.
+ * Zwraca ramkę na szczycie stosu.
+ * @param[in] stack Niepusty stos.
+ * @return Ramka na szczycie.
  */
-static const wchar_t * create_alphabet(const struct dictionary *dict)
+static struct frame * stack_top(struct stack *stack)
 {
-	static wchar_t alphabet[ALPHABET_SIZE];
-	alphabet_helper(dict, alphabet);
-	return alphabet;
+	return &stack->frames[stack->size - 1];
 }
 
 /**
- * Porównuje leksykograficznie dwa słowa.
- * Komparator otoczka dla qsort, wykorzystująca do porównań wcscoll.
- * @param[in] arg1 Słowo pierwsze.
- * @param[in] arg2 Słowo drugie.
- * @return 0 jeśli słowa są identyczne, <0 jeśli słowo pierwsze jest
- * leksykograficznie mniejsze od słowa pierwszego, >0 jeśli słowo drugie
- * jest leksykograficznie większe od słowa pierwszego.
+ * Zwraca kursor na początek skompresowanej ścieżki węzła drzewa.
+ * @param[in] node Węzeł drzewa lub NULL.
+ * @return Kursor.
  */
-static int compare(const void *arg1, const void *arg2)
+static struct cursor node_cursor(const struct node *node)
 {
-	return wcscoll(*(const wchar_t**)arg1, *(const wchar_t**)arg2);
+	struct cursor c = { node, 0, 0 };
+	return c;
 }
 
 /**
- * Tworzy wszytskie możliwe modyfikacje słowa 'word' według zasad
- * ustalonych dla dictionary_hints.
- * @param[in] dict Słownik.
- * @param[in] word Słowo.
- * @param[in,out] hints_size Ilość podpowiedzi.
- * @param[in,out] output Wskaźnik na tablicę podpowiedzi.
+ * Zastępuje całe drzewo współdzielonego słownika kopią należącą do
+ * pisarza. Wywoływana przed przenumerowaniem drzewa, które zmienia
+ * każdy węzeł.
+ * @param[in,out] dict Słownik.
  */
-static void possible_hints(const struct dictionary *dict, const wchar_t *word,
-						   int **hints_size, wchar_t ***output)
+static void copy_tree(struct dictionary *dict)
 {
-	const wchar_t * alphabet = create_alphabet(dict);
-	wchar_t *hints[HINTS_SIZE];
-	int size = 0;
-	for (size_t i = 0; i < (wcslen(word) + 1); i++)
+	struct stack stack = { NULL, 0, 0 };
+	dict->root = copy_node(dict, dict->root);
+	bool pushed = stack_push(&stack, node_cursor(dict->root), 0);
+	while (pushed && stack.size > 0)
 	{
-		wchar_t *h1 = malloc(wcslen(word) * sizeof(wchar_t *));
-		wcscpy(h1, word);
-		delete_at(h1, i, wcslen(word));
-		hints[size] = h1;
-		size++;
-	}
-	for (size_t i = 0; i < wcslen(word); i++)
-		for (int j = 0; alphabet[j]; j++)
+		struct node *node =
+			(struct node *) stack.frames[--stack.size].cursor.node;
+		uint32_t index = 0;
+		uint8_t key;
+		struct node *child;
+		while (pushed && (child = next_child(node, &index, &key)))
 		{
-			wchar_t *h2 = malloc((wcslen(word) + 1) * sizeof(wchar_t *));
-			wcscpy(h2, word);
-			replace_at(h2, alphabet[j], i, wcslen(word));
-			hints[size] = h2;
-			size++;
+			child = copy_node(dict, child);
+			*find_child(node, key) = child;
+			pushed = stack_push(&stack, node_cursor(child), 0);
 		}
+	}
+	assert(pushed);
+	free(stack.frames);
+	dict->shared->tree_private = true;
+}
 
-	for (size_t i = 0; i <= wcslen(word); i++)
-		for (int j = 0; alphabet[j]; j++)
+/**
+ * Zwiększa o jeden kody kluczy drzewa, które są nie mniejsze niż 'from'.
+ * Wywoływana po dodaniu litery do tablicy symboli, co zdarza się
+ * najwyżej raz dla każdej litery alfabetu.
+ * @param[in,out] dict Słownik.
+ * @param[in] from Kod dodanej litery.
+ */
+static void renumber(struct dictionary *dict, uint8_t from)
+{
+	if (dict->root == NULL)
+		return;
+	if (dict->shared && !dict->shared->tree_private)
+		copy_tree(dict);
+	struct stack stack = { NULL, 0, 0 };
+	bool pushed = stack_push(&stack, node_cursor(dict->root), 0);
+	while (pushed && stack.size > 0)
+	{
+		struct node *node =
+			(struct node *) stack.frames[--stack.size].cursor.node;
+		uint8_t *prefix = node_prefix(node);
+		for (unsigned i = 0; i < node->prefix_len; i++)
+			if (prefix[i] >= from)
+				prefix[i]++;
+		/* Ostatni kod nie był jeszcze przypisany, więc przesunięcie tablic
+		   indeksowanych kodem niczego nie gubi. */
+		if (node->kind == NODE_4 || node->kind == NODE_16)
+		{
+			uint8_t *keys = sorted_keys(node);
+			for (unsigned i = 0; i < node->count; i++)
+				if (keys[i] >= from)
+					keys[i]++;
+		}
+		else if (node->kind == NODE_48)
+		{
+			uint8_t *index = ((struct node48 *) node)->index;
+			memmove(index + from + 1, index + from, SYMBOL_LIMIT - from - 1);
+			index[from] = 0;
+		}
+		else if (node->kind == NODE_256)
 		{
-			wchar_t *h3 = malloc((wcslen(word) + 2) * sizeof(wchar_t *));
-			h3[0] = L'\0';
-			wchar_t c[2];
-			c[0] = alphabet[j];
-			c[1] = L'\0';
-			insert_at(word, c, i, wcslen(word), &h3);
-			hints[size] = h3;
-			size++;
+			struct node **children = ((struct node256 *) node)->children;
+			memmove(children + from + 1, children + from,
+					(SYMBOL_LIMIT - from - 1) * sizeof(struct node *));
+			children[from] = NULL;
 		}
-	*hints_size = &size;
-	qsort(hints, size, sizeof(wchar_t *), compare);
-	*output = hints;
+		uint32_t index = 0;
+		uint8_t key;
+		struct node *child;
+		while (pushed && (child = next_child(node, &index, &key)))
+			pushed = stack_push(&stack, node_cursor(child), 0);
+	}
+	assert(pushed);
+	free(stack.frames);
 }
 
-/**@}*/
-/** @name Elementy interfejsu
-  @{
+/**
+ * Wyznacza kod litery, w razie potrzeby dodając ją do tablicy symboli
+ * i przenumerowując drzewo.
+ * @param[in,out] dict Słownik.
+ * @param[in] letter Litera.
+ * @param[out] code Kod litery.
+ * @return true jeśli się udało, false jeśli tablica symboli jest pełna.
  */
-
-struct dictionary * dictionary_new()
+static bool symbol_code(struct dictionary *dict, wchar_t letter,
+						uint8_t *code)
 {
-	struct dictionary *dict = create_node(NULL_MARKER);
-	assert( dict != NULL);
+	struct shared_state *shared = dict->shared;
+	if (shared && !shared->symbols_private
+		&& !symbol_table_find(dict->symbols, letter, code))
+	{
+		/* Czytelnicy korzystają z opublikowanej tablicy. */
+		struct symbol_table *copy = malloc(sizeof(struct symbol_table));
+		assert(copy != NULL);
+		*copy = *dict->symbols;
+		retire(dict, dict->symbols, 0);
+		dict->symbols = copy;
+		shared->symbols_private = true;
+	}
+	int added = symbol_table_add(dict->symbols, letter, code);
+	if (added > 0)
+	{
+		renumber(dict, *code);
+		uint64_t *letters = dict->summary->letters;
+		memmove(letters + *code + 1, letters + *code,
+				(SYMBOL_LIMIT - *code - 1) * sizeof(uint64_t));
+		letters[*code] = 0;
+	}
+	return added >= 0;
+}
+
+/**
+ * Zwraca kod litery, która jest już w tablicy symboli słownika.
+ * @param[in] dict Słownik.
+ * @param[in] letter Litera.
+ * @return Kod litery.
+ */
+static uint8_t known_code(const struct dictionary *dict, wchar_t letter)
+{
+	uint8_t code;
+	bool known = symbol_table_find(dict->symbols, letter, &code);
+	assert(known);
+	return code;
+}
+
+/**
+ * Zapewnia w podsumowaniu miejsce na słowa długości 'len'.
+ * @param[in,out] summary Podsumowanie.
+ * @param[in] len Długość słowa.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+static bool summary_reserve(struct summary *summary, size_t len)
+{
+	if (len < summary->lengths_size)
+		return true;
+	size_t size = 2 * summary->lengths_size;
+	if (size <= len)
+		size = len + 16;
+	size_t *lengths = realloc(summary->lengths, size * sizeof(size_t));
+	if (lengths == NULL)
+		return false;
+	memset(lengths + summary->lengths_size, 0,
+		   (size - summary->lengths_size) * sizeof(size_t));
+	summary->lengths = lengths;
+	summary->lengths_size = size;
+	return true;
+}
+
+/**
+ * Uwzględnia w podsumowaniu dodanie lub usunięcie słowa.
+ * Litery słowa muszą już być w tablicy symboli słownika, a w podsumowaniu
+ * musi być miejsce na jego długość.
+ * @param[in,out] dict Słownik.
+ * @param[in] word Słowo.
+ * @param[in] added Czy słowo zostało dodane, czy usunięte.
+ */
+static void summary_update(struct dictionary *dict, const wchar_t *word,
+						   bool added)
+{
+	struct summary *summary = dict->summary;
+	size_t len = 0;
+	for (; word[len]; len++)
+		if (added)
+			summary->letters[known_code(dict, word[len])]++;
+		else
+			summary->letters[known_code(dict, word[len])]--;
+	if (added)
+	{
+		summary->words++;
+		summary->lengths[len]++;
+		if (len > summary->max_length)
+			summary->max_length = len;
+		return;
+	}
+	summary->words--;
+	summary->lengths[len]--;
+	while (summary->max_length > 0
+		   && summary->lengths[summary->max_length] == 0)
+		summary->max_length--;
+}
+
+/**
+ * Tworzy węzeł ze skompresowaną ścieżką 'word', na której końcu kończy
+ * się słowo. Ścieżki dłuższe niż PREFIX_MAX dzielone są na łańcuch węzłów.
+ * Litery muszą już być w tablicy symboli słownika.
+ * @param[in,out] dict Słownik.
+ * @param[in] word Litery ścieżki.
+ * @return Nowy węzeł.
+ */
+static struct node * create_path(struct dictionary *dict, const wchar_t *word)
+{
+	struct node *head = NULL;
+	struct node **ref = &head;
+	size_t len = wcslen(word);
+	for (;;)
+	{
+		size_t n = len < PREFIX_MAX ? len : PREFIX_MAX;
+		struct node *node = create_node(dict, n < len ? NODE_4 : NODE_0, n);
+		uint8_t *prefix = node_prefix(node);
+		for (size_t i = 0; i < n; i++)
+			prefix[i] = known_code(dict, word[i]);
+		*ref = node;
+		word += n;
+		len -= n;
+		if (len == 0)
+		{
+			node->terminal = 1;
+			return head;
+		}
+		append_child(node, known_code(dict, *word), NULL);
+		ref = &((struct node4 *) node)->children[0];
+		word++;
+		len--;
+	}
+}
+
+/**
+ * Dzieli skompresowaną ścieżkę węzła po 'split' kodach. Początek ścieżki
+ * trafia do nowego węzła, którego jedynym dzieckiem jest dotychczasowy
+ * węzeł z resztą ścieżki.
+ * @param[in,out] dict Słownik.
+ * @param[in,out] ref Miejsce, w którym zapisany jest węzeł.
+ * @param[in] split Długość początku, mniejsza niż długość ścieżki.
+ */
+static void split_prefix(struct dictionary *dict, struct node **ref,
+						 unsigned split)
+{
+	struct node *node = *ref;
+	size_t old_size = node_size(node);
+	uint8_t *prefix = node_prefix(node);
+	struct node *top = create_node(dict, NODE_4, split);
+	top->max_weight = node->max_weight;
+	memcpy(node_prefix(top), prefix, split);
+	uint8_t key = prefix[split];
+	unsigned rest = node->prefix_len - split - 1;
+	memmove(prefix, prefix + split + 1, rest);
+	node->prefix_len = rest;
+	node = resize_node(dict, node, old_size, node_size(node));
+	append_child(top, key, node);
+	*ref = top;
+}
+
+/**
+ * Skleja węzeł, w którym nie kończy się słowo i który ma jedno dziecko,
+ * z tym dzieckiem, o ile sklejona ścieżka mieści się w węźle.
+ * @param[in,out] dict Słownik.
+ * @param[in,out] ref Miejsce, w którym zapisany jest węzeł.
+ */
+static void merge_child(struct dictionary *dict, struct node **ref)
+{
+	struct node *node = *ref;
+	uint32_t index = 0;
+	uint8_t key;
+	struct node *child = next_child(node, &index, &key);
+	unsigned extra = node->prefix_len + 1;
+	if (child->prefix_len + extra > PREFIX_MAX)
+		return;
+	child = own(dict, find_child(node, key));
+	size_t old_size = node_size(child);
+	child = resize_node(dict, child, old_size, old_size + extra);
+	uint8_t *prefix = node_prefix(child);
+	memmove(prefix + extra, prefix, child->prefix_len);
+	memcpy(prefix, node_prefix(node), node->prefix_len);
+	prefix[node->prefix_len] = key;
+	child->prefix_len += extra;
+	free_node(dict, node);
+	*ref = child;
+}
+
+/**
+ * Zwalnia łańcuch węzłów, z których każdy ma co najwyżej jedno dziecko.
+ * @param[in,out] dict Słownik.
+ * @param[in] node Pierwszy węzeł łańcucha.
+ */
+static void free_chain(struct dictionary *dict, struct node *node)
+{
+	while (node)
+	{
+		uint32_t index = 0;
+		uint8_t key;
+		struct node *next = next_child(node, &index, &key);
+		free_node(dict, node);
+		node = next;
+	}
+}
+
+/**
+ * Funkcja pomocnicza dictionary_delete.
+ * Usuwa z drzewa słowo 'word' razem z węzłami, które przestały być
+ * potrzebne, i skleja węzły, którym zostało jedno dziecko.
+ * We współdzielonym słowniku węzły na drodze słowa są kopiowane.
+ * @param[in,out] dict Słownik.
+ * @param[in] word Usuwane słowo.
+ * @param[out] weight Waga usuniętego słowa.
+ * @return 1 jeśli udało się usunąć, 0 jeśli słowa nie było w drzewie.
+ */
+static int delete_helper(struct dictionary *dict, const wchar_t *word,
+						 uint32_t *weight)
+{
+	/* 'anchor' to ostatni węzeł na ścieżce słowa, który zostaje w drzewie
+	   nawet po usunięciu liścia: korzeń, koniec innego słowa lub
+	   rozgałęzienie. */
+	struct node **ref = &dict->root;
+	struct node **anchor = ref;
+	uint8_t anchor_key = 0;
+	for (;;)
+	{
+		struct node *node = own(dict, ref);
+		const uint8_t *prefix = node_prefix(node);
+		uint8_t code;
+		for (unsigned i = 0; i < node->prefix_len; i++, word++)
+			if (!symbol_table_find(dict->symbols, *word, &code)
+				|| code != prefix[i])
+				return 0;
+		if (*word == L'\0')
+			break;
+		struct node **child;
+		if (!symbol_table_find(dict->symbols, *word, &code)
+			|| (child = find_child(node, code)) == NULL)
+			return 0;
+		if (ref == &dict->root || node->terminal || node->count > 1)
+		{
+			anchor = ref;
+			anchor_key = code;
+		}
+		ref = child;
+		word++;
+	}
+	struct node *node = *ref;
+	if (!node->terminal)
+		return 0;
+	node->terminal = 0;
+	*weight = node->weight;
+	node->weight = 0;
+	if (ref == &dict->root)
+		return 1;
+	if (node->count > 0)
+	{
+		if (node->count == 1)
+			merge_child(dict, ref);
+		return 1;
+	}
+	free_chain(dict, *find_child(*anchor, anchor_key));
+	delete_child(dict, anchor, anchor_key);
+	if (anchor != &dict->root && !(*anchor)->terminal && (*anchor)->count == 1)
+		merge_child(dict, anchor);
+	return 1;
+}
+
+/**
+ * Wylicza największą wagę słowa w poddrzewie węzła z wagi słowa węzła
+ * i największych wag w poddrzewach jego dzieci.
+ * @param[in] node Węzeł.
+ * @return Największa waga.
+ */
+static uint32_t subtree_weight(const struct node *node)
+{
+	uint32_t max = node->terminal ? node->weight : 0;
+	uint32_t index = 0;
+	uint8_t key;
+	const struct node *child;
+	while ((child = next_child(node, &index, &key)))
+		if (child->max_weight > max)
+			max = child->max_weight;
+	return max;
+}
+
+/**
+ * Przelicza od dołu największe wagi w węzłach na ścieżce słowa 'word',
+ * po zmniejszeniu wagi lub usunięciu słowa. Ścieżka może kończyć się
+ * przed końcem słowa, a jej ostatni węzeł może być sklejony z węzłem
+ * usuniętego słowa.
+ * We współdzielonym słowniku węzły na ścieżce są kopiowane.
+ * @param[in,out] dict Słownik w postaci drzewa.
+ * @param[in] word Słowo.
+ */
+static void lower_weights(struct dictionary *dict, const wchar_t *word)
+{
+	struct stack stack = { NULL, 0, 0 };
+	struct node **ref = &dict->root;
+	bool pushed = true;
+	while (pushed)
+	{
+		struct node *node = own(dict, ref);
+		pushed = stack_push(&stack, node_cursor(node), 0);
+		const uint8_t *prefix = node_prefix(node);
+		unsigned i = 0;
+		uint8_t code;
+		while (i < node->prefix_len && *word
+			   && symbol_table_find(dict->symbols, *word, &code)
+			   && code == prefix[i])
+		{
+			i++;
+			word++;
+		}
+		struct node **child;
+		if (i < node->prefix_len || *word == L'\0'
+			|| !symbol_table_find(dict->symbols, *word, &code)
+			|| (child = find_child(node, code)) == NULL)
+			break;
+		ref = child;
+		word++;
+	}
+	assert(pushed);
+	while (stack.size > 0)
+	{
+		struct node *node =
+			(struct node *) stack.frames[--stack.size].cursor.node;
+		node->max_weight = subtree_weight(node);
+	}
+	free(stack.frames);
+}
+
+/**
+ * Ustawia wagę słowa, które jest w drzewie, i uaktualnia największe
+ * wagi w węzłach na jego ścieżce.
+ * We współdzielonym słowniku węzły na ścieżce są kopiowane.
+ * @param[in,out] dict Słownik w postaci drzewa.
+ * @param[in] word Słowo.
+ * @param[in] weight Nowa waga.
+ * @return Poprzednia waga słowa.
+ */
+static uint32_t set_weight(struct dictionary *dict, const wchar_t *word,
+						   uint32_t weight)
+{
+	struct node **ref = &dict->root;
+	struct node *node;
+	const wchar_t *letter = word;
+	/* Po drodze waga może tylko podnieść największe wagi; jeśli słowo
+	   miało większą wagę, są one przeliczane od dołu. */
+	for (;;)
+	{
+		node = own(dict, ref);
+		if (weight > node->max_weight)
+			node->max_weight = weight;
+		letter += node->prefix_len;
+		if (*letter == L'\0')
+			break;
+		ref = find_child(node, known_code(dict, *letter));
+		letter++;
+	}
+	uint32_t old = node->weight;
+	node->weight = weight;
+	if (old > weight)
+		lower_weights(dict, word);
+	return old;
+}
+
+/**
+ * Porównuje leksykograficznie dwa słowa.
+ * Komparator otoczka dla qsort, wykorzystująca do porównań wcscoll.
+ * @param[in] arg1 Słowo pierwsze.
+ * @param[in] arg2 Słowo drugie.
+ * @return 0 jeśli słowa są identyczne, <0 jeśli słowo pierwsze jest
+ * leksykograficznie mniejsze od słowa pierwszego, >0 jeśli słowo drugie
+ * jest leksykograficznie większe od słowa pierwszego.
+ */
+static int compare(const void *arg1, const void *arg2)
+{
+	return wcscoll(*(const wchar_t**)arg1, *(const wchar_t**)arg2);
+}
+
+/**
+ * Porównuje dwa słowa litera po literze według pozycji liter w porządku
+ * alfabetycznym locale, zapamiętanych w tablicy symboli. Gdy
+ * symbol_table_collated(), wynik ma ten sam znak co wynik compare(),
+ * ale nie wymaga wywołań wcscoll.
+ * Komparator otoczka dla qsort_r.
+ * @param[in] arg1 Słowo pierwsze.
+ * @param[in] arg2 Słowo drugie.
+ * @param[in] data Tablica symboli zawierająca litery obu słów.
+ * @return Wynik porównania, jak w compare().
+ */
+static int compare_ranked(const void *arg1, const void *arg2, void *data)
+{
+	const struct symbol_table *symbols = data;
+	const wchar_t *a = *(const wchar_t **) arg1;
+	const wchar_t *b = *(const wchar_t **) arg2;
+	while (*a && *a == *b)
+	{
+		a++;
+		b++;
+	}
+	if (*a == L'\0' || *b == L'\0')
+		return (*a != L'\0') - (*b != L'\0');
+	uint8_t code_a, code_b;
+	symbol_table_find(symbols, *a, &code_a);
+	symbol_table_find(symbols, *b, &code_b);
+	return symbol_table_rank(symbols, code_a)
+		- symbol_table_rank(symbols, code_b);
+}
+
+/**
+ * Sortuje podpowiedzi w porządku alfabetycznym locale. Jeśli tablica
+ * symboli jest zgodna z bieżącym locale, porównuje pozycje liter,
+ * a w p.p. woła wcscoll.
+ * @param[in] dict Słownik, zawierający podpowiedzi.
+ * @param[in,out] list Lista podpowiedzi.
+ */
+static void sort_hints(const struct dictionary *dict, struct word_list *list)
+{
+	if (symbol_table_collated(dict->symbols))
+		word_list_sort_r(list, compare_ranked, dict->symbols);
+	else
+		word_list_sort(list, compare);
+}
+
+/**
+ * Zwraca kursor na korzeń słownika.
+ * @param[in] dict Słownik.
+ * @return Kursor.
+ */
+static struct cursor cursor_root(const struct dictionary *dict)
+{
+	struct cursor c = node_cursor(dict->root);
+	if (dict->graph)
+		c.vertex = dict->graph->header->root;
+	return c;
+}
+
+/**
+ * Zwraca liczbę dzieci pozycji wskazywanej przez kursor,
+ * bez ewentualnego końca słowa.
+ * @param[in] dict Słownik.
+ * @param[in] c Kursor.
+ * @return Liczba dzieci.
+ */
+static uint32_t cursor_degree(const struct dictionary *dict, struct cursor c)
+{
+	if (dict->graph)
+		return graph_last_edge(dict->graph, c.vertex)
+			- graph_first_edge(dict->graph, c.vertex);
+	return c.offset < c.node->prefix_len ? 1 : c.node->count;
+}
+
+/**
+ * Odczytuje kolejne dziecko pozycji wskazywanej przez kursor. Dzieci
+ * odczytywane są rosnąco po kluczu.
+ * @param[in] dict Słownik.
+ * @param[in] c Kursor.
+ * @param[in,out] index Pozycja, od której szukamy dziecka, na początku 0;
+ * po znalezieniu dziecka pozycja za nim.
+ * @param[out] key Klucz dziecka.
+ * @param[out] child Kursor na dziecko.
+ * @return true jeśli znaleziono dziecko, false jeśli nie ma już dzieci.
+ */
+static bool cursor_next_child(const struct dictionary *dict, struct cursor c,
+							  uint32_t *index, wchar_t *key,
+							  struct cursor *child)
+{
+	if (dict->graph)
+	{
+		uint32_t edge = graph_first_edge(dict->graph, c.vertex) + *index;
+		if (edge >= graph_last_edge(dict->graph, c.vertex))
+			return false;
+		*key = dict->graph->edges[edge].key;
+		*child = node_cursor(NULL);
+		child->vertex = dict->graph->edges[edge].target;
+		(*index)++;
+		STATS_ADD(nodes_visited, 1);
+		return true;
+	}
+	if (c.offset < c.node->prefix_len)
+	{
+		if (*index > 0)
+			return false;
+		*key = symbol_table_letter(dict->symbols,
+								   node_prefix(c.node)[c.offset]);
+		*child = c;
+		child->offset++;
+		*index = 1;
+		STATS_ADD(nodes_visited, 1);
+		return true;
+	}
+	uint8_t code;
+	const struct node *next = next_child(c.node, index, &code);
+	if (next == NULL)
+		return false;
+	*key = symbol_table_letter(dict->symbols, code);
+	*child = node_cursor(next);
+	STATS_ADD(nodes_visited, 1);
+	return true;
+}
+
+/**
+ * Przesuwa kursor do dziecka o podanym kluczu.
+ * @param[in] dict Słownik.
+ * @param[in,out] c Kursor.
+ * @param[in] key Klucz.
+ * @return true jeśli dziecko istnieje, false w p.p. (kursor bez zmian).
+ */
+static bool cursor_child(const struct dictionary *dict, struct cursor *c,
+						 wchar_t key)
+{
+	STATS_ADD(nodes_visited, 1);
+	if (dict->graph)
+		return graph_child(dict->graph, c->vertex, key, &c->vertex);
+	uint8_t code;
+	if (!symbol_table_find(dict->symbols, key, &code))
+		return false;
+	if (c->offset < c->node->prefix_len)
+	{
+		if (node_prefix(c->node)[c->offset] != code)
+			return false;
+		c->offset++;
+		return true;
+	}
+	struct node **found = find_child(c->node, code);
+	if (found == NULL)
+		return false;
+	*c = node_cursor(*found);
+	return true;
+}
+
+/**
+ * Sprawdza, czy na pozycji wskazywanej przez kursor kończy się słowo.
+ * @param[in] dict Słownik.
+ * @param[in] c Kursor.
+ * @return Wartość logiczna.
+ */
+static bool cursor_terminal(const struct dictionary *dict, struct cursor c)
+{
+	if (dict->graph)
+		return graph_is_terminal(dict->graph, c.vertex);
+	return c.offset == c.node->prefix_len && c.node->terminal;
+}
+
+/**
+ * Zwraca wagę słowa kończącego się na pozycji wskazywanej przez kursor.
+ * Graf nie przechowuje wag, więc jego słowa mają wagę 0.
+ * @param[in] dict Słownik.
+ * @param[in] c Kursor.
+ * @return Waga słowa lub 0, jeśli słowo się tu nie kończy.
+ */
+static uint32_t cursor_weight(const struct dictionary *dict, struct cursor c)
+{
+	if (dict->graph || c.offset < c.node->prefix_len)
+		return 0;
+	return c.node->weight;
+}
+
+/**
+ * Zwraca największą wagę słowa, które zaczyna się od pozycji wskazywanej
+ * przez kursor. Pozycja wewnątrz skompresowanej ścieżki ma to samo
+ * poddrzewo co jej węzeł.
+ * @param[in] dict Słownik.
+ * @param[in] c Kursor.
+ * @return Największa waga.
+ */
+static uint32_t cursor_max_weight(const struct dictionary *dict,
+								  struct cursor c)
+{
+	return dict->graph ? 0 : c.node->max_weight;
+}
+
+/**
+ * Sprawdza, czy od pozycji wskazywanej przez kursor zaczyna się
+ * ścieżka słowa 'suffix' kończąca się końcem słowa.
+ * @param[in] dict Słownik.
+ * @param[in] c Kursor.
+ * @param[in] suffix Końcówka słowa.
+ * @return Wartość logiczna.
+ */
+static bool cursor_find(const struct dictionary *dict, struct cursor c,
+						const wchar_t *suffix)
+{
+	for (; *suffix; suffix++)
+		if (!cursor_child(dict, &c, *suffix))
+			return false;
+	return cursor_terminal(dict, c);
+}
+
+/**
+ * Dodaje do listy podpowiedź powstałą ze słowa 'word' przez zastąpienie
+ * jego fragmentu od pozycji 'pos' znakiem 'c' (o ile różnym od L'\0')
+ * i końcówką 'rest'.
+ * @param[in,out] list Lista podpowiedzi.
+ * @param[in,out] buffer Bufor na co najmniej długość słowa + 2 znaki.
+ * @param[in] word Słowo.
+ * @param[in] pos Długość zachowanego początku słowa.
+ * @param[in] c Wstawiany znak lub L'\0'.
+ * @param[in] rest Końcówka.
+ */
+static void add_hint(struct word_list *list, wchar_t *buffer,
+					 const wchar_t *word, size_t pos, wchar_t c,
+					 const wchar_t *rest)
+{
+	wmemcpy(buffer, word, pos);
+	if (c != L'\0')
+		buffer[pos++] = c;
+	wcscpy(buffer + pos, rest);
+	word_list_add(list, buffer);
+}
+
+/**
+  Stan przeszukiwania słownika z automatem Levenshteina.
+  Dla każdej głębokości ścieżki w słowniku trzymany jest jeden wiersz
+  tablicy odległości edycyjnej, obcięty do wartości `k + 1`.
+ */
+struct levenshtein
+{
+	const wchar_t *word; ///< Słowo, do którego szukamy podobnych.
+	size_t width; ///< Długość słowa + 1, czyli szerokość wiersza.
+	unsigned k; ///< Maksymalna odległość.
+	uint8_t *rows; ///< Wiersze tablicy, jeden na głębokość.
+	wchar_t *path; ///< Litery bieżącej ścieżki i miejsce na L'\0'.
+	size_t capacity; ///< Liczba głębokości, na które jest miejsce.
+};
+
+/**
+ * Zapewnia miejsce na wiersz i literę ścieżki na głębokości 'depth'.
+ * @param[in,out] lev Stan przeszukiwania.
+ * @param[in] depth Głębokość.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+static bool levenshtein_reserve(struct levenshtein *lev, size_t depth)
+{
+	if (depth < lev->capacity)
+		return true;
+	size_t capacity = 2 * depth + 16;
+	uint8_t *rows = realloc(lev->rows, capacity * lev->width);
+	if (rows == NULL)
+		return false;
+	lev->rows = rows;
+	wchar_t *path = realloc(lev->path, (capacity + 1) * sizeof(wchar_t));
+	if (path == NULL)
+		return false;
+	lev->path = path;
+	STATS_ADD(allocations, 2);
+	STATS_ADD(allocated_bytes,
+			  capacity * lev->width + (capacity + 1) * sizeof(wchar_t));
+	lev->capacity = capacity;
+	return true;
+}
+
+/**
+ * Wylicza wiersz tablicy odległości dla głębokości 'depth' na podstawie
+ * poprzednich wierszy i litery 'path[depth - 1]'. Uwzględnia zamianę
+ * miejscami dwóch sąsiednich liter jako jedną zmianę.
+ * @param[in,out] lev Stan przeszukiwania.
+ * @param[in] depth Głębokość, co najmniej 1.
+ * @return Najmniejsza wartość w wierszu.
+ */
+static unsigned levenshtein_row(struct levenshtein *lev, size_t depth)
+{
+	const wchar_t *word = lev->word;
+	const wchar_t *path = lev->path;
+	size_t width = lev->width;
+	unsigned limit = lev->k + 1;
+	const uint8_t *prev = lev->rows + (depth - 1) * width;
+	const uint8_t *prev2 = depth > 1 ? prev - width : NULL;
+	uint8_t *row = lev->rows + depth * width;
+	wchar_t c = path[depth - 1];
+	unsigned best = row[0] = depth < limit ? depth : limit;
+	for (size_t j = 1; j < width; j++)
+	{
+		unsigned d = prev[j - 1] + (c != word[j - 1]);
+		if (prev[j] + 1u < d)
+			d = prev[j] + 1;
+		if (row[j - 1] + 1u < d)
+			d = row[j - 1] + 1;
+		if (prev2 && j > 1 && c == word[j - 2] && path[depth - 2] == word[j - 1]
+			&& prev2[j - 2] + 1u < d)
+			d = prev2[j - 2] + 1;
+		row[j] = d < limit ? d : limit;
+		if (row[j] < best)
+			best = row[j];
+	}
+	return best;
+}
+
+/**
+ * Funkcja pomocnicza dictionary_insert.
+ * Wstawia słowo 'word' do drzewa, w razie potrzeby dzieląc skompresowaną
+ * ścieżkę węzła, na której słowo się rozchodzi.
+ * Litery słowa muszą już być w tablicy symboli słownika.
+ * We współdzielonym słowniku węzły na drodze słowa są kopiowane.
+ * @param[in,out] dict Słownik.
+ * @param[in] word Wstawiane słowo.
+ * @return 0 jeśli słowo było już w słowniku, 1 jeśli udało się wstawić.
+ */
+static int insert_helper(struct dictionary *dict, const wchar_t *word)
+{
+	struct node **ref = &dict->root;
+	for (;;)
+	{
+		struct node *node = own(dict, ref);
+		const uint8_t *prefix = node_prefix(node);
+		unsigned common = 0;
+		while (common < node->prefix_len && word[common]
+			   && prefix[common] == known_code(dict, word[common]))
+			common++;
+		if (common < node->prefix_len)
+		{
+			split_prefix(dict, ref, common);
+			node = *ref;
+		}
+		word += common;
+		if (*word == L'\0')
+		{
+			if (node->terminal)
+				return 0;
+			node->terminal = 1;
+			return 1;
+		}
+		uint8_t key = known_code(dict, *word);
+		struct node **child = find_child(node, key);
+		if (child == NULL)
+		{
+			put_child(dict, ref, key, create_path(dict, word + 1));
+			return 1;
+		}
+		ref = child;
+		word++;
+	}
+}
+
+/**
+ * Wstawia słowo do drzewa, dodając jego litery do tablicy symboli,
+ * i uwzględnia je w podsumowaniu.
+ * @param[in,out] dict Słownik w postaci drzewa.
+ * @param[in] word Wstawiane słowo.
+ * @return 0 jeśli słowo było już w słowniku, 1 jeśli udało się wstawić,
+ * <0 jeśli litery słowa nie mieszczą się w tablicy symboli lub zabrakło
+ * pamięci.
+ */
+static int insert_word(struct dictionary *dict, const wchar_t *word)
+{
+	const wchar_t *letter = word;
+	for (; *letter; letter++)
+	{
+		uint8_t code;
+		if (!symbol_code(dict, *letter, &code))
+			return -1;
+	}
+	if (!summary_reserve(dict->summary, letter - word))
+		return -1;
+	int result = insert_helper(dict, word);
+	if (result == 1)
+		summary_update(dict, word, true);
+	return result;
+}
+
+/**
+ * Funkcja pomocnicza dictionary_find.
+ * @param[in] dict Słownik w postaci drzewa.
+ * @param[in] word Szukane słowo.
+ * @return Wartość logiczna czy `word` jest w drzewie.
+ */
+static bool find_helper(const struct dictionary *dict, const wchar_t *word)
+{
+	const struct node *node = dict->root;
+	for (;;)
+	{
+		STATS_ADD(nodes_visited, 1);
+		const uint8_t *prefix = node_prefix(node);
+		uint8_t code;
+		for (unsigned i = 0; i < node->prefix_len; i++, word++)
+			if (!symbol_table_find(dict->symbols, *word, &code)
+				|| code != prefix[i])
+				return false;
+		if (*word == L'\0')
+			return node->terminal;
+		struct node **child;
+		if (!symbol_table_find(dict->symbols, *word, &code)
+			|| (child = find_child(node, code)) == NULL)
+			return false;
+		node = *child;
+		word++;
+	}
+}
+
+/**
+ * Wykonuje jeden krok wyszukiwania w drzewie: przechodzi skompresowaną
+ * ścieżkę bieżącego węzła i schodzi do dziecka, które od razu zaczyna
+ * pobierać do pamięci podręcznej.
+ * @param[in] dict Słownik w postaci drzewa.
+ * @param[in,out] lane Wyszukiwanie.
+ * @param[out] found Tablica wyników.
+ * @return true jeśli wyszukiwanie się zakończyło, false w p.p.
+ */
+static bool find_step(const struct dictionary *dict, struct find_lane *lane,
+					  bool *found)
+{
+	const struct node *node = lane->node;
+	const wchar_t *word = lane->word;
+	const uint8_t *prefix = node_prefix(node);
+	uint8_t code;
+	STATS_ADD(nodes_visited, 1);
+	found[lane->slot] = false;
+	for (unsigned i = 0; i < node->prefix_len; i++, word++)
+		if (!symbol_table_find(dict->symbols, *word, &code)
+			|| code != prefix[i])
+			return true;
+	if (*word == L'\0')
+	{
+		found[lane->slot] = node->terminal;
+		return true;
+	}
+	struct node **child;
+	if (!symbol_table_find(dict->symbols, *word, &code)
+		|| (child = find_child(node, code)) == NULL)
+		return true;
+	__builtin_prefetch(*child);
+	lane->node = *child;
+	lane->word = word + 1;
+	return false;
+}
+
+/**
+ * Zapisuje do bufora klucz i ilość dzieci jednego węzła.
+ * @param[in,out] writer Pisarz.
+ * @param[in] key Klucz.
+ * @param[in] size Ilość dzieci.
+ */
+static void write_node(struct text_writer *writer, wchar_t key, unsigned size)
+{
+	text_write_char(writer, key);
+	text_write_int(writer, size);
+}
+
+/**
+ * Funkcja pomocnicza dictionary_save.
+ * Zapisuje słownik w kolejności przeszukiwania w głąb, bez rekurencji,
+ * po jednej literze w każdym zapisanym węźle, niezależnie od
+ * reprezentacji. Koniec słowa zapisywany jest jako dziecko z kluczem
+ * NULL_MARKER, a korzeń ma klucz NULL_MARKER. Zamiast liczby dzieci
+ * koniec słowa ma wagę słowa, więc w plikach sprzed wprowadzenia wag
+ * wszystkie słowa mają wagę 0.
+ * @param[in] dict Słownik.
+ * @param[in,out] stream Strumień.
+ * @return <0 jeśli operacja się nie powiedzie, 0 w p.p.
+ */
+static int serialize(const struct dictionary *dict, FILE* stream)
+{
+	struct text_writer writer;
+	struct stack stack = { NULL, 0, 0 };
+	struct cursor c = cursor_root(dict);
+	wchar_t key = NULL_MARKER;
+	bool valid = text_writer_init(&writer, stream);
+	while (valid)
+	{
+		bool terminal = cursor_terminal(dict, c);
+		uint32_t degree = cursor_degree(dict, c);
+		write_node(&writer, key, degree + terminal);
+		if (terminal)
+			write_node(&writer, NULL_MARKER, cursor_weight(dict, c));
+		if (degree > 0 && !stack_push(&stack, c, 0))
+			valid = false;
+		while (stack.size > 0
+			   && !cursor_next_child(dict, stack_top(&stack)->cursor,
+									 &stack_top(&stack)->index, &key, &c))
+			stack.size--;
+		if (stack.size == 0)
+			break;
+	}
+	free(stack.frames);
+	if (text_writer_done(&writer) || !valid)
+		return -1;
+	return 0;
+}
+
+/**
+ * Zapewnia miejsce na 'size' znaków w buforze słowa.
+ * @param[in,out] word Bufor.
+ * @param[in,out] capacity Rozmiar bufora.
+ * @param[in] size Potrzebna liczba znaków.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+static bool reserve_word(wchar_t **word, size_t *capacity, size_t size)
+{
+	if (size <= *capacity)
+		return true;
+	size_t new_capacity = 2 * size + 16;
+	wchar_t *new_word = realloc(*word, new_capacity * sizeof(wchar_t));
+	if (new_word == NULL)
+		return false;
+	*word = new_word;
+	*capacity = new_capacity;
+	return true;
+}
+
+/**
+ * Funkcja pomocnicza dictionary_load.
+ * Wstawia do drzewa słowa zapisane w pliku 'stream' przez serialize(),
+ * razem z ich wagami.
+ * Plik czytany jest dużymi blokami, bez rekurencji: na stosie leży liczba
+ * brakujących dzieci każdego węzła bieżącej ścieżki, a litery ścieżki
+ * w osobnym buforze.
+ * @param[in,out] dict Słownik w postaci drzewa.
+ * @param[in] stream Plik.
+ * @return <0 jeśli operacja się nie powiedzie, 0 w p.p
+ */
+static int deserialize(struct dictionary *dict, FILE* stream)
+{
+	int valid = 0;
+	struct text_reader reader;
+	struct stack stack = { NULL, 0, 0 };
+	wchar_t *path = NULL;
+	size_t capacity = 0;
+	bool root = true;
+	if (!text_reader_init(&reader, stream))
+		valid = -1;
+	else do
+	{
+		wchar_t key;
+		int size;
+		size_t depth = stack.size;
+		if (!text_read_char(&reader, &key) || !text_read_int(&reader, &size)
+			|| !reserve_word(&path, &capacity, depth + 1))
+		{
+			valid = -1;
+			break;
+		}
+		if (!root)
+		{
+			stack_top(&stack)->index--;
+			if (key == NULL_MARKER)
+			{
+				path[depth - 1] = L'\0';
+				if (insert_word(dict, path) < 0)
+				{
+					valid = -1;
+					break;
+				}
+				if (size > 0)
+					set_weight(dict, path, size);
+				/* Liczba po końcu słowa to jego waga. */
+				size = 0;
+			}
+			else
+				path[depth - 1] = key;
+		}
+		root = false;
+		if (size > 0 && !stack_push(&stack, node_cursor(NULL), size))
+		{
+			valid = -1;
+			break;
+		}
+		while (stack.size > 0 && stack_top(&stack)->index == 0)
+			stack.size--;
+	} while (stack.size > 0);
+	if (!text_reader_done(&reader))
+		valid = -1;
+	free(stack.frames);
+	free(path);
+	return valid;
+}
+
+/**
+ * Wywołuje funkcję 'visit' dla każdego słowa słownika.
+ * @param[in] dict Słownik.
+ * @param[in] visit Funkcja wywoływana ze słowem; zwrócenie false
+ * przerywa przechodzenie.
+ * @param[in,out] data Dane przekazywane do 'visit'.
+ * @return <0 jeśli zabrakło pamięci lub przechodzenie zostało przerwane,
+ * 0 w p.p.
+ */
+static int for_each_word(const struct dictionary *dict,
+						 bool (*visit)(void *data, const wchar_t *word),
+						 void *data)
+{
+	struct stack stack = { NULL, 0, 0 };
+	wchar_t *path = NULL;
+	size_t capacity = 0;
+	bool valid = stack_push(&stack, cursor_root(dict), 0);
+	while (valid && stack.size > 0)
+	{
+		struct frame *top = stack_top(&stack);
+		size_t depth = stack.size - 1;
+		if (!(valid = reserve_word(&path, &capacity, depth + 1)))
+			break;
+		if (top->index == 0 && cursor_terminal(dict, top->cursor))
+		{
+			path[depth] = L'\0';
+			if (!(valid = visit(data, path)))
+				break;
+		}
+		wchar_t key;
+		struct cursor child;
+		if (!cursor_next_child(dict, top->cursor, &top->index, &key, &child))
+		{
+			stack.size--;
+			continue;
+		}
+		path[depth] = key;
+		valid = stack_push(&stack, child, 0);
+	}
+	free(stack.frames);
+	free(path);
+	return valid ? 0 : -1;
+}
+
+/**
+ * Wstawia słowo do odtwarzanego drzewa; funkcja dla for_each_word().
+ * @param[in,out] data Słownik.
+ * @param[in] word Słowo.
+ * @return true.
+ */
+static bool thaw_word(void *data, const wchar_t *word)
+{
+	insert_helper(data, word);
+	return true;
+}
+
+/**
+ * Uwzględnia słowo w wyliczanym podsumowaniu; funkcja dla for_each_word().
+ * @param[in,out] data Słownik.
+ * @param[in] word Słowo.
+ * @return true jeśli się udało, false jeśli litery słowa nie mieszczą się
+ * w tablicy symboli lub zabrakło pamięci.
+ */
+static bool summarize_word(void *data, const wchar_t *word)
+{
+	struct dictionary *dict = data;
+	const wchar_t *letter = word;
+	for (; *letter; letter++)
+	{
+		uint8_t code;
+		if (!symbol_code(dict, *letter, &code))
+			return false;
+	}
+	if (!summary_reserve(dict->summary, letter - word))
+		return false;
+	summary_update(dict, word, true);
+	return true;
+}
+
+/**
+ * Wylicza podsumowanie słownika w postaci grafu, jeśli nie jest jeszcze
+ * wyliczone. Drzewo nie istnieje, więc dodawanie liter do tablicy symboli
+ * niczego nie przenumerowuje.
+ * @param[in,out] dict Słownik.
+ * @return true jeśli podsumowanie jest wyliczone, false jeśli litery
+ * grafu nie mieszczą się w tablicy symboli lub zabrakło pamięci.
+ */
+static bool summarize(struct dictionary *dict)
+{
+	struct summary *summary = dict->summary;
+	if (summary->ready)
+		return true;
+	summary->ready = for_each_word(dict, summarize_word, dict) == 0;
+	if (!summary->ready)
+	{
+		/* Przy następnej próbie liczymy od nowa. */
+		summary->words = summary->max_length = 0;
+		memset(summary->letters, 0, sizeof(summary->letters));
+		if (summary->lengths)
+			memset(summary->lengths, 0,
+				   summary->lengths_size * sizeof(size_t));
+	}
+	return summary->ready;
+}
+
+/**
+ * Zwraca podsumowanie słownika, w razie potrzeby je wyliczając.
+ * Wyliczenie nie zmienia słów słownika, a jedynie jego tablicę symboli
+ * i podsumowanie, więc słownik może być stały.
+ * @param[in] dict Słownik.
+ * @return Podsumowanie; puste, jeśli nie udało się go wyliczyć.
+ */
+static const struct summary * ready_summary(const struct dictionary *dict)
+{
+	summarize((struct dictionary *) dict);
+	return dict->summary;
+}
+
+/**
+ * Zamienia słownik w postaci grafu z powrotem na drzewo TRIE,
+ * aby można go było modyfikować.
+ * @param[in,out] dict Słownik.
+ * @return true jeśli się udało, false jeśli litery grafu nie mieszczą się
+ * w tablicy symboli lub zabrakło pamięci.
+ */
+static bool thaw(struct dictionary *dict)
+{
+	const struct graph *graph = dict->graph;
+	if (graph == NULL)
+		return true;
+	if (!summarize(dict))
+		return false;
+	/* Drzewa jeszcze nie ma, więc dodawanie liter niczego nie
+	   przenumerowuje. */
+	for (uint32_t i = 0; i < graph->header->edge_count; i++)
+	{
+		uint8_t code;
+		if (!symbol_code(dict, graph->edges[i].key, &code))
+			return false;
+	}
+	/* Dopóki graf jest ustawiony, for_each_word() czyta z niego, a słowa
+	   trafiają do budowanego obok drzewa. */
+	dict->root = create_node(dict, NODE_0, 0);
+	bool thawed = for_each_word(dict, thaw_word, dict) == 0;
+	assert(thawed);
+	graph_done(dict->graph);
+	dict->graph = NULL;
+	return true;
+}
+
+/**
+ * Liczy pozycje słownika, czyli węzły grafu z tymi samymi słowami.
+ * @param[in] dict Słownik.
+ * @return Liczba pozycji lub 0, jeśli zabrakło pamięci.
+ */
+static uint32_t count_nodes(const struct dictionary *dict)
+{
+	struct stack stack = { NULL, 0, 0 };
+	uint32_t count = 1;
+	bool valid = stack_push(&stack, cursor_root(dict), 0);
+	while (valid && stack.size > 0)
+	{
+		struct frame *top = stack_top(&stack);
+		wchar_t key;
+		struct cursor child;
+		if (!cursor_next_child(dict, top->cursor, &top->index, &key, &child))
+		{
+			stack.size--;
+			continue;
+		}
+		count++;
+		valid = stack_push(&stack, child, 0);
+	}
+	free(stack.frames);
+	return valid ? count : 0;
+}
+
+/**
+ * Zapisuje słownik w postaci grafu, po jednej literze na krawędź.
+ * Węzły numerowane są w kolejności przeszukiwania wszerz, dzięki czemu
+ * krawędzie kolejnych węzłów leżą w tablicy jedna za drugą.
+ * Graf nie przechowuje wag słów, więc słownika ze słowami o dodatniej
+ * wadze nie da się zapisać w tej postaci.
+ * @param[in] dict Słownik w postaci drzewa.
+ * @return Nowy graf lub NULL, jeśli słownik ma wagi lub zabrakło pamięci.
+ */
+static struct graph * flatten(const struct dictionary *dict)
+{
+	if (cursor_max_weight(dict, cursor_root(dict)) > 0)
+		return NULL;
+	uint32_t node_count = count_nodes(dict);
+	if (node_count == 0)
+		return NULL;
+	struct graph *graph = graph_new(node_count, node_count - 1);
+	struct cursor *queue = malloc(node_count * sizeof(struct cursor));
+	if (graph == NULL || queue == NULL)
+	{
+		graph_done(graph);
+		free(queue);
+		return NULL;
+	}
+	uint32_t tail = 0;
+	uint32_t edge = 0;
+	queue[tail++] = cursor_root(dict);
+	for (uint32_t head = 0; head < node_count; head++)
+	{
+		struct cursor node = queue[head];
+		graph->nodes[head] = edge << 1 | cursor_terminal(dict, node);
+		uint32_t index = 0;
+		wchar_t key;
+		struct cursor child;
+		while (cursor_next_child(dict, node, &index, &key, &child))
+		{
+			graph->edges[edge].key = key;
+			graph->edges[edge].target = tail;
+			edge++;
+			queue[tail++] = child;
+		}
+	}
+	graph->nodes[node_count] = edge << 1;
+	graph->header->root = 0;
+	free(queue);
+	return graph;
+}
+
+/**
+ * Funkcja pomocnicza dictionary_build_sorted.
+ * Dopisuje do budowanego słownika słowo 'word', następujące w porządku
+ * rosnącym po słowie 'prev'.
+ * @param[in,out] dict Słownik.
+ * @param[in] prev Poprzednie słowo lub NULL.
+ * @param[in] word Słowo.
+ * @return 1 jeśli wstawiono słowo, 0 jeśli jest równe poprzedniemu,
+ * <0 jeśli słowa nie są posortowane lub zabrakło kodów liter.
+ */
+static int build_next(struct dictionary *dict, const wchar_t *prev,
+					  const wchar_t *word)
+{
+	if (prev != NULL)
+	{
+		size_t lcp = 0;
+		while (prev[lcp] && prev[lcp] == word[lcp])
+			lcp++;
+		if (prev[lcp] == word[lcp])
+			return 0;
+		if (word[lcp] < prev[lcp])
+			return -1;
+	}
+	return insert_word(dict, word);
+}
+
+/**
+ * Tworzy pusty słownik bez korzenia.
+ * @return Nowy słownik.
+ */
+static struct dictionary * dictionary_alloc(void)
+{
+	struct dictionary *dict = malloc(sizeof(struct dictionary));
+	assert(dict != NULL);
+	arena_init(&dict->arena);
+	dict->symbols = malloc(sizeof(struct symbol_table));
+	assert(dict->symbols != NULL);
+	symbol_table_init(dict->symbols, NULL_MARKER);
+	dict->root = NULL;
+	dict->graph = NULL;
+	dict->index = NULL;
+	dict->generation = 0;
+	dict->shared = NULL;
+	dict->summary = calloc(1, sizeof(struct summary));
+	assert(dict->summary != NULL);
+	dict->summary->ready = true;
+	return dict;
+}
+
+/**
+ * Dodaje słowo do indeksu podpowiedzi; funkcja dla for_each_word().
+ * @param[in,out] data Indeks.
+ * @param[in] word Słowo.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+static bool index_word(void *data, const wchar_t *word)
+{
+	return hint_index_add(data, word);
+}
+
+/**
+  Stan sprawdzania, czy indeks podpowiedzi pasuje do słownika.
+ */
+struct index_check
+{
+	const struct hint_index *index; ///< Sprawdzany indeks.
+	uint32_t count; ///< Liczba słów słownika.
+};
+
+/**
+ * Sprawdza, czy słowo słownika jest w indeksie; funkcja dla
+ * for_each_word().
+ * @param[in,out] data Stan sprawdzania.
+ * @param[in] word Słowo.
+ * @return Wartość logiczna czy słowo jest w indeksie.
+ */
+static bool check_word(void *data, const wchar_t *word)
+{
+	struct index_check *check = data;
+	check->count++;
+	return hint_index_contains(check->index, word);
+}
+
+/**
+ * Dodaje do listy słowo ze ścieżki przeszukiwania, jeśli w węźle kończy
+ * się słowo odległe od szukanego o co najwyżej k.
+ * @param[in] dict Słownik.
+ * @param[in,out] lev Stan przeszukiwania.
+ * @param[in] c Kursor na węzeł na końcu ścieżki.
+ * @param[in] depth Długość ścieżki.
+ * @param[in,out] list Lista podpowiedzi.
+ */
+static void levenshtein_emit(const struct dictionary *dict,
+							 struct levenshtein *lev, struct cursor c,
+							 size_t depth, struct word_list *list)
+{
+	if (lev->rows[depth * lev->width + lev->width - 1] <= lev->k
+		&& cursor_terminal(dict, c))
+	{
+		lev->path[depth] = L'\0';
+		word_list_add(list, lev->path);
+	}
+}
+
+/**
+  Numer kroku oznaczający pustą ścieżkę, czyli sam prefiks.
+ */
+#define COMPLETION_ROOT UINT32_MAX
+
+/**
+  Kandydat przeszukiwania dictionary_complete(): poddrzewo słownika,
+  ocenione największą wagą słowa w nim, albo pojedyncze słowo.
+ */
+struct completion
+{
+	uint32_t weight; ///< Waga słowa lub największa waga w poddrzewie.
+	uint32_t step; ///< Ostatni krok ścieżki od prefiksu lub COMPLETION_ROOT.
+	bool word; ///< Czy kandydat jest słowem, czy poddrzewem.
+	struct cursor cursor; ///< Pozycja w słowniku.
+};
+
+/**
+  Krok ścieżki od prefiksu do kandydata. Kroki wszystkich kandydatów
+  tworzą drzewo, w którym każdy krok wskazuje poprzedni.
+ */
+struct completion_step
+{
+	wchar_t key; ///< Litera.
+	uint32_t parent; ///< Poprzedni krok lub COMPLETION_ROOT.
+	uint32_t depth; ///< Długość ścieżki do tego kroku włącznie.
+};
+
+/**
+  Stan przeszukiwania dictionary_complete(): kopiec kandydatów, drzewo
+  kroków ich ścieżek i bufor na wypisywane słowo.
+ */
+struct completer
+{
+	struct completion *heap; ///< Kopiec kandydatów, największy na szczycie.
+	size_t size; ///< Liczba kandydatów.
+	size_t capacity; ///< Rozmiar tablicy kandydatów.
+	struct completion_step *steps; ///< Kroki ścieżek.
+	size_t steps_size; ///< Liczba kroków.
+	size_t steps_capacity; ///< Rozmiar tablicy kroków.
+	wchar_t *word; ///< Bufor na słowo.
+	size_t word_capacity; ///< Rozmiar bufora na słowo.
+};
+
+/**
+ * Porównuje leksykograficznie ścieżki od prefiksu do dwóch kroków.
+ * Ścieżka będąca początkiem drugiej jest od niej mniejsza.
+ * @param[in] comp Stan przeszukiwania.
+ * @param[in] a Ostatni krok pierwszej ścieżki lub COMPLETION_ROOT.
+ * @param[in] b Ostatni krok drugiej ścieżki lub COMPLETION_ROOT.
+ * @return <0, 0 lub >0, jak wcscmp().
+ */
+static int completer_compare(const struct completer *comp, uint32_t a,
+							 uint32_t b)
+{
+	uint32_t depth_a = a == COMPLETION_ROOT ? 0 : comp->steps[a].depth;
+	uint32_t depth_b = b == COMPLETION_ROOT ? 0 : comp->steps[b].depth;
+	int shorter = (depth_a > depth_b) - (depth_a < depth_b);
+	for (; depth_a > depth_b; depth_a--)
+		a = comp->steps[a].parent;
+	for (; depth_b > depth_a; depth_b--)
+		b = comp->steps[b].parent;
+	if (a == b)
+		return shorter;
+	while (comp->steps[a].parent != comp->steps[b].parent)
+	{
+		a = comp->steps[a].parent;
+		b = comp->steps[b].parent;
+	}
+	return (comp->steps[a].key > comp->steps[b].key)
+		- (comp->steps[a].key < comp->steps[b].key);
+}
+
+/**
+ * Sprawdza, czy kandydat 'a' powinien być rozpatrzony przed 'b'.
+ * Przy równych wagach pierwszy jest kandydat o mniejszej ścieżce; słowo
+ * i poddrzewo o tej samej ścieżce nie są nigdy naraz w kopcu, a żaden
+ * kandydat nie leży w poddrzewie innego, więc słowa o równych wagach
+ * trafiają na listę w porządku wcscmp().
+ * @param[in] comp Stan przeszukiwania.
+ * @param[in] a Kandydat.
+ * @param[in] b Kandydat.
+ * @return Wartość logiczna.
+ */
+static bool completion_before(const struct completer *comp,
+							  const struct completion *a,
+							  const struct completion *b)
+{
+	return a->weight > b->weight
+		|| (a->weight == b->weight
+			&& completer_compare(comp, a->step, b->step) < 0);
+}
+
+/**
+ * Dodaje kandydata do kopca.
+ * @param[in,out] comp Stan przeszukiwania.
+ * @param[in] item Kandydat.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+static bool completer_push(struct completer *comp,
+						   const struct completion *item)
+{
+	if (comp->size == comp->capacity)
+	{
+		size_t capacity = 2 * comp->capacity + 64;
+		struct completion *heap =
+			realloc(comp->heap, capacity * sizeof(struct completion));
+		if (heap == NULL)
+			return false;
+		comp->heap = heap;
+		comp->capacity = capacity;
+	}
+	size_t i = comp->size++;
+	while (i > 0 && completion_before(comp, item, &comp->heap[(i - 1) / 2]))
+	{
+		comp->heap[i] = comp->heap[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	comp->heap[i] = *item;
+	return true;
+}
+
+/**
+ * Zdejmuje z kopca najlepszego kandydata.
+ * @param[in,out] comp Stan przeszukiwania z niepustym kopcem.
+ * @param[out] item Kandydat.
+ */
+static void completer_pop(struct completer *comp, struct completion *item)
+{
+	*item = comp->heap[0];
+	struct completion last = comp->heap[--comp->size];
+	size_t i = 0;
+	for (;;)
+	{
+		size_t child = 2 * i + 1;
+		if (child >= comp->size)
+			break;
+		if (child + 1 < comp->size
+			&& completion_before(comp, &comp->heap[child + 1],
+								 &comp->heap[child]))
+			child++;
+		if (!completion_before(comp, &comp->heap[child], &last))
+			break;
+		comp->heap[i] = comp->heap[child];
+		i = child;
+	}
+	comp->heap[i] = last;
+}
+
+/**
+ * Dodaje krok ścieżki.
+ * @param[in,out] comp Stan przeszukiwania.
+ * @param[in] key Litera.
+ * @param[in,out] step Poprzedni krok; po dodaniu nowy krok.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+static bool completer_step(struct completer *comp, wchar_t key,
+						   uint32_t *step)
+{
+	if (comp->steps_size == comp->steps_capacity)
+	{
+		size_t capacity = 2 * comp->steps_capacity + 64;
+		struct completion_step *steps = realloc(comp->steps,
+			capacity * sizeof(struct completion_step));
+		if (steps == NULL)
+			return false;
+		comp->steps = steps;
+		comp->steps_capacity = capacity;
+	}
+	comp->steps[comp->steps_size].key = key;
+	comp->steps[comp->steps_size].parent = *step;
+	comp->steps[comp->steps_size].depth =
+		*step == COMPLETION_ROOT ? 1 : comp->steps[*step].depth + 1;
+	*step = comp->steps_size++;
+	return true;
+}
+
+/**
+ * Dodaje do listy słowo złożone z prefiksu i ścieżki kroku 'step'.
+ * @param[in,out] comp Stan przeszukiwania.
+ * @param[in] prefix Prefiks.
+ * @param[in] prefix_len Długość prefiksu.
+ * @param[in] step Ostatni krok ścieżki.
+ * @param[in,out] list Lista słów.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+static bool completer_emit(struct completer *comp, const wchar_t *prefix,
+						   size_t prefix_len, uint32_t step,
+						   struct word_list *list)
+{
+	size_t len = prefix_len;
+	for (uint32_t s = step; s != COMPLETION_ROOT; s = comp->steps[s].parent)
+		len++;
+	if (!reserve_word(&comp->word, &comp->word_capacity, len + 1))
+		return false;
+	wmemcpy(comp->word, prefix, prefix_len);
+	comp->word[len] = L'\0';
+	for (uint32_t s = step; s != COMPLETION_ROOT; s = comp->steps[s].parent)
+		comp->word[--len] = comp->steps[s].key;
+	return word_list_add(list, comp->word);
+}
+
+/**
+ * Rozpatruje kandydata-poddrzewo: schodzi ścieżką bez rozgałęzień
+ * i dodaje do kopca słowo z końca ścieżki oraz poddrzewa jej dzieci.
+ * Słowo o wadze równej wadze kandydata jest najlepsze ze wszystkich
+ * pozostałych, więc trafia od razu na listę.
+ * @param[in] dict Słownik.
+ * @param[in,out] comp Stan przeszukiwania.
+ * @param[in] top Kandydat zdjęty z kopca.
+ * @param[in] prefix Prefiks.
+ * @param[in] prefix_len Długość prefiksu.
+ * @param[in,out] list Lista słów.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+static bool completer_expand(const struct dictionary *dict,
+							 struct completer *comp, struct completion top,
+							 const wchar_t *prefix, size_t prefix_len,
+							 struct word_list *list)
+{
+	uint32_t index;
+	wchar_t key;
+	struct cursor child;
+	bool terminal;
+	uint32_t degree;
+	while (!(terminal = cursor_terminal(dict, top.cursor))
+		   && (degree = cursor_degree(dict, top.cursor)) == 1)
+	{
+		index = 0;
+		cursor_next_child(dict, top.cursor, &index, &key, &top.cursor);
+		if (!completer_step(comp, key, &top.step))
+			return false;
+	}
+	if (terminal)
+	{
+		struct completion word = {
+			cursor_weight(dict, top.cursor), top.step, true, top.cursor
+		};
+		if (word.weight == top.weight
+			? !completer_emit(comp, prefix, prefix_len, top.step, list)
+			: !completer_push(comp, &word))
+			return false;
+	}
+	index = 0;
+	while (cursor_next_child(dict, top.cursor, &index, &key, &child))
+	{
+		struct completion next = {
+			cursor_max_weight(dict, child), top.step, false, child
+		};
+		if (!completer_step(comp, key, &next.step)
+			|| !completer_push(comp, &next))
+			return false;
+	}
+	return true;
+}
+
+/**
+  Rodzaje zmian, z których powstają podpowiedzi dictionary_hints_ex(),
+  od najbardziej prawdopodobnej literówki.
+ */
+enum hint_edit
+{
+	HINT_SAME, ///< Samo słowo.
+	HINT_SUBSTITUTION, ///< Zamiana litery, np. brak polskiego znaku.
+	HINT_INSERTION, ///< Wstawienie litery pominiętej w słowie.
+	HINT_DELETION, ///< Usunięcie litery nadmiarowej.
+	HINT_EDITS ///< Liczba rodzajów zmian.
+};
+
+/**
+  Co ile odwiedzonych węzłów dictionary_hints_ex() sprawdza zegar.
+ */
+#define HINT_CLOCK_NODES 256
+
+/**
+  Podpowiedź zapamiętana przez dictionary_hints_ex().
+ */
+struct ranked_hint
+{
+	uint32_t weight; ///< Waga słowa.
+	uint8_t edit; ///< Rodzaj zmiany, enum hint_edit.
+	size_t slot; ///< Miejsce słowa w buforze słów.
+};
+
+/**
+  Stan wyszukiwania dictionary_hints_ex(): kopiec najlepszych dotąd
+  podpowiedzi, z najgorszą na szczycie, ich słowa i zużycie budżetu.
+  Miejsce 0 bufora słów zajmuje sprawdzany kandydat.
+ */
+struct hint_ranker
+{
+	const struct dictionary *dict; ///< Słownik.
+	const wchar_t *word; ///< Słowo, dla którego szukamy podpowiedzi.
+	size_t len; ///< Długość słowa.
+	size_t limit; ///< Największa liczba podpowiedzi.
+	struct ranked_hint *heap; ///< Kopiec podpowiedzi.
+	size_t size; ///< Liczba podpowiedzi.
+	size_t capacity; ///< Rozmiar kopca.
+	wchar_t *words; ///< Słowa, po długość słowa + 2 znaki na miejsce.
+	uint64_t nodes; ///< Liczba odwiedzonych węzłów.
+	uint64_t max_nodes; ///< Budżet węzłów lub 0.
+	uint64_t deadline; ///< Koniec budżetu czasu lub 0.
+	uint64_t next_clock; ///< Liczba węzłów przy następnym odczycie zegara.
+	bool exhausted; ///< Czy budżet się wyczerpał.
+	bool valid; ///< Czy nie zabrakło pamięci.
+};
+
+/**
+ * Zwraca miejsce na słowo w buforze słów.
+ * @param[in] r Stan wyszukiwania.
+ * @param[in] slot Numer miejsca.
+ * @return Wskaźnik na miejsce.
+ */
+static wchar_t * hint_word(const struct hint_ranker *r, size_t slot)
+{
+	return r->words + slot * (r->len + 2);
+}
+
+/**
+ * Sprawdza, czy podpowiedź 'a' jest gorsza od 'b': powstała z mniej
+ * prawdopodobnej zmiany, ma mniejszą wagę lub jest dalej alfabetycznie.
+ * @param[in] r Stan wyszukiwania.
+ * @param[in] a Podpowiedź.
+ * @param[in] b Podpowiedź.
+ * @return Wartość logiczna.
+ */
+static bool hint_worse(const struct hint_ranker *r,
+					   const struct ranked_hint *a, const struct ranked_hint *b)
+{
+	if (a->edit != b->edit)
+		return a->edit > b->edit;
+	if (a->weight != b->weight)
+		return a->weight < b->weight;
+	const wchar_t *x = hint_word(r, a->slot);
+	const wchar_t *y = hint_word(r, b->slot);
+	if (symbol_table_collated(r->dict->symbols))
+		return compare_ranked(&x, &y, r->dict->symbols) > 0;
+	return wcscoll(x, y) > 0;
+}
+
+/**
+ * Przesuwa podpowiedź w dół kopca na właściwe miejsce.
+ * @param[in,out] r Stan wyszukiwania.
+ * @param[in] i Pozycja podpowiedzi.
+ * @param[in] size Rozmiar kopca.
+ */
+static void hint_sift_down(struct hint_ranker *r, size_t i, size_t size)
+{
+	struct ranked_hint item = r->heap[i];
+	for (;;)
+	{
+		size_t child = 2 * i + 1;
+		if (child >= size)
+			break;
+		if (child + 1 < size
+			&& hint_worse(r, &r->heap[child + 1], &r->heap[child]))
+			child++;
+		if (!hint_worse(r, &r->heap[child], &item))
+			break;
+		r->heap[i] = r->heap[child];
+		i = child;
+	}
+	r->heap[i] = item;
+}
+
+/**
+ * Zużywa budżet na odwiedzenie jednego węzła.
+ * Zegar sprawdzany jest co HINT_CLOCK_NODES węzłów.
+ * @param[in,out] r Stan wyszukiwania.
+ * @return true jeśli węzeł można odwiedzić, false jeśli budżet się
+ * wyczerpał.
+ */
+static bool hint_visit(struct hint_ranker *r)
+{
+	if (r->exhausted)
+		return false;
+	if (r->max_nodes && r->nodes == r->max_nodes)
+		r->exhausted = true;
+	else if (r->deadline && r->nodes == r->next_clock)
+	{
+		r->next_clock += HINT_CLOCK_NODES;
+		r->exhausted = stats_clock() >= r->deadline;
+	}
+	r->nodes += !r->exhausted;
+	return !r->exhausted;
+}
+
+/**
+ * Zapamiętuje podpowiedź z miejsca 0 bufora słów, jeśli w kopcu jest
+ * miejsce lub jest ona lepsza od najgorszej z zapamiętanych.
+ * @param[in,out] r Stan wyszukiwania.
+ * @param[in] edit Rodzaj zmiany.
+ * @param[in] weight Waga słowa.
+ */
+static void hint_keep(struct hint_ranker *r, enum hint_edit edit,
+					  uint32_t weight)
+{
+	struct ranked_hint entry = { weight, edit, 0 };
+	if (r->size == r->limit)
+	{
+		if (!hint_worse(r, &r->heap[0], &entry))
+			return;
+		entry.slot = r->heap[0].slot;
+		wcscpy(hint_word(r, entry.slot), hint_word(r, 0));
+		r->heap[0] = entry;
+		hint_sift_down(r, 0, r->size);
+		return;
+	}
+	if (r->size == r->capacity)
+	{
+		size_t capacity = 2 * r->capacity + 16;
+		if (capacity > r->limit)
+			capacity = r->limit;
+		struct ranked_hint *heap =
+			realloc(r->heap, capacity * sizeof(struct ranked_hint));
+		if (heap != NULL)
+			r->heap = heap;
+		wchar_t *words = heap == NULL ? NULL : realloc(r->words,
+			(capacity + 1) * (r->len + 2) * sizeof(wchar_t));
+		if (words == NULL)
+		{
+			r->valid = false;
+			return;
+		}
+		r->words = words;
+		r->capacity = capacity;
+	}
+	entry.slot = r->size + 1;
+	wcscpy(hint_word(r, entry.slot), hint_word(r, 0));
+	size_t i = r->size++;
+	while (i > 0 && hint_worse(r, &entry, &r->heap[(i - 1) / 2]))
+	{
+		r->heap[i] = r->heap[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	r->heap[i] = entry;
+}
+
+/**
+ * Sprawdza kandydata powstałego ze słowa przez zastąpienie jego
+ * fragmentu od pozycji 'pos' znakiem 'key' (o ile różnym od L'\0')
+ * i końcówką 'rest', szukaną w słowniku od pozycji 'c'.
+ * Gdy kopiec jest pełny, pomija kandydatów gorszego rodzaju
+ * i poddrzewa lżejsze od najgorszej podpowiedzi tego samego rodzaju.
+ * @param[in,out] r Stan wyszukiwania.
+ * @param[in] edit Rodzaj zmiany.
+ * @param[in] c Pozycja, od której szukana jest końcówka.
+ * @param[in] pos Długość zachowanego początku słowa.
+ * @param[in] key Wstawiany znak lub L'\0'.
+ * @param[in] rest Końcówka.
+ */
+static void hint_offer(struct hint_ranker *r, enum hint_edit edit,
+					   struct cursor c, size_t pos, wchar_t key,
+					   const wchar_t *rest)
+{
+	STATS_ADD(hint_candidates, 1);
+	if (r->size == r->limit
+		&& (edit > r->heap[0].edit
+			|| (edit == r->heap[0].edit
+				&& cursor_max_weight(r->dict, c) < r->heap[0].weight)))
+		return;
+	for (const wchar_t *letter = rest; *letter; letter++)
+		if (!hint_visit(r) || !cursor_child(r->dict, &c, *letter))
+			return;
+	if (!cursor_terminal(r->dict, c))
+		return;
+	wchar_t *buffer = hint_word(r, 0);
+	wmemcpy(buffer, r->word, pos);
+	if (key != L'\0')
+		buffer[pos++] = key;
+	wcscpy(buffer + pos, rest);
+	hint_keep(r, edit, cursor_weight(r->dict, c));
+}
+
+/**
+ * Szuka podpowiedzi jednego rodzaju, schodząc ścieżką słowa.
+ * Każda podpowiedź powstaje dokładnie raz, jak w dictionary_hints().
+ * @param[in,out] r Stan wyszukiwania.
+ * @param[in] edit Rodzaj zmiany.
+ */
+static void hint_pass(struct hint_ranker *r, enum hint_edit edit)
+{
+	const struct dictionary *dict = r->dict;
+	const wchar_t *word = r->word;
+	struct cursor node = cursor_root(dict);
+	if (edit == HINT_SAME)
+	{
+		if (hint_visit(r))
+			hint_offer(r, edit, node, 0, L'\0', word);
+		return;
+	}
+	for (size_t i = 0; r->valid && hint_visit(r); i++)
+	{
+		if (edit == HINT_DELETION)
+		{
+			if (i < r->len && word[i] != word[i + 1])
+				hint_offer(r, edit, node, i, L'\0', word + i + 1);
+		}
+		else if (edit == HINT_INSERTION || i < r->len)
+		{
+			uint32_t index = 0;
+			wchar_t key;
+			struct cursor child;
+			while (r->valid
+				   && cursor_next_child(dict, node, &index, &key, &child))
+			{
+				if (i < r->len && key == word[i])
+					continue;
+				if (!hint_visit(r))
+					return;
+				hint_offer(r, edit, child, i, key,
+						   edit == HINT_SUBSTITUTION ? word + i + 1
+													 : word + i);
+			}
+		}
+		if (i == r->len || !cursor_child(dict, &node, word[i]))
+			break;
+	}
+}
+
+/**
+ * Zwraca wagę słowa, które jest w słowniku.
+ * @param[in] dict Słownik.
+ * @param[in] word Słowo.
+ * @return Waga słowa.
+ */
+static uint32_t word_weight(const struct dictionary *dict,
+							const wchar_t *word)
+{
+	struct cursor c = cursor_root(dict);
+	if (cursor_max_weight(dict, c) == 0)
+		return 0;
+	for (; *word; word++)
+		if (!cursor_child(dict, &c, *word))
+			return 0;
+	return cursor_weight(dict, c);
+}
+
+/**
+ * Dolicza wartość do histogramu; za duże wartości trafiają do ostatniego
+ * przedziału.
+ * @param[in,out] histogram Histogram z DICTIONARY_HISTOGRAM przedziałami.
+ * @param[in] value Wartość.
+ */
+static void histogram_add(size_t *histogram, size_t value)
+{
+	histogram[value < DICTIONARY_HISTOGRAM ? value : DICTIONARY_HISTOGRAM - 1]++;
+}
+
+/**
+ * Zlicza słowo według długości; funkcja dla for_each_word().
+ * @param[in,out] data Zajętość pamięci (struct dictionary_memory).
+ * @param[in] word Słowo.
+ * @return true.
+ */
+static bool count_word(void *data, const wchar_t *word)
+{
+	struct dictionary_memory *usage = data;
+	usage->words++;
+	histogram_add(usage->depth, wcslen(word));
+	return true;
+}
+
+/**
+ * Liczy węzły drzewa i pamięć, którą zajmują w arenie.
+ * @param[in] dict Słownik w postaci drzewa.
+ * @param[in,out] usage Zajętość pamięci.
+ * @param[out] blocks Pamięć bloków areny zajętych przez węzły.
+ * @return <0 jeśli zabrakło pamięci, 0 w p.p.
+ */
+static int measure_tree(const struct dictionary *dict,
+						struct dictionary_memory *usage, size_t *blocks)
+{
+	struct stack stack = { NULL, 0, 0 };
+	bool valid = stack_push(&stack, node_cursor(dict->root), 0);
+	*blocks = 0;
+	while (valid && stack.size > 0)
+	{
+		const struct node *node = stack.frames[--stack.size].cursor.node;
+		size_t size = node_size(node);
+		usage->nodes++;
+		usage->node_bytes += sizeof(struct node) + node->prefix_len;
+		usage->child_bytes += node_sizes[node->kind] - sizeof(struct node);
+		usage->overhead_bytes += arena_block_size(size) - size;
+		*blocks += arena_block_size(size);
+		usage->single_child += node->count == 1;
+		usage->prefix_letters += node->prefix_len;
+		histogram_add(usage->fanout, node->count);
+		uint32_t index = 0;
+		uint8_t key;
+		const struct node *child;
+		while (valid && (child = next_child(node, &index, &key)))
+			valid = stack_push(&stack, node_cursor(child), 0);
+	}
+	free(stack.frames);
+	return valid ? 0 : -1;
+}
+
+/**
+ * Zwalnia odłączone bloki, których nie może już czytać żaden czytelnik.
+ * @param[in,out] dict Współdzielony słownik.
+ */
+static void reclaim(struct dictionary *dict)
+{
+	struct shared_state *shared = dict->shared;
+	uint64_t oldest = EPOCH_IDLE;
+	pthread_mutex_lock(&shared->lock);
+	for (struct dictionary_reader *reader = shared->readers; reader;
+		 reader = reader->next)
+	{
+		uint64_t epoch = __atomic_load_n(&reader->epoch, __ATOMIC_SEQ_CST);
+		if (epoch < oldest)
+			oldest = epoch;
+	}
+	pthread_mutex_unlock(&shared->lock);
+	size_t n = 0;
+	for (; n < shared->retired_size && shared->retired[n].epoch < oldest; n++)
+	{
+		struct retired *entry = &shared->retired[n];
+		if (entry->size)
+			arena_free(&dict->arena, entry->block, entry->size);
+		else
+			free(entry->block);
+	}
+	if (n > 0)
+	{
+		shared->retired_size -= n;
+		memmove(shared->retired, shared->retired + n,
+				shared->retired_size * sizeof(struct retired));
+	}
+}
+
+/**
+ * Publikuje czytelnikom stan drzewa pisarza i rozpoczyna nową epokę.
+ * Dla słownika, który nie jest współdzielony, nic nie robi.
+ * @param[in,out] dict Słownik.
+ */
+static void publish(struct dictionary *dict)
+{
+	struct shared_state *shared = dict->shared;
+	if (shared == NULL)
+		return;
+	struct version *version = arena_alloc(&dict->arena, sizeof(struct version));
+	assert(version != NULL);
+	version->root = dict->root;
+	version->symbols = dict->symbols;
+	retire(dict, shared->version, sizeof(struct version));
+	__atomic_store_n(&shared->version, version, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&shared->epoch, shared->epoch + 1, __ATOMIC_SEQ_CST);
+	shared->fresh_size = 0;
+	shared->tree_private = false;
+	shared->symbols_private = false;
+	reclaim(dict);
+}
+
+/**
+ * Zaczyna współdzielenie słownika z czytelnikami. Słownik w postaci
+ * grafu zamieniany jest od razu na drzewo.
+ * @param[in,out] dict Słownik.
+ * @return <0 jeśli operacja się nie powiedzie, 0 w p.p.
+ */
+static int share(struct dictionary *dict)
+{
+	if (!thaw(dict))
+		return -1;
+	struct shared_state *shared = calloc(1, sizeof(struct shared_state));
+	struct version *version = arena_alloc(&dict->arena, sizeof(struct version));
+	if (shared == NULL || version == NULL)
+	{
+		free(shared);
+		return -1;
+	}
+	version->root = dict->root;
+	version->symbols = dict->symbols;
+	shared->version = version;
+	pthread_mutex_init(&shared->lock, NULL);
+	dict->shared = shared;
+	return 0;
+}
+
+/**
+ * Zwraca słownik, który mogą czytać funkcje pomocnicze. Dla
+ * współdzielonego słownika jest to widok opublikowanej wersji, więc
+ * całe wyszukiwanie korzysta z jednej, zgodnej wersji.
+ * @param[in] dict Słownik lub NULL.
+ * @param[out] view Miejsce na widok.
+ * @return `dict` albo `view`.
+ */
+static const struct dictionary * pin(const struct dictionary *dict,
+									 struct dictionary *view)
+{
+	if (dict == NULL || dict->shared == NULL)
+		return dict;
+	const struct version *version =
+		__atomic_load_n(&dict->shared->version, __ATOMIC_SEQ_CST);
+	view->root = version->root;
+	view->symbols = version->symbols;
+	view->graph = NULL;
+	view->index = NULL;
+	view->generation = __atomic_load_n(&dict->generation, __ATOMIC_RELAXED);
+	view->shared = NULL;
+	return view;
+}
+
+/**
+ * Funkcja pomocnicza dictionary_insert i dictionary_insert_weighted.
+ * @param[in,out] dict Słownik.
+ * @param[in] word Wstawiane słowo.
+ * @param[in] weight Nowa waga słowa lub NULL, jeśli waga istniejącego
+ * słowa ma zostać, a nowe słowo ma mieć wagę 0.
+ * @return 0 jeśli słowo było już w słowniku lub zawiera literę spoza
+ * pełnego już alfabetu słownika, 1 jeśli udało się wstawić.
+ */
+static int insert(struct dictionary *dict, const wchar_t *word,
+				  const uint32_t *weight)
+{
+	assert(dict != NULL);
+	if (!thaw(dict))
+		return -1;
+	/* We współdzielonym słowniku nie kopiujemy drogi niepotrzebnie. */
+	if (dict->shared && weight == NULL && find_helper(dict, word))
+		return 0;
+	int result = insert_word(dict, word);
+	bool changed = result == 1;
+	if (result >= 0 && weight && set_weight(dict, word, *weight) != *weight)
+		changed = true;
+	publish(dict);
+	if (result < 0)
+		return result;
+	if (changed)
+		__atomic_store_n(&dict->generation, dict->generation + 1,
+						 __ATOMIC_RELEASE);
+	/* Bez pamięci na indeks rezygnujemy z niego, żeby nie był niespójny
+	   ze słownikiem. */
+	if (result == 1 && dict->index && !hint_index_add(dict->index, word))
+	{
+		hint_index_done(dict->index);
+		dict->index = NULL;
+	}
+	return result;
+}
+
+/**@}*/
+/** @name Elementy interfejsu
+  @{
+ */
+
+#ifdef DICTIONARY_STATS
+__thread struct dictionary_stats dictionary_thread_stats;
+#endif
+
+struct dictionary * dictionary_new()
+{
+	struct dictionary *dict = dictionary_alloc();
+	dict->root = create_node(dict, NODE_0, 0);
 	return dict;
 }
 
 
 void dictionary_done(struct dictionary *dict)
 {
-	dictionary_free(dict);
+	struct shared_state *shared = dict->shared;
+	if (shared)
+	{
+		/* Bloki z areny zwalnia arena_done(). */
+		for (size_t i = 0; i < shared->retired_size; i++)
+			if (shared->retired[i].size == 0)
+				free(shared->retired[i].block);
+		pthread_mutex_destroy(&shared->lock);
+		free(shared->retired);
+		free(shared->fresh);
+		free(shared);
+	}
+	graph_done(dict->graph);
+	hint_index_done(dict->index);
+	arena_done(&dict->arena);
+	free(dict->symbols);
+	free(dict->summary->lengths);
+	free(dict->summary);
+	free(dict);
 }
 
 
 int dictionary_insert(struct dictionary *dict, const wchar_t *word)
 {
-	assert(dict != NULL);
-	struct dictionary *node = NULL;
+	return insert(dict, word, NULL);
+}
 
-	/* Pierwsze slowo */
-	if (dict->children_size == 0)
-	{
-		for(node = dict; *word; node = *node->children)
-		{
-			put_child(node, create_node(*word));
-			word++;
-		}
-		put_child(node, create_node(NULL_MARKER));
-		return 1;
-	}
-	node = dict;
-	struct dictionary *found = NULL;
-	while (find_child(node, &found, *word) && *word)
-	{
-		node = found;
-		word++;
-	}
-	if (*word == L'\0')
-	{
-		if (find_child(node, &found, NULL_MARKER))
-			return 0;
-		put_child(node, create_node(NULL_MARKER));
-	}
-	else
-	{
-		struct dictionary *tmp = create_node(*word);
-		put_child(node, tmp);
-		dictionary_insert(tmp, ++word);
-	}
-	return 1;
+
+int dictionary_insert_weighted(struct dictionary *dict, const wchar_t *word,
+							   uint32_t weight)
+{
+	if (weight > DICTIONARY_WEIGHT_MAX)
+		weight = DICTIONARY_WEIGHT_MAX;
+	return insert(dict, word, &weight);
 }
 
 
 bool dictionary_find(const struct dictionary *dict, const wchar_t *word)
 {
+	struct dictionary view;
+	dict = pin(dict, &view);
 	if (dict == NULL)
 		return false;
-	struct dictionary *found = NULL;
-	if (*word == L'\0')
+	if (dict->graph)
+		return graph_find(dict->graph, word);
+	return find_helper(dict, word);
+}
+
+
+void dictionary_find_batch(const struct dictionary *dict,
+						   const wchar_t **words, size_t n, bool *found)
+{
+	struct dictionary view;
+	dict = pin(dict, &view);
+	if (dict == NULL)
+	{
+		memset(found, 0, n * sizeof(bool));
+		return;
+	}
+	if (dict->graph)
 	{
-		return find_child(dict, &found, NULL_MARKER);
+		/* Zwarty graf mieści się w pamięci podręcznej lepiej niż drzewo,
+		   a przeplatanie wyszukiwań okazało się w nim wolniejsze. */
+		for (size_t i = 0; i < n; i++)
+			found[i] = graph_find(dict->graph, words[i]);
+		return;
 	}
-	else
+	struct find_lane lanes[FIND_LANES];
+	size_t active = 0;
+	size_t next = 0;
+	/* Zakończone wyszukiwanie od razu zastępowane jest następnym słowem,
+	   więc w każdej rundzie prowadzonych jest FIND_LANES wyszukiwań. */
+	while (next < n || active > 0)
 	{
-		find_child(dict, &found, *word);
-		word++;
-		return dictionary_find(found, word);
+		for (; active < FIND_LANES && next < n; active++, next++)
+		{
+			lanes[active].word = words[next];
+			lanes[active].node = dict->root;
+			lanes[active].slot = next;
+		}
+		for (size_t i = 0; i < active; )
+		{
+			if (find_step(dict, &lanes[i], found))
+				lanes[i] = lanes[--active];
+			else
+				i++;
+		}
 	}
 }
 
@@ -512,33 +3009,164 @@ int dictionary_delete(struct dictionary *dict, const wchar_t *word)
 		return 0;
 	if (dictionary_find(dict, word))
 	{
-		struct dictionary *found = NULL;
-		find_child(dict, &found, *word);
-		delete_helper(found, NULL, word);
+		if (!thaw(dict))
+			return 0;
+		uint32_t weight = 0;
+		delete_helper(dict, word, &weight);
+		if (weight > 0)
+			lower_weights(dict, word);
+		summary_update(dict, word, false);
+		publish(dict);
+		if (dict->index)
+			hint_index_remove(dict->index, word);
+		__atomic_store_n(&dict->generation, dict->generation + 1,
+						 __ATOMIC_RELEASE);
 		return 1;
 	}
 	return 0;
 }
 
 
+uint64_t dictionary_generation(const struct dictionary *dict)
+{
+	return __atomic_load_n(&dict->generation, __ATOMIC_ACQUIRE);
+}
+
+
+size_t dictionary_size(const struct dictionary *dict)
+{
+	return ready_summary(dict)->words;
+}
+
+
+size_t dictionary_max_length(const struct dictionary *dict)
+{
+	return ready_summary(dict)->max_length;
+}
+
+
+uint64_t dictionary_letter_count(const struct dictionary *dict,
+								 wchar_t letter)
+{
+	const struct summary *summary = ready_summary(dict);
+	uint8_t code;
+	if (!symbol_table_find(dict->symbols, letter, &code))
+		return 0;
+	return summary->letters[code];
+}
+
+
+size_t dictionary_alphabet(const struct dictionary *dict, wchar_t *letters)
+{
+	const struct summary *summary = ready_summary(dict);
+	size_t size = 0;
+	for (unsigned code = 1; code < dict->symbols->size; code++)
+		if (summary->letters[code] > 0)
+			letters[size++] = symbol_table_letter(dict->symbols, code);
+	letters[size] = L'\0';
+	return size;
+}
+
+
 int dictionary_save(const struct dictionary *dict, FILE* stream)
 {
-	int valid = 0;
-	wchar_t key[2];
-	key[0] = dict->key;
-	key[1] = L'\0';
-	if (fprintf(stream, "%ls%d", key, dict->children_size) < 0)
-		return -1;
-	for (int i = 0; i < dict->children_size; i++)
-		valid += dictionary_save(*(dict->children + i), stream);
-	return valid;
+	return serialize(dict, stream);
 }
 
 
 struct dictionary * dictionary_load(FILE* stream)
 {
-	struct dictionary *dict = NULL;
-	if (deserialize(&dict, stream))
+	struct dictionary *dict = dictionary_alloc();
+	int c = getc(stream);
+	if (c != EOF)
+		ungetc(c, stream);
+	if (c == (unsigned char) GRAPH_MAGIC[0])
+	{
+		dict->graph = graph_read(stream);
+		dict->summary->ready = false;
+		if (dict->graph == NULL || !summarize(dict))
+		{
+			dictionary_done(dict);
+			dict = NULL;
+		}
+		return dict;
+	}
+	dict->root = create_node(dict, NODE_0, 0);
+	if (deserialize(dict, stream))
+	{
+		dictionary_done(dict);
+		dict = NULL;
+	}
+	return dict;
+}
+
+
+int dictionary_save_binary(const struct dictionary *dict, FILE* stream)
+{
+	if (dict->graph)
+		return graph_write(dict->graph, stream);
+	struct graph *graph = flatten(dict);
+	if (graph == NULL)
+		return -1;
+	int result = graph_write(graph, stream);
+	graph_done(graph);
+	return result;
+}
+
+
+int dictionary_freeze(struct dictionary *dict)
+{
+	if (dict->shared)
+		return -1;
+	struct graph *flat = dict->graph ? NULL : flatten(dict);
+	const struct graph *source = dict->graph ? dict->graph : flat;
+	if (source == NULL)
+		return -1;
+	struct graph *dawg = graph_minimize(source);
+	graph_done(flat);
+	if (dawg == NULL)
+		return -1;
+	graph_done(dict->graph);
+	arena_done(&dict->arena);
+	dict->root = NULL;
+	dict->graph = dawg;
+	return 0;
+}
+
+
+struct dictionary * dictionary_build_sorted(const wchar_t **words, size_t n)
+{
+	struct dictionary *dict = dictionary_new();
+	bool valid = true;
+	for (size_t i = 0; valid && i < n; i++)
+		valid = build_next(dict, i ? words[i - 1] : NULL, words[i]) >= 0;
+	if (!valid)
+	{
+		dictionary_done(dict);
+		dict = NULL;
+	}
+	return dict;
+}
+
+
+struct dictionary * dictionary_build_sorted_file(FILE* stream)
+{
+	struct dictionary *dict = dictionary_new();
+	struct text_reader reader;
+	wchar_t *words[2] = { NULL, NULL };
+	size_t capacity[2] = { 0, 0 };
+	bool valid = text_reader_init(&reader, stream);
+	int read;
+	for (int i = 0; valid
+		 && (read = text_read_word(&reader, &words[i % 2], &capacity[i % 2]));
+		 i++)
+		valid = read > 0 && build_next(dict,
+			i ? words[(i + 1) % 2] : NULL, words[i % 2]) >= 0;
+	if (!text_reader_done(&reader))
+		valid = false;
+	free(words[0]);
+	free(words[1]);
+	if (!valid)
 	{
 		dictionary_done(dict);
 		dict = NULL;
@@ -547,18 +3175,428 @@ struct dictionary * dictionary_load(FILE* stream)
 }
 
 
+struct dictionary * dictionary_load_mmap(const char *path)
+{
+	struct graph *graph = graph_map(path);
+	if (graph == NULL)
+		return NULL;
+	struct dictionary *dict = dictionary_alloc();
+	dict->graph = graph;
+	/* Podsumowanie wymaga przejrzenia całego grafu, więc jest wyliczane
+	   dopiero, gdy będzie potrzebne. Litery krawędzi trafiają natomiast
+	   do tablicy symboli od razu, bo sort_hints() ich potrzebuje, a nie
+	   może zmieniać słownika. */
+	dict->summary->ready = false;
+	for (uint32_t i = 0; i < graph->header->edge_count; i++)
+	{
+		uint8_t code;
+		if (!symbol_code(dict, graph->edges[i].key, &code))
+		{
+			dictionary_done(dict);
+			return NULL;
+		}
+	}
+	return dict;
+}
+
+
 void dictionary_hints(const struct dictionary *dict, const wchar_t* word,
         struct word_list *list)
 {
 	word_list_init(list);
-	int *n;
-	wchar_t **hints;
-	possible_hints(dict, word, &n, &hints);
-	for (int i = 0; i < *n; i++)
-		if (dictionary_find(dict, hints[i]) && !word_list_find(list, hints[i]))
-			word_list_add(list, hints[i]);
-	for (int i = 0; i < *n; i++)
-		free(hints[i]);
+	dictionary_hints_into(dict, word, list);
+}
+
+
+void dictionary_hints_into(const struct dictionary *dict, const wchar_t *word,
+						   struct word_list *list)
+{
+	struct dictionary view;
+	dict = pin(dict, &view);
+	STATS_ADD(hint_calls, 1);
+	STATS_START(search);
+	word_list_clear(list);
+	if (dict->index)
+	{
+		hint_index_lookup(dict->index, word, list);
+		STATS_TIME(hint_search_ns, search);
+		STATS_START(sort);
+		sort_hints(dict, list);
+		STATS_TIME(hint_sort_ns, sort);
+		STATS_ADD(hints_accepted, word_list_size(list));
+		return;
+	}
+	size_t len = wcslen(word);
+	wchar_t local[HINT_BUFFER_SIZE];
+	wchar_t *buffer = local;
+	if (len + 2 > HINT_BUFFER_SIZE)
+	{
+		buffer = malloc((len + 2) * sizeof(wchar_t));
+		assert(buffer != NULL);
+		STATS_ADD(allocations, 1);
+		STATS_ADD(allocated_bytes, (len + 2) * sizeof(wchar_t));
+	}
+	/* Schodzimy ścieżką słowa; w węźle 'node' na głębokości 'i' zużywamy
+	   jedyną dozwoloną zmianę, a resztę słowa dopasowujemy dokładnie.
+	   Każda podpowiedź powstaje dokładnie raz: usunięcie jednej z dwóch
+	   równych sąsiednich liter i wstawienie litery równej następnej
+	   generowane są tylko na ostatniej z możliwych pozycji. */
+	struct cursor node = cursor_root(dict);
+	for (size_t i = 0; ; i++)
+	{
+		uint32_t index = 0;
+		wchar_t key;
+		struct cursor child;
+		while (cursor_next_child(dict, node, &index, &key, &child))
+		{
+			STATS_ADD(hint_candidates, (i == len || key != word[i])
+					  + (i < len && key != word[i]));
+			if ((i == len || key != word[i])
+				&& cursor_find(dict, child, word + i))
+				add_hint(list, buffer, word, i, key, word + i);
+			if (i < len && key != word[i]
+				&& cursor_find(dict, child, word + i + 1))
+				add_hint(list, buffer, word, i, key, word + i + 1);
+		}
+		if (i == len)
+		{
+			STATS_ADD(hint_candidates, 1);
+			if (cursor_terminal(dict, node))
+				add_hint(list, buffer, word, len, L'\0', L"");
+			break;
+		}
+		STATS_ADD(hint_candidates, word[i] != word[i + 1]);
+		if (word[i] != word[i + 1] && cursor_find(dict, node, word + i + 1))
+			add_hint(list, buffer, word, i, L'\0', word + i + 1);
+		if (!cursor_child(dict, &node, word[i]))
+			break;
+	}
+	if (buffer != local)
+		free(buffer);
+	STATS_TIME(hint_search_ns, search);
+	STATS_START(sort);
+	sort_hints(dict, list);
+	STATS_TIME(hint_sort_ns, sort);
+	STATS_ADD(hints_accepted, word_list_size(list));
+}
+
+
+void dictionary_hints_k(const struct dictionary *dict, const wchar_t* word,
+						unsigned k, struct word_list *list)
+{
+	struct dictionary view;
+	dict = pin(dict, &view);
+	STATS_ADD(hint_calls, 1);
+	STATS_START(search);
+	word_list_init(list);
+	if (k > UINT8_MAX - 1)
+		k = UINT8_MAX - 1;
+	struct levenshtein lev = { word, wcslen(word) + 1, k, NULL, NULL, 0 };
+	struct stack stack = { NULL, 0, 0 };
+	struct cursor root = cursor_root(dict);
+	bool valid = levenshtein_reserve(&lev, 0) && stack_push(&stack, root, 0);
+	for (size_t j = 0; valid && j < lev.width; j++)
+		lev.rows[j] = j <= k ? j : k + 1;
+	if (valid)
+		levenshtein_emit(dict, &lev, root, 0, list);
+	/* Przeszukiwanie w głąb: wiersz dziecka liczony jest raz, z wiersza
+	   ojca, a poddrzewa, w których każda wartość przekracza k, są
+	   odcinane. */
+	while (valid && stack.size > 0)
+	{
+		struct frame *top = stack_top(&stack);
+		size_t depth = stack.size;
+		wchar_t key;
+		struct cursor child;
+		if (!cursor_next_child(dict, top->cursor, &top->index, &key, &child))
+		{
+			stack.size--;
+			continue;
+		}
+		if (!(valid = levenshtein_reserve(&lev, depth)))
+			break;
+		lev.path[depth - 1] = key;
+		STATS_ADD(hint_candidates, 1);
+		if (levenshtein_row(&lev, depth) > k)
+			continue;
+		levenshtein_emit(dict, &lev, child, depth, list);
+		valid = stack_push(&stack, child, 0);
+	}
+	free(stack.frames);
+	free(lev.rows);
+	free(lev.path);
+	STATS_TIME(hint_search_ns, search);
+	STATS_START(sort);
+	sort_hints(dict, list);
+	STATS_TIME(hint_sort_ns, sort);
+	STATS_ADD(hints_accepted, word_list_size(list));
+}
+
+
+int dictionary_hints_ex(const struct dictionary *dict, const wchar_t *word,
+						const struct dictionary_hint_options *opts,
+						struct word_list *list)
+{
+	struct dictionary view;
+	dict = pin(dict, &view);
+	STATS_ADD(hint_calls, 1);
+	STATS_START(search);
+	word_list_init(list);
+	struct hint_ranker r = {
+		dict, word, wcslen(word), SIZE_MAX, NULL, 0, 0, NULL,
+		0, 0, 0, 0, false, true
+	};
+	if (opts != NULL)
+	{
+		if (opts->max_hints > 0)
+			r.limit = opts->max_hints;
+		r.max_nodes = opts->max_nodes;
+		if (opts->max_ns > 0)
+			r.deadline = stats_clock() + opts->max_ns;
+	}
+	r.words = malloc((r.len + 2) * sizeof(wchar_t));
+	r.valid = r.words != NULL;
+	if (r.valid && dict->index)
+	{
+		/* Indeks podaje wszystkie podpowiedzi od razu; rodzaj zmiany
+		   wynika z długości podpowiedzi. */
+		hint_index_lookup(dict->index, word, list);
+		const wchar_t * const *a = word_list_get(list);
+		for (size_t i = 0; r.valid && i < word_list_size(list); i++)
+		{
+			size_t len = wcslen(a[i]);
+			enum hint_edit edit = len > r.len ? HINT_INSERTION
+				: len < r.len ? HINT_DELETION
+				: wcscmp(a[i], word) ? HINT_SUBSTITUTION : HINT_SAME;
+			wcscpy(hint_word(&r, 0), a[i]);
+			hint_keep(&r, edit, word_weight(dict, a[i]));
+		}
+		word_list_clear(list);
+	}
+	else
+	{
+		/* Podpowiedzi gorszego rodzaju szukane są dopiero po lepszych,
+		   więc po wyczerpaniu budżetu zostają najlepsze znalezione. */
+		for (int edit = HINT_SAME;
+			 r.valid && !r.exhausted && edit < HINT_EDITS; edit++)
+		{
+			if (r.size == r.limit && r.heap[0].edit < edit)
+				break;
+			hint_pass(&r, edit);
+		}
+	}
+	STATS_TIME(hint_search_ns, search);
+	STATS_START(sort);
+	for (size_t n = r.size; n > 1; n--)
+	{
+		struct ranked_hint worst = r.heap[0];
+		r.heap[0] = r.heap[n - 1];
+		r.heap[n - 1] = worst;
+		hint_sift_down(&r, 0, n - 1);
+	}
+	for (size_t i = 0; r.valid && i < r.size; i++)
+		r.valid = word_list_add(list, hint_word(&r, r.heap[i].slot));
+	STATS_TIME(hint_sort_ns, sort);
+	free(r.heap);
+	free(r.words);
+	if (!r.valid)
+	{
+		word_list_clear(list);
+		return -1;
+	}
+	STATS_ADD(hints_accepted, word_list_size(list));
+	return r.exhausted ? 1 : 0;
+}
+
+
+int dictionary_complete(const struct dictionary *dict, const wchar_t *prefix,
+						size_t k, struct word_list *list)
+{
+	struct dictionary view;
+	dict = pin(dict, &view);
+	word_list_init(list);
+	struct cursor c = cursor_root(dict);
+	for (const wchar_t *letter = prefix; *letter; letter++)
+		if (!cursor_child(dict, &c, *letter))
+			return 0;
+	struct completer comp = { NULL, 0, 0, NULL, 0, 0, NULL, 0 };
+	size_t prefix_len = wcslen(prefix);
+	struct completion top = {
+		cursor_max_weight(dict, c), COMPLETION_ROOT, false, c
+	};
+	/* Najpierw rozpatrywane są poddrzewa z najcięższymi słowami, więc
+	   poddrzewa lżejsze od k-tego słowa nie są w ogóle przeglądane. */
+	bool valid = k == 0 || completer_push(&comp, &top);
+	while (valid && comp.size > 0 && word_list_size(list) < k)
+	{
+		completer_pop(&comp, &top);
+		valid = top.word
+			? completer_emit(&comp, prefix, prefix_len, top.step, list)
+			: completer_expand(dict, &comp, top, prefix, prefix_len, list);
+	}
+	free(comp.heap);
+	free(comp.steps);
+	free(comp.word);
+	return valid ? 0 : -1;
+}
+
+
+int dictionary_index_hints(struct dictionary *dict)
+{
+	struct hint_index *index = hint_index_new();
+	if (index == NULL || for_each_word(dict, index_word, index) < 0)
+	{
+		hint_index_done(index);
+		return -1;
+	}
+	hint_index_done(dict->index);
+	dict->index = index;
+	return 0;
+}
+
+
+int dictionary_save_hint_index(const struct dictionary *dict, FILE* stream)
+{
+	if (dict->index == NULL)
+		return -1;
+	return hint_index_write(dict->index, stream);
+}
+
+
+int dictionary_load_hint_index(struct dictionary *dict, FILE* stream)
+{
+	struct hint_index *index = hint_index_read(stream);
+	if (index == NULL)
+		return -1;
+	struct index_check check = { index, 0 };
+	if (for_each_word(dict, check_word, &check) < 0
+		|| check.count != index->word_count)
+	{
+		hint_index_done(index);
+		return -1;
+	}
+	hint_index_done(dict->index);
+	dict->index = index;
+	return 0;
+}
+
+
+struct dictionary_reader * dictionary_reader_new(struct dictionary *dict)
+{
+	if (dict->shared == NULL && share(dict) < 0)
+		return NULL;
+	struct dictionary_reader *reader;
+	if (posix_memalign((void **) &reader, sizeof(struct dictionary_reader),
+					   sizeof(struct dictionary_reader)))
+		return NULL;
+	reader->epoch = EPOCH_IDLE;
+	reader->dict = dict;
+	struct shared_state *shared = dict->shared;
+	pthread_mutex_lock(&shared->lock);
+	reader->next = shared->readers;
+	shared->readers = reader;
+	pthread_mutex_unlock(&shared->lock);
+	return reader;
+}
+
 
+void dictionary_reader_done(struct dictionary_reader *reader)
+{
+	struct shared_state *shared = reader->dict->shared;
+	pthread_mutex_lock(&shared->lock);
+	struct dictionary_reader **link = &shared->readers;
+	while (*link != reader)
+		link = &(*link)->next;
+	*link = reader->next;
+	pthread_mutex_unlock(&shared->lock);
+	free(reader);
+}
+
+
+void dictionary_read_begin(struct dictionary_reader *reader)
+{
+	/* Pisarz, który nie zobaczy jeszcze ogłoszonej epoki, opublikował
+	   już wersję, którą czytelnik odczyta po ogłoszeniu. */
+	uint64_t epoch = __atomic_load_n(&reader->dict->shared->epoch,
+									 __ATOMIC_SEQ_CST);
+	__atomic_store_n(&reader->epoch, epoch, __ATOMIC_SEQ_CST);
+}
+
+
+void dictionary_read_end(struct dictionary_reader *reader)
+{
+	__atomic_store_n(&reader->epoch, EPOCH_IDLE, __ATOMIC_RELEASE);
+}
+
+
+int dictionary_memory_usage(const struct dictionary *dict,
+							struct dictionary_memory *usage)
+{
+	memset(usage, 0, sizeof(struct dictionary_memory));
+	if (for_each_word(dict, count_word, usage) < 0)
+		return -1;
+	usage->other_bytes = sizeof(struct dictionary) + sizeof(struct symbol_table)
+		+ sizeof(struct summary) + dict->summary->lengths_size * sizeof(size_t);
+	if (dict->graph)
+	{
+		const struct graph *graph = dict->graph;
+		usage->nodes = graph->header->node_count;
+		usage->child_bytes =
+			graph->header->edge_count * sizeof(struct graph_edge);
+		usage->node_bytes = graph->size - usage->child_bytes;
+		for (uint32_t i = 0; i < graph->header->node_count; i++)
+		{
+			uint32_t degree = graph_last_edge(graph, i)
+				- graph_first_edge(graph, i);
+			usage->single_child += degree == 1;
+			histogram_add(usage->fanout, degree);
+		}
+	}
+	size_t blocks = 0;
+	if (dict->root && measure_tree(dict, usage, &blocks) < 0)
+		return -1;
+	/* Oprócz węzłów w arenie są bloki czekające na czytelników
+	   i opublikowana wersja. */
+	size_t waiting = 0;
+	if (dict->shared)
+	{
+		const struct shared_state *shared = dict->shared;
+		waiting += arena_block_size(sizeof(struct version));
+		for (size_t i = 0; i < shared->retired_size; i++)
+			if (shared->retired[i].size)
+				waiting += arena_block_size(shared->retired[i].size);
+			else
+				usage->other_bytes += sizeof(struct symbol_table);
+		usage->other_bytes += sizeof(struct shared_state) + waiting
+			+ shared->retired_capacity * sizeof(struct retired)
+			+ shared->fresh_capacity * sizeof(struct node *);
+	}
+	struct arena_usage arena;
+	arena_usage(&dict->arena, &arena);
+	usage->overhead_bytes += arena.header_bytes + arena.free_bytes;
+	usage->leaked_bytes = arena.slab_bytes - arena.header_bytes
+		- arena.free_bytes - blocks - waiting;
+	usage->total_bytes = usage->node_bytes + usage->child_bytes
+		+ usage->overhead_bytes + usage->leaked_bytes + usage->other_bytes;
+	return 0;
+}
+
+
+void dictionary_stats(struct dictionary_stats *stats)
+{
+#ifdef DICTIONARY_STATS
+	*stats = dictionary_thread_stats;
+#else
+	memset(stats, 0, sizeof(struct dictionary_stats));
+#endif
+}
+
+
+void dictionary_stats_reset(void)
+{
+#ifdef DICTIONARY_STATS
+	memset(&dictionary_thread_stats, 0, sizeof(struct dictionary_stats));
+#endif
 }
+
 /**@}*/
@@ -15,6 +15,7 @@
 
 #include "word_list.h"
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <wchar.h>
 
@@ -41,13 +42,40 @@ void dictionary_done(struct dictionary *dict);
 
 /**
   Wstawia podane słowo do słownika.
+  Słownik może zawierać co najwyżej 255 różnych liter.
   @param[in,out] dict Słownik.
   @param[in] word Słowo, które należy wstawić do słownika.
-  @return 0 jeśli słowo było już w słowniku, 1 jeśli udało się wstawić.
+  @return 0 jeśli słowo było już w słowniku, 1 jeśli udało się wstawić,
+  <0 jeśli słowo zawiera literę spoza pełnego już alfabetu słownika
+  lub zabrakło pamięci.
   */
 int dictionary_insert(struct dictionary *dict, const wchar_t* word);
 
 
+/**
+  Największa waga słowa.
+  */
+#define DICTIONARY_WEIGHT_MAX INT32_MAX
+
+
+/**
+  Wstawia podane słowo do słownika razem z jego wagą, np. częstością
+  występowania w tekstach, albo zmienia wagę słowa, które już jest
+  w słowniku. Słowa wstawione przez dictionary_insert() mają wagę 0.
+  Wagi są zapisywane przez dictionary_save(); słownika ze słowami
+  o dodatniej wadze nie da się zamrozić ani zapisać w postaci binarnej.
+  @param[in,out] dict Słownik.
+  @param[in] word Słowo, które należy wstawić do słownika.
+  @param[in] weight Waga słowa; większe od DICTIONARY_WEIGHT_MAX są
+  zmniejszane do DICTIONARY_WEIGHT_MAX.
+  @return 0 jeśli słowo było już w słowniku, 1 jeśli udało się wstawić,
+  <0 jeśli słowo zawiera literę spoza pełnego już alfabetu słownika
+  lub zabrakło pamięci.
+  */
+int dictionary_insert_weighted(struct dictionary *dict, const wchar_t* word,
+                               uint32_t weight);
+
+
 /**
   Usuwa podane słowo ze słownika, jeśli istnieje.
   @param[in,out] dict Słownik.
@@ -66,6 +94,82 @@ int dictionary_delete(struct dictionary *dict, const wchar_t* word);
 bool dictionary_find(const struct dictionary *dict, const wchar_t* word);
 
 
+/**
+  Sprawdza, czy dane słowa znajdują się w słowniku.
+  Wynik jest taki sam jak wywołanie dictionary_find() dla każdego słowa,
+  ale wyszukiwania wielu słów prowadzone są na przemian, po jednym węźle
+  na raz, a następne węzły pobierane są do pamięci podręcznej z
+  wyprzedzeniem. Oczekiwanie na pamięć przy kolejnych słowach nakłada się
+  wtedy na siebie.
+  @param[in] dict Słownik.
+  @param[in] words Tablica szukanych słów.
+  @param[in] n Liczba słów.
+  @param[out] found Tablica na `n` wyników.
+  */
+void dictionary_find_batch(const struct dictionary *dict,
+                           const wchar_t **words, size_t n, bool *found);
+
+
+/**
+  Zwraca numer generacji słownika, zwiększany przy każdej udanej zmianie
+  przez dictionary_insert(), dictionary_insert_weighted()
+  lub dictionary_delete(). Pozwala wykryć,
+  że wyniki zapamiętane dla słownika (np. w hint_cache) są nieaktualne.
+  @param[in] dict Słownik.
+  @return Numer generacji.
+  */
+uint64_t dictionary_generation(const struct dictionary *dict);
+
+
+/**
+  Rozmiar bufora na alfabet słownika dla dictionary_alphabet(),
+  łącznie z kończącym znakiem L'\0'.
+  */
+#define DICTIONARY_ALPHABET 256
+
+
+/**
+  Zwraca liczbę słów w słowniku.
+  Ta i następne funkcje korzystają z podsumowania uaktualnianego przy
+  każdej zmianie słownika, więc nie przeglądają go. Wyjątkiem jest
+  pierwsze wywołanie dla słownika wczytanego przez dictionary_load_mmap(),
+  które wylicza podsumowanie.
+  Tych funkcji nie można wywoływać równolegle ze zmianami słownika.
+  @param[in] dict Słownik.
+  @return Liczba słów.
+  */
+size_t dictionary_size(const struct dictionary *dict);
+
+
+/**
+  Zwraca długość najdłuższego słowa w słowniku.
+  @param[in] dict Słownik.
+  @return Długość słowa lub 0 dla pustego słownika.
+  */
+size_t dictionary_max_length(const struct dictionary *dict);
+
+
+/**
+  Zwraca liczbę wystąpień litery we wszystkich słowach słownika.
+  @param[in] dict Słownik.
+  @param[in] letter Litera.
+  @return Liczba wystąpień.
+  */
+uint64_t dictionary_letter_count(const struct dictionary *dict,
+                                 wchar_t letter);
+
+
+/**
+  Wypisuje alfabet słownika, czyli litery występujące w jego słowach,
+  w rosnącym porządku kodów znaków.
+  @param[in] dict Słownik.
+  @param[out] letters Bufor na DICTIONARY_ALPHABET znaków; alfabet jest
+  zakończony znakiem L'\0'.
+  @return Liczba liter alfabetu.
+  */
+size_t dictionary_alphabet(const struct dictionary *dict, wchar_t *letters);
+
+
 /**
   Zapisuje słownik.
   @param[in] dict Słownik.
@@ -84,13 +188,356 @@ int dictionary_save(const struct dictionary *dict, FILE* stream);
 struct dictionary * dictionary_load(FILE* stream);
 
 
+/**
+  Zamraża słownik, zamieniając go na minimalny acykliczny automat słów
+  (DAWG), w którym wspólne końcówki słów przechowywane są tylko raz.
+  Zamrożony słownik obsługuje wyszukiwanie, podpowiedzi i zapis w obu
+  postaciach; dictionary_save_binary() zapisuje go w postaci
+  zminimalizowanej. Pierwsza modyfikacja słownika odtwarza z niego
+  zwykłe drzewo.
+  @param[in,out] dict Słownik.
+  @return <0 jeśli operacja się nie powiedzie lub słownik ma słowa
+  o dodatniej wadze, 0 w p.p.
+  */
+int dictionary_freeze(struct dictionary *dict);
+
+
+/**
+  Tworzy słownik z posortowanej listy słów.
+  Słowa muszą być posortowane rosnąco według wcscmp(); powtórzenia są
+  pomijane. Budowa działa w czasie liniowym od sumy długości słów,
+  a powstały słownik jest taki sam jak po wstawieniu słów
+  przez dictionary_insert().
+  Słownik ten należy zniszczyć za pomocą dictionary_done().
+  @param[in] words Tablica słów.
+  @param[in] n Liczba słów.
+  @return Nowy słownik lub NULL, jeśli słowa nie są posortowane.
+  */
+struct dictionary * dictionary_build_sorted(const wchar_t **words, size_t n);
+
+
+/**
+  Tworzy słownik z posortowanej listy słów czytanej ze strumienia.
+  Słowa zapisane są w UTF-8 i oddzielone białymi znakami
+  (np. po jednym w wierszu); wymagania co do kolejności jak
+  w dictionary_build_sorted().
+  Słownik ten należy zniszczyć za pomocą dictionary_done().
+  @param[in,out] stream Strumień, skąd mają być wczytane słowa.
+  @return Nowy słownik lub NULL, jeśli operacja się nie powiedzie.
+  */
+struct dictionary * dictionary_build_sorted_file(FILE* stream);
+
+
+/**
+  Zapisuje słownik w postaci binarnej.
+  Plik w tej postaci można wczytać za pomocą dictionary_load_mmap()
+  lub dictionary_load().
+  @param[in] dict Słownik.
+  @param[in,out] stream Strumień, gdzie ma być zapisany słownik.
+  @return <0 jeśli operacja się nie powiedzie lub słownik ma słowa
+  o dodatniej wadze, 0 w p.p.
+  */
+int dictionary_save_binary(const struct dictionary *dict, FILE* stream);
+
+
+/**
+  Mapuje do pamięci słownik zapisany przez dictionary_save_binary().
+  Plik nie jest parsowany: słownik jest gotowy do wyszukiwania od razu,
+  a jego strony są współdzielone między procesami przez pamięć podręczną
+  systemu. Pierwsza modyfikacja słownika tworzy jego prywatną kopię.
+  Słownik ten należy zniszczyć za pomocą dictionary_done().
+  @param[in] path Ścieżka do pliku.
+  @return Nowy słownik lub NULL, jeśli plik nie zawiera słownika binarnego.
+  */
+struct dictionary * dictionary_load_mmap(const char *path);
+
+
 /**
   Sprawdza, czy dane słowo znajduje się w słowniku.
   @param[in] dict Słownik.
   @param[in] word Szukane słowo.
   @param[in,out] list Lista, w której zostaną umieszczone podpowiedzi.
+  Lista jest inicjowana przez funkcję; należy ją zniszczyć za pomocą
+  word_list_done().
   */
 void dictionary_hints(const struct dictionary *dict, const wchar_t* word,
                       struct word_list *list);
 
+
+/**
+  Wyszukuje podpowiedzi jak dictionary_hints(), ale w liście już
+  zainicjowanej. Jej dotychczasowa zawartość jest usuwana przez
+  word_list_clear(), więc jedną listę można używać w wielu wywołaniach
+  bez ponownego przydzielania pamięci.
+  @param[in] dict Słownik.
+  @param[in] word Szukane słowo.
+  @param[in,out] list Lista zainicjowana przez word_list_init(), w której
+  zostaną umieszczone podpowiedzi.
+  */
+void dictionary_hints_into(const struct dictionary *dict, const wchar_t *word,
+                           struct word_list *list);
+
+
+/**
+  Wyszukuje w słowniku słowa odległe od danego o co najwyżej `k` zmian.
+  Zmianą jest wstawienie, usunięcie lub zamiana litery oraz zamiana
+  miejscami dwóch sąsiednich liter (odległość Damerau-Levenshteina).
+  Słownik przeszukiwany jest w głąb z wierszem tablicy odległości
+  w każdym węźle, więc czas zależy od liczby odwiedzonych węzłów,
+  a nie od liczby możliwych słów-kandydatów.
+  Podpowiedzi są posortowane jak w dictionary_hints().
+  @param[in] dict Słownik.
+  @param[in] word Szukane słowo.
+  @param[in] k Maksymalna liczba zmian.
+  @param[in,out] list Lista, w której zostaną umieszczone podpowiedzi,
+  jak w dictionary_hints().
+  */
+void dictionary_hints_k(const struct dictionary *dict, const wchar_t* word,
+                        unsigned k, struct word_list *list);
+
+
+/**
+  Ograniczenia dictionary_hints_ex(). Pole równe 0 nie ogranicza
+  wyszukiwania.
+  */
+struct dictionary_hint_options
+{
+    /// Największa liczba podpowiedzi.
+    size_t max_hints;
+    /// Największa liczba węzłów słownika odwiedzonych przy wyszukiwaniu.
+    uint64_t max_nodes;
+    /// Największy czas wyszukiwania w nanosekundach.
+    uint64_t max_ns;
+};
+
+
+/**
+  Wyszukuje podpowiedzi jak dictionary_hints(), ale uporządkowane od
+  najbardziej prawdopodobnych: najpierw samo słowo, potem słowa
+  z zamienioną literą, z literą pominiętą w słowie i bez litery
+  nadmiarowej, a w obrębie rodzaju zmiany malejąco według wag
+  (dictionary_insert_weighted()) i alfabetycznie.
+  Zwracanych jest `max_hints` pierwszych podpowiedzi z tego porządku.
+  Pamiętane są tylko one, a poddrzewa, w których nie ma słowa cięższego
+  od najgorszej z nich, są pomijane.
+  Po odwiedzeniu `max_nodes` węzłów lub po `max_ns` nanosekundach
+  wyszukiwanie jest przerywane. Podpowiedzi gorszego rodzaju szukane są
+  po lepszych, więc lista zawiera wtedy najlepsze ze znalezionych.
+  Wyszukiwanie z indeksem (dictionary_index_hints()) nie jest
+  przerywane, bo jego czas i tak zależy tylko od długości słowa.
+  @param[in] dict Słownik.
+  @param[in] word Szukane słowo.
+  @param[in] opts Ograniczenia lub NULL, jeśli ich brak.
+  @param[in,out] list Lista, w której zostaną umieszczone podpowiedzi,
+  jak w dictionary_hints().
+  @return <0 jeśli zabrakło pamięci (lista jest wtedy pusta), 1 jeśli
+  wyszukiwanie przerwano i lista może być niepełna, 0 w p.p.
+  */
+int dictionary_hints_ex(const struct dictionary *dict, const wchar_t *word,
+                        const struct dictionary_hint_options *opts,
+                        struct word_list *list);
+
+
+/**
+  Wyszukuje `k` słów słownika o największych wagach, zaczynających się
+  od podanego prefiksu (w tym sam prefiks, jeśli jest słowem).
+  Słowa są uporządkowane malejąco według wag, a słowa o równych wagach
+  (np. wszystkie słowa słownika bez wag) w porządku wcscmp(); z równie
+  ciężkich słów na granicy `k` zwracane są więc pierwsze w tym porządku.
+  Każdy węzeł pamięta największą wagę słowa w swoim poddrzewie, więc
+  przeszukiwane są tylko poddrzewa, w których może być któreś z `k` słów,
+  a czas zależy od `k` i długości słów, a nie od liczby słów
+  zaczynających się od prefiksu.
+  @param[in] dict Słownik.
+  @param[in] prefix Prefiks.
+  @param[in] k Największa liczba słów.
+  @param[in,out] list Lista, w której zostaną umieszczone słowa,
+  jak w dictionary_hints().
+  @return <0 jeśli zabrakło pamięci, 0 w p.p.
+  */
+int dictionary_complete(const struct dictionary *dict, const wchar_t *prefix,
+                        size_t k, struct word_list *list);
+
+
+/**
+  Buduje indeks usunięć, przyspieszający dictionary_hints().
+  Indeks przechowuje dla każdego słowa jego warianty bez jednej litery,
+  więc wyszukanie podpowiedzi to kilka sond w tablicy haszującej.
+  Zajmuje kilka razy więcej pamięci niż sam słownik. Po zbudowaniu jest
+  aktualizowany przez dictionary_insert() i dictionary_delete().
+  @param[in,out] dict Słownik.
+  @return <0 jeśli operacja się nie powiedzie, 0 w p.p.
+  */
+int dictionary_index_hints(struct dictionary *dict);
+
+
+/**
+  Zapisuje indeks podpowiedzi zbudowany przez dictionary_index_hints().
+  Indeks zapisuje się do osobnego pliku, obok słownika.
+  @param[in] dict Słownik.
+  @param[in,out] stream Strumień, gdzie ma być zapisany indeks.
+  @return <0 jeśli słownik nie ma indeksu lub operacja się nie powiedzie,
+  0 w p.p.
+  */
+int dictionary_save_hint_index(const struct dictionary *dict, FILE* stream);
+
+
+/**
+  Wczytuje indeks podpowiedzi zapisany przez dictionary_save_hint_index().
+  Indeks jest przyjmowany tylko wtedy, gdy zawiera dokładnie słowa
+  słownika.
+  @param[in,out] dict Słownik.
+  @param[in,out] stream Strumień, skąd ma być wczytany indeks.
+  @return <0 jeśli operacja się nie powiedzie lub indeks nie pasuje
+  do słownika, 0 w p.p.
+  */
+int dictionary_load_hint_index(struct dictionary *dict, FILE* stream);
+
+
+/**
+  Czytelnik słownika, czyli wątek, który czyta słownik równolegle
+  z jego zmianami.
+  */
+struct dictionary_reader;
+
+
+/**
+  Rejestruje czytelnika słownika.
+  Od zarejestrowania pierwszego czytelnika słownik jest współdzielony:
+  dictionary_insert() i dictionary_delete() nie zmieniają węzłów widocznych
+  dla czytelników, tylko kopiują zmieniane węzły razem z drogą od
+  korzenia i na koniec publikują nową wersję słownika. Czytelnicy nie
+  czekają więc na pisarza ani na siebie nawzajem. Słownik w postaci
+  grafu zamieniany jest przy tym na drzewo, a dictionary_freeze() przestaje
+  działać. Zmiany słownika należy wykonywać kolejno, w jednym wątku naraz;
+  pierwszego czytelnika należy zarejestrować, zanim zaczną się zmiany
+  współbieżne z czytaniem.
+  @param[in,out] dict Słownik.
+  @return Nowy czytelnik lub NULL, jeśli operacja się nie powiedzie.
+  */
+struct dictionary_reader * dictionary_reader_new(struct dictionary *dict);
+
+
+/**
+  Wyrejestrowuje czytelnika. Czytelnik nie może być w trakcie czytania.
+  @param[in] reader Czytelnik.
+  */
+void dictionary_reader_done(struct dictionary_reader *reader);
+
+
+/**
+  Rozpoczyna czytanie słownika przez czytelnika.
+  Do wywołania dictionary_read_end() wątek czytelnika może wywoływać
+  dictionary_find(), dictionary_find_batch(), dictionary_hints(),
+  dictionary_hints_into() i dictionary_hints_k() na słowniku, a każde
+  z tych wywołań widzi jedną, zgodną wersję słownika. Indeks podpowiedzi
+  nie jest przy tym używany.
+  Bloki, które mogą być czytane, są zwalniane dopiero po zakończeniu
+  czytania, więc nie należy czytać dłużej niż trzeba.
+  @param[in,out] reader Czytelnik.
+  */
+void dictionary_read_begin(struct dictionary_reader *reader);
+
+
+/**
+  Kończy czytanie słownika rozpoczęte przez dictionary_read_begin().
+  @param[in,out] reader Czytelnik.
+  */
+void dictionary_read_end(struct dictionary_reader *reader);
+
+
+/**
+  Liczba przedziałów histogramów w struct dictionary_memory.
+  */
+#define DICTIONARY_HISTOGRAM 32
+
+
+/**
+  Zajętość pamięci i kształt słownika.
+  Pamięć areny dzieli się na węzły, tablice dzieci, narzut i wycieki;
+  wycieki to pamięć areny, która nie jest ani węzłem drzewa, ani wolnym
+  blokiem, ani blokiem czekającym na czytelników, więc powinny być zerem.
+  */
+struct dictionary_memory
+{
+    /// Liczba słów.
+    size_t words;
+    /// Liczba węzłów drzewa albo grafu.
+    size_t nodes;
+    /// Pamięć nagłówków węzłów i skompresowanych ścieżek.
+    size_t node_bytes;
+    /// Pamięć tablic kluczy, indeksów i dzieci węzłów albo krawędzi grafu.
+    size_t child_bytes;
+    /// Zaokrąglenia bloków areny, nagłówki slabów i wolne bloki.
+    size_t overhead_bytes;
+    /// Pamięć areny, której nie zajmuje nic z powyższych.
+    size_t leaked_bytes;
+    /// Pozostała pamięć: struktura słownika, tablica symboli, bloki
+    /// czekające na czytelników (bez indeksu podpowiedzi).
+    size_t other_bytes;
+    /// Suma wszystkich powyższych rodzajów pamięci.
+    size_t total_bytes;
+    /// Liczby węzłów o `i` dzieciach; ostatni przedział zlicza też więcej.
+    size_t fanout[DICTIONARY_HISTOGRAM];
+    /// Liczby słów o `i` literach; ostatni przedział zlicza też dłuższe.
+    size_t depth[DICTIONARY_HISTOGRAM];
+    /// Liczba węzłów z dokładnie jednym dzieckiem.
+    size_t single_child;
+    /// Liczba liter w skompresowanych ścieżkach węzłów.
+    size_t prefix_letters;
+};
+
+
+/**
+  Liczy zajętość pamięci i kształt słownika, przechodząc cały słownik.
+  Nie może działać równocześnie ze zmianami słownika.
+  @param[in] dict Słownik.
+  @param[out] usage Zajętość pamięci i kształt słownika.
+  @return <0 jeśli zabrakło pamięci, 0 w p.p.
+  */
+int dictionary_memory_usage(const struct dictionary *dict,
+                            struct dictionary_memory *usage);
+
+
+/**
+  Liczniki pracy biblioteki. Zliczane są tylko wtedy, gdy biblioteka
+  została skompilowana z makrem DICTIONARY_STATS (opcja CMake -DSTATS=ON);
+  w p.p. wszystkie są zerami. Każdy wątek ma własne liczniki.
+  */
+struct dictionary_stats
+{
+    /// Liczba odwiedzonych węzłów przy wyszukiwaniu słów i podpowiedzi.
+    uint64_t nodes_visited;
+    /// Liczba wyszukań dziecka węzła po kluczu.
+    uint64_t child_probes;
+    /// Liczba przydziałów pamięci (węzłów, list słów i buforów).
+    uint64_t allocations;
+    /// Łączny rozmiar przydzielonej pamięci w bajtach.
+    uint64_t allocated_bytes;
+    /// Liczba wywołań dictionary_hints(), dictionary_hints_into(),
+    /// dictionary_hints_k() i dictionary_hints_ex().
+    uint64_t hint_calls;
+    /// Liczba sprawdzonych kandydatów na podpowiedzi.
+    uint64_t hint_candidates;
+    /// Liczba zwróconych podpowiedzi.
+    uint64_t hints_accepted;
+    /// Czas wyszukiwania kandydatów na podpowiedzi w nanosekundach.
+    uint64_t hint_search_ns;
+    /// Czas sortowania podpowiedzi w nanosekundach.
+    uint64_t hint_sort_ns;
+};
+
+
+/**
+  Odczytuje liczniki bieżącego wątku.
+  @param[out] stats Liczniki.
+  */
+void dictionary_stats(struct dictionary_stats *stats);
+
+
+/**
+  Zeruje liczniki bieżącego wątku.
+  */
+void dictionary_stats_reset(void);
+
 #endif /* __DICTIONARY_H__ */
@@ -0,0 +1,419 @@
+/** @file
+  Implementacja grafu słownika w postaci płaskiej.
+
+  @ingroup dictionary
+  @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+  @date 2015-06-14
+ */
+
+#include "graph.h"
+#include "stats.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** @name Funkcje pomocnicze
+  @{
+ */
+
+/**
+ * Wylicza rozmiar obszaru pamięci potrzebnego na graf.
+ * @param[in] node_count Liczba węzłów.
+ * @param[in] edge_count Liczba krawędzi.
+ * @return Rozmiar w bajtach.
+ */
+static size_t graph_size(uint32_t node_count, uint32_t edge_count)
+{
+	return sizeof(struct graph_header)
+		+ ((size_t) node_count + 1) * sizeof(uint32_t)
+		+ (size_t) edge_count * sizeof(struct graph_edge);
+}
+
+/**
+ * Ustawia wskaźniki grafu na odpowiednie części obszaru 'data'.
+ * @param[in,out] graph Graf.
+ * @param[in] data Obszar pamięci.
+ * @param[in] size Rozmiar obszaru.
+ */
+static void graph_attach(struct graph *graph, void *data, size_t size)
+{
+	graph->data = data;
+	graph->size = size;
+	graph->header = data;
+	graph->nodes = (uint32_t *) (graph->header + 1);
+	graph->edges = (struct graph_edge *)
+		(graph->nodes + graph->header->node_count + 1);
+}
+
+/**
+ * Sprawdza, czy obszar pamięci zawiera poprawny nagłówek grafu
+ * i czy jego rozmiar zgadza się z nagłówkiem.
+ * @param[in] data Obszar pamięci.
+ * @param[in] size Rozmiar obszaru.
+ * @return Wartość logiczna.
+ */
+static bool graph_valid(const void *data, size_t size)
+{
+	const struct graph_header *header = data;
+	if (size < sizeof(struct graph_header)
+		|| memcmp(header->magic, GRAPH_MAGIC, sizeof(header->magic))
+		|| header->version != GRAPH_VERSION
+		|| header->root >= header->node_count
+		|| size != graph_size(header->node_count, header->edge_count))
+		return false;
+	const uint32_t *nodes = (const uint32_t *) (header + 1);
+	return nodes[header->node_count] >> 1 == header->edge_count;
+}
+
+/**
+  Stan minimalizacji grafu: budowany graf wynikowy w tablicach
+  rosnących geometrycznie oraz tablica haszująca jego węzłów.
+ */
+struct minimizer
+{
+	uint32_t *nodes; ///< Węzły grafu wynikowego.
+	uint32_t node_count; ///< Liczba węzłów.
+	uint32_t node_capacity; ///< Rozmiar tablicy węzłów.
+	struct graph_edge *edges; ///< Krawędzie grafu wynikowego.
+	uint32_t edge_count; ///< Liczba krawędzi.
+	uint32_t edge_capacity; ///< Rozmiar tablicy krawędzi.
+	uint32_t *table; ///< Tablica haszująca: indeks węzła + 1 lub 0.
+	uint32_t table_size; ///< Rozmiar tablicy haszującej, potęga dwójki.
+};
+
+/**
+ * Powiększa tablicę dwukrotnie, jeśli brakuje w niej miejsca.
+ * @param[in,out] array Tablica.
+ * @param[in,out] capacity Rozmiar tablicy w elementach.
+ * @param[in] need Potrzebna liczba elementów.
+ * @param[in] elem Rozmiar elementu.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+static bool reserve(void **array, uint32_t *capacity, uint64_t need,
+					size_t elem)
+{
+	if (need <= *capacity)
+		return true;
+	uint64_t new_capacity = *capacity ? *capacity : 64;
+	while (new_capacity < need)
+		new_capacity *= 2;
+	if (new_capacity > UINT32_MAX)
+		return false;
+	void *new_array = realloc(*array, new_capacity * elem);
+	if (new_array == NULL)
+		return false;
+	*array = new_array;
+	*capacity = new_capacity;
+	return true;
+}
+
+/**
+ * Wylicza skrót węzła na podstawie jego krawędzi i bitu końca słowa.
+ * @param[in] terminal Czy w węźle kończy się słowo.
+ * @param[in] edges Krawędzie węzła.
+ * @param[in] n Liczba krawędzi.
+ * @return Skrót.
+ */
+static uint32_t signature_hash(bool terminal, const struct graph_edge *edges,
+							   uint32_t n)
+{
+	uint64_t h = 0x9e3779b97f4a7c15ull + terminal;
+	for (uint32_t i = 0; i < n; i++)
+	{
+		h ^= (uint64_t) (uint32_t) edges[i].key << 32 | edges[i].target;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+	}
+	return (uint32_t) (h ^ h >> 32);
+}
+
+/**
+ * Zwraca zakres krawędzi węzła budowanego grafu.
+ * @param[in] m Stan minimalizacji.
+ * @param[in] node Indeks węzła.
+ * @param[out] first Indeks pierwszej krawędzi.
+ * @return Liczba krawędzi.
+ */
+static uint32_t minimizer_edges(const struct minimizer *m, uint32_t node,
+								uint32_t *first)
+{
+	*first = m->nodes[node] >> 1;
+	uint32_t last = node + 1 < m->node_count
+		? m->nodes[node + 1] >> 1 : m->edge_count;
+	return last - *first;
+}
+
+/**
+ * Podwaja tablicę haszującą i rozmieszcza w niej węzły od nowa.
+ * @param[in,out] m Stan minimalizacji.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+static bool minimizer_rehash(struct minimizer *m)
+{
+	uint32_t size = m->table_size ? 2 * m->table_size : 1024;
+	uint32_t *table = calloc(size, sizeof(uint32_t));
+	if (table == NULL)
+		return false;
+	for (uint32_t node = 0; node < m->node_count; node++)
+	{
+		uint32_t first;
+		uint32_t n = minimizer_edges(m, node, &first);
+		uint32_t i = signature_hash(m->nodes[node] & 1, m->edges + first, n);
+		while (table[i & (size - 1)])
+			i++;
+		table[i & (size - 1)] = node + 1;
+	}
+	free(m->table);
+	m->table = table;
+	m->table_size = size;
+	return true;
+}
+
+/**
+ * Zwraca indeks węzła o podanych krawędziach i bicie końca słowa,
+ * dodając go do budowanego grafu, jeśli jeszcze go tam nie ma.
+ * @param[in,out] m Stan minimalizacji.
+ * @param[in] terminal Czy w węźle kończy się słowo.
+ * @param[in] edges Krawędzie węzła, wskazujące na węzły grafu wynikowego.
+ * @param[in] n Liczba krawędzi.
+ * @param[out] node Indeks węzła.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+static bool minimizer_add(struct minimizer *m, bool terminal,
+						  const struct graph_edge *edges, uint32_t n,
+						  uint32_t *node)
+{
+	if (2 * ((uint64_t) m->node_count + 1) > m->table_size
+		&& !minimizer_rehash(m))
+		return false;
+	uint32_t mask = m->table_size - 1;
+	uint32_t i = signature_hash(terminal, edges, n) & mask;
+	for (; m->table[i]; i = (i + 1) & mask)
+	{
+		uint32_t candidate = m->table[i] - 1;
+		uint32_t first;
+		if ((m->nodes[candidate] & 1) == terminal
+			&& minimizer_edges(m, candidate, &first) == n
+			&& (n == 0
+				|| !memcmp(m->edges + first, edges, n * sizeof(*edges))))
+		{
+			*node = candidate;
+			return true;
+		}
+	}
+	if (!reserve((void **) &m->nodes, &m->node_capacity,
+				 (uint64_t) m->node_count + 2, sizeof(uint32_t))
+		|| !reserve((void **) &m->edges, &m->edge_capacity,
+					(uint64_t) m->edge_count + n, sizeof(struct graph_edge)))
+		return false;
+	*node = m->node_count++;
+	m->nodes[*node] = m->edge_count << 1 | terminal;
+	/* Węzeł bez krawędzi może mieć edges == NULL, a memcpy nie przyjmuje
+	   NULL nawet przy zerowej długości. */
+	if (n > 0)
+		memcpy(m->edges + m->edge_count, edges, n * sizeof(*edges));
+	m->edge_count += n;
+	m->table[i] = *node + 1;
+	return true;
+}
+
+/**@}*/
+/** @name Elementy interfejsu
+  @{
+ */
+
+struct graph * graph_new(uint32_t node_count, uint32_t edge_count)
+{
+	struct graph *graph = malloc(sizeof(struct graph));
+	size_t size = graph_size(node_count, edge_count);
+	void *data = calloc(1, size);
+	if (graph == NULL || data == NULL)
+	{
+		free(graph);
+		free(data);
+		return NULL;
+	}
+	struct graph_header *header = data;
+	memcpy(header->magic, GRAPH_MAGIC, sizeof(header->magic));
+	header->version = GRAPH_VERSION;
+	header->node_count = node_count;
+	header->edge_count = edge_count;
+	graph->mapped = false;
+	graph_attach(graph, data, size);
+	return graph;
+}
+
+struct graph * graph_map(const char *path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	void *data = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+		data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return NULL;
+	struct graph *graph = malloc(sizeof(struct graph));
+	if (graph == NULL || !graph_valid(data, st.st_size))
+	{
+		free(graph);
+		munmap(data, st.st_size);
+		return NULL;
+	}
+	graph->mapped = true;
+	graph_attach(graph, data, st.st_size);
+	return graph;
+}
+
+struct graph * graph_read(FILE *stream)
+{
+	struct graph_header header;
+	if (fread(&header, sizeof(header), 1, stream) != 1
+		|| memcmp(header.magic, GRAPH_MAGIC, sizeof(header.magic))
+		|| header.version != GRAPH_VERSION)
+		return NULL;
+	struct graph *graph = graph_new(header.node_count, header.edge_count);
+	if (graph == NULL)
+		return NULL;
+	memcpy(graph->header, &header, sizeof(header));
+	size_t rest = graph->size - sizeof(header);
+	if (fread(graph->header + 1, 1, rest, stream) != rest
+		|| !graph_valid(graph->data, graph->size))
+	{
+		graph_done(graph);
+		return NULL;
+	}
+	return graph;
+}
+
+int graph_write(const struct graph *graph, FILE *stream)
+{
+	if (fwrite(graph->data, 1, graph->size, stream) != graph->size)
+		return -1;
+	return 0;
+}
+
+void graph_done(struct graph *graph)
+{
+	if (graph == NULL)
+		return;
+	if (graph->mapped)
+		munmap(graph->data, graph->size);
+	else
+		free(graph->data);
+	free(graph);
+}
+
+struct graph * graph_minimize(const struct graph *graph)
+{
+	uint32_t node_count = graph->header->node_count;
+	struct minimizer m = { NULL, 0, 0, NULL, 0, 0, NULL, 0 };
+	/* map[v] to indeks w grafie wynikowym węzła v lub UINT32_MAX */
+	uint32_t *map = malloc(node_count * sizeof(uint32_t));
+	/* stos par (węzeł, indeks następnej krawędzi) */
+	uint32_t *stack = NULL;
+	uint32_t stack_capacity = 0;
+	uint32_t stack_size = 0;
+	struct graph_edge *candidate = NULL;
+	uint32_t candidate_capacity = 0;
+	bool valid = map != NULL
+		&& reserve((void **) &stack, &stack_capacity, 2, sizeof(uint32_t));
+	if (valid)
+	{
+		memset(map, 0xff, node_count * sizeof(uint32_t));
+		stack[stack_size++] = graph->header->root;
+		stack[stack_size++] = graph_first_edge(graph, graph->header->root);
+	}
+	/* Węzły przetwarzane są w kolejności post-order, więc w chwili
+	   przetwarzania węzła jego dzieci mają już indeksy wynikowe. */
+	while (valid && stack_size > 0)
+	{
+		uint32_t vertex = stack[stack_size - 2];
+		uint32_t *index = &stack[stack_size - 1];
+		if (*index < graph_last_edge(graph, vertex))
+		{
+			uint32_t target = graph->edges[(*index)++].target;
+			if (map[target] != UINT32_MAX)
+				continue;
+			valid = reserve((void **) &stack, &stack_capacity,
+							(uint64_t) stack_size + 2, sizeof(uint32_t));
+			if (!valid)
+				break;
+			stack[stack_size++] = target;
+			stack[stack_size++] = graph_first_edge(graph, target);
+			continue;
+		}
+		stack_size -= 2;
+		uint32_t first = graph_first_edge(graph, vertex);
+		uint32_t n = graph_last_edge(graph, vertex) - first;
+		valid = reserve((void **) &candidate, &candidate_capacity, n,
+						sizeof(struct graph_edge));
+		for (uint32_t i = 0; valid && i < n; i++)
+		{
+			candidate[i].key = graph->edges[first + i].key;
+			candidate[i].target = map[graph->edges[first + i].target];
+		}
+		valid = valid && minimizer_add(&m, graph_is_terminal(graph, vertex),
+									   candidate, n, &map[vertex]);
+	}
+	struct graph *result = valid ? graph_new(m.node_count, m.edge_count) : NULL;
+	if (result != NULL)
+	{
+		/* Tablice pustego grafu mogły nie zostać przydzielone. */
+		if (m.node_count > 0)
+			memcpy(result->nodes, m.nodes, m.node_count * sizeof(uint32_t));
+		result->nodes[m.node_count] = m.edge_count << 1;
+		if (m.edge_count > 0)
+			memcpy(result->edges, m.edges,
+				   m.edge_count * sizeof(struct graph_edge));
+		result->header->root = map[graph->header->root];
+	}
+	free(map);
+	free(stack);
+	free(candidate);
+	free(m.nodes);
+	free(m.edges);
+	free(m.table);
+	return result;
+}
+
+bool graph_child(const struct graph *graph, uint32_t node, wchar_t key,
+                 uint32_t *target)
+{
+	STATS_ADD(child_probes, 1);
+	uint32_t l = graph_first_edge(graph, node);
+	uint32_t r = graph_last_edge(graph, node);
+	while (l < r)
+	{
+		uint32_t s = l + (r - l) / 2;
+		if (graph->edges[s].key < key)
+			l = s + 1;
+		else
+			r = s;
+	}
+	if (l < graph_last_edge(graph, node) && graph->edges[l].key == key)
+	{
+		*target = graph->edges[l].target;
+		return true;
+	}
+	return false;
+}
+
+bool graph_find(const struct graph *graph, const wchar_t *word)
+{
+	uint32_t node = graph->header->root;
+	for (; *word; word++)
+	{
+		STATS_ADD(nodes_visited, 1);
+		if (!graph_child(graph, node, *word, &node))
+			return false;
+	}
+	return graph_is_terminal(graph, node);
+}
+
+/**@}*/
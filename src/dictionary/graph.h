@@ -0,0 +1,195 @@
+/** @file
+    Interfejs grafu słownika w postaci płaskiej.
+
+    Graf jest niezmienialną reprezentacją słownika, w której zamiast
+    wskaźników używa się indeksów. Dzięki temu ten sam obszar pamięci
+    może być zapisany na dysk i zmapowany z powrotem przez mmap() bez
+    żadnego przetwarzania.
+
+    Układ pliku (w kolejności bajtów maszyny, która go zapisała):
+     - nagłówek struct graph_header,
+     - tablica `node_count + 1` liczb uint32_t opisujących węzły:
+       `nodes[i] >> 1` to indeks pierwszej krawędzi węzła `i`,
+       najmłodszy bit oznacza, że w węźle kończy się słowo;
+       krawędzie węzła `i` to przedział `[nodes[i] >> 1, nodes[i + 1] >> 1)`,
+     - tablica `edge_count` krawędzi struct graph_edge, posortowanych
+       w obrębie węzła rosnąco po kluczu.
+
+    @ingroup dictionary
+    @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+    @date 2015-06-14
+ */
+
+#ifndef __GRAPH_H__
+#define __GRAPH_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <wchar.h>
+
+/**
+  Sygnatura pliku z grafem.
+  */
+#define GRAPH_MAGIC "\x7f" "DICTBIN"
+
+/**
+  Wersja formatu pliku.
+  */
+#define GRAPH_VERSION 1
+
+/**
+  Nagłówek grafu.
+  */
+struct graph_header
+{
+    /// Sygnatura GRAPH_MAGIC.
+    char magic[8];
+    /// Wersja formatu.
+    uint32_t version;
+    /// Liczba węzłów.
+    uint32_t node_count;
+    /// Liczba krawędzi.
+    uint32_t edge_count;
+    /// Indeks korzenia.
+    uint32_t root;
+    /// Zarezerwowane, zawsze 0.
+    uint32_t reserved[4];
+};
+
+/**
+  Krawędź grafu.
+  */
+struct graph_edge
+{
+    /// Litera.
+    int32_t key;
+    /// Indeks węzła docelowego.
+    uint32_t target;
+};
+
+/**
+  Struktura przechowująca graf.
+  */
+struct graph
+{
+    /// Nagłówek.
+    struct graph_header *header;
+    /// Tablica węzłów.
+    uint32_t *nodes;
+    /// Tablica krawędzi.
+    struct graph_edge *edges;
+    /// Obszar pamięci z całym grafem.
+    void *data;
+    /// Rozmiar obszaru pamięci.
+    size_t size;
+    /// Czy obszar pochodzi z mmap().
+    bool mapped;
+};
+
+/**
+  Tworzy pusty graf o podanej liczbie węzłów i krawędzi.
+  Tablice węzłów i krawędzi należy wypełnić samodzielnie.
+  Graf należy zniszczyć za pomocą graph_done().
+  @param[in] node_count Liczba węzłów.
+  @param[in] edge_count Liczba krawędzi.
+  @return Nowy graf lub NULL, jeśli zabrakło pamięci.
+  */
+struct graph * graph_new(uint32_t node_count, uint32_t edge_count);
+
+/**
+  Mapuje graf z pliku tylko do odczytu.
+  @param[in] path Ścieżka do pliku.
+  @return Graf lub NULL, jeśli plik nie zawiera poprawnego grafu.
+  */
+struct graph * graph_map(const char *path);
+
+/**
+  Wczytuje graf ze strumienia.
+  Strumień musi być ustawiony na początku sygnatury.
+  @param[in,out] stream Strumień.
+  @return Graf lub NULL, jeśli strumień nie zawiera poprawnego grafu.
+  */
+struct graph * graph_read(FILE *stream);
+
+/**
+  Zapisuje graf do strumienia.
+  @param[in] graph Graf.
+  @param[in,out] stream Strumień.
+  @return <0 jeśli operacja się nie powiedzie, 0 w p.p.
+  */
+int graph_write(const struct graph *graph, FILE *stream);
+
+/**
+  Destrukcja grafu.
+  @param[in,out] graph Graf.
+  */
+void graph_done(struct graph *graph);
+
+/**
+  Zwraca indeks pierwszej krawędzi węzła.
+  @param[in] graph Graf.
+  @param[in] node Indeks węzła.
+  @return Indeks krawędzi.
+  */
+static inline
+uint32_t graph_first_edge(const struct graph *graph, uint32_t node)
+{
+    return graph->nodes[node] >> 1;
+}
+
+/**
+  Zwraca indeks za ostatnią krawędzią węzła.
+  @param[in] graph Graf.
+  @param[in] node Indeks węzła.
+  @return Indeks krawędzi.
+  */
+static inline
+uint32_t graph_last_edge(const struct graph *graph, uint32_t node)
+{
+    return graph->nodes[node + 1] >> 1;
+}
+
+/**
+  Sprawdza, czy w węźle kończy się słowo.
+  @param[in] graph Graf.
+  @param[in] node Indeks węzła.
+  @return Wartość logiczna.
+  */
+static inline
+bool graph_is_terminal(const struct graph *graph, uint32_t node)
+{
+    return graph->nodes[node] & 1;
+}
+
+/**
+  Tworzy minimalny graf rozpoznający te same słowa co 'graph'.
+  Węzły o tym samym zbiorze słów (w szczególności wspólne końcówki)
+  są w wyniku sklejone w jeden węzeł, przez co drzewo staje się
+  minimalnym acyklicznym automatem słów (DAWG).
+  Graf wejściowy może już współdzielić węzły.
+  @param[in] graph Graf.
+  @return Nowy graf lub NULL, jeśli zabrakło pamięci.
+  */
+struct graph * graph_minimize(const struct graph *graph);
+
+/**
+  Szuka krawędzi o podanym kluczu wychodzącej z węzła.
+  @param[in] graph Graf.
+  @param[in] node Indeks węzła.
+  @param[in] key Klucz.
+  @param[out] target Indeks węzła docelowego.
+  @return Wartość logiczna czy krawędź istnieje.
+  */
+bool graph_child(const struct graph *graph, uint32_t node, wchar_t key,
+                 uint32_t *target);
+
+/**
+  Sprawdza, czy dane słowo znajduje się w grafie.
+  @param[in] graph Graf.
+  @param[in] word Szukane słowo.
+  @return Wartość logiczna czy `word` jest w grafie.
+  */
+bool graph_find(const struct graph *graph, const wchar_t *word);
+
+#endif /* __GRAPH_H__ */
@@ -0,0 +1,296 @@
+/** @file
+  Implementacja pamięci podręcznej podpowiedzi.
+
+  @ingroup dictionary
+  @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+  @date 2015-07-05
+ */
+
+#include "hint_cache.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <wctype.h>
+
+/**
+  Długość słowa, poniżej której słowo zamienione na małe litery trzymane
+  jest przy wyszukiwaniu na stosie.
+ */
+#define LOCAL_WORD 64
+
+/**
+  Zapamiętane podpowiedzi dla jednego słowa.
+ */
+struct cache_entry
+{
+	wchar_t *key; ///< Słowo małymi literami.
+	size_t key_size; ///< Rozmiar bufora słowa.
+	uint32_t hash; ///< Skrót słowa.
+	struct word_list hints; ///< Podpowiedzi.
+	struct cache_entry *prev; ///< Poprzedni (częściej używany) wpis.
+	struct cache_entry *next; ///< Następny (rzadziej używany) wpis.
+	struct cache_entry *chain; ///< Następny wpis w tym samym kubełku.
+};
+
+/**
+  Struktura przechowująca pamięć podręczną podpowiedzi.
+  Wpisy są w tablicy haszującej z listami w kubełkach i jednocześnie
+  na dwukierunkowej liście od ostatnio do najdawniej używanego.
+ */
+struct hint_cache
+{
+	struct cache_entry **buckets; ///< Kubełki tablicy haszującej.
+	size_t bucket_count; ///< Liczba kubełków, potęga dwójki.
+	struct cache_entry *head; ///< Ostatnio używany wpis.
+	struct cache_entry *tail; ///< Najdawniej używany wpis.
+	size_t size; ///< Liczba wpisów.
+	size_t capacity; ///< Największa liczba wpisów.
+	const struct dictionary *dict; ///< Słownik, z którego pochodzą wpisy.
+	uint64_t generation; ///< Generacja słownika, z której pochodzą wpisy.
+	size_t hits; ///< Liczba trafień.
+	size_t misses; ///< Liczba chybień.
+};
+
+/** @name Funkcje pomocnicze
+  @{
+ */
+
+/**
+ * Zamienia słowo na małe litery i wylicza skrót wyniku.
+ * @param[in] word Słowo.
+ * @param[out] key Bufor na wynik, o długości słowa + 1.
+ * @return Skrót wyniku.
+ */
+static uint32_t lowercase(const wchar_t *word, wchar_t *key)
+{
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i == 0 || word[i - 1]; i++)
+	{
+		key[i] = towlower(word[i]);
+		h ^= (uint32_t) key[i];
+		h *= 16777619u;
+	}
+	return h ^ (h >> 16);
+}
+
+/**
+ * Odłącza wpis od listy używania.
+ * @param[in,out] cache Pamięć podręczna.
+ * @param[in,out] entry Wpis.
+ */
+static void unlink_entry(struct hint_cache *cache, struct cache_entry *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		cache->head = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		cache->tail = entry->prev;
+}
+
+/**
+ * Wstawia wpis na początek listy używania.
+ * @param[in,out] cache Pamięć podręczna.
+ * @param[in,out] entry Wpis.
+ */
+static void push_front(struct hint_cache *cache, struct cache_entry *entry)
+{
+	entry->prev = NULL;
+	entry->next = cache->head;
+	if (cache->head)
+		cache->head->prev = entry;
+	else
+		cache->tail = entry;
+	cache->head = entry;
+}
+
+/**
+ * Zwalnia wpis.
+ * @param[in,out] entry Wpis.
+ */
+static void free_entry(struct cache_entry *entry)
+{
+	word_list_done(&entry->hints);
+	free(entry->key);
+	free(entry);
+}
+
+/**
+ * Wyjmuje z pamięci podręcznej najdawniej używany wpis.
+ * @param[in,out] cache Niepusta pamięć podręczna.
+ * @return Wpis, do ponownego użycia lub zwolnienia.
+ */
+static struct cache_entry * detach(struct hint_cache *cache)
+{
+	struct cache_entry *entry = cache->tail;
+	struct cache_entry **link =
+		&cache->buckets[entry->hash & (cache->bucket_count - 1)];
+	while (*link != entry)
+		link = &(*link)->chain;
+	*link = entry->chain;
+	unlink_entry(cache, entry);
+	cache->size--;
+	return entry;
+}
+
+/**
+ * Daje wpis na nowe słowo: przy zapełnionej pamięci podręcznej ponownie
+ * używa najdawniej używanego wpisu razem z jego listą podpowiedzi.
+ * @param[in,out] cache Pamięć podręczna.
+ * @param[in] key Słowo małymi literami.
+ * @param[in] len Długość słowa.
+ * @return Wpis poza pamięcią podręczną lub NULL, jeśli zabrakło pamięci.
+ */
+static struct cache_entry * take_entry(struct hint_cache *cache,
+									   const wchar_t *key, size_t len)
+{
+	struct cache_entry *entry;
+	if (cache->size > 0 && cache->size >= cache->capacity)
+		entry = detach(cache);
+	else if ((entry = malloc(sizeof(struct cache_entry))) != NULL)
+	{
+		entry->key = NULL;
+		entry->key_size = 0;
+		word_list_init(&entry->hints);
+	}
+	else
+		return NULL;
+	if (entry->key_size < len + 1)
+	{
+		wchar_t *copy = realloc(entry->key, (len + 1) * sizeof(wchar_t));
+		if (copy == NULL)
+		{
+			free_entry(entry);
+			return NULL;
+		}
+		entry->key = copy;
+		entry->key_size = len + 1;
+	}
+	wmemcpy(entry->key, key, len + 1);
+	return entry;
+}
+
+/**
+ * Kopiuje podpowiedzi do listy wynikowej.
+ * @param[in] hints Podpowiedzi.
+ * @param[in,out] list Lista wynikowa.
+ */
+static void copy_hints(const struct word_list *hints, struct word_list *list)
+{
+	word_list_clear(list);
+	const wchar_t * const *a = word_list_get(hints);
+	for (size_t i = 0; i < word_list_size(hints); i++)
+		word_list_add(list, a[i]);
+}
+
+/**@}*/
+/** @name Elementy interfejsu
+  @{
+ */
+
+struct hint_cache * hint_cache_new(size_t capacity)
+{
+	struct hint_cache *cache = calloc(1, sizeof(struct hint_cache));
+	if (cache == NULL)
+		return NULL;
+	cache->capacity = capacity;
+	cache->bucket_count = 16;
+	while (cache->bucket_count < capacity)
+		cache->bucket_count *= 2;
+	cache->buckets = calloc(cache->bucket_count, sizeof(struct cache_entry *));
+	if (cache->buckets == NULL)
+	{
+		free(cache);
+		return NULL;
+	}
+	return cache;
+}
+
+void hint_cache_done(struct hint_cache *cache)
+{
+	if (cache == NULL)
+		return;
+	hint_cache_clear(cache);
+	free(cache->buckets);
+	free(cache);
+}
+
+void hint_cache_clear(struct hint_cache *cache)
+{
+	while (cache->size > 0)
+		free_entry(detach(cache));
+}
+
+void hint_cache_hints(struct hint_cache *cache, const struct dictionary *dict,
+					  const wchar_t *word, struct word_list *list)
+{
+	word_list_init(list);
+	hint_cache_hints_into(cache, dict, word, list);
+}
+
+void hint_cache_hints_into(struct hint_cache *cache,
+						   const struct dictionary *dict, const wchar_t *word,
+						   struct word_list *list)
+{
+	if (cache->dict != dict || cache->generation != dictionary_generation(dict))
+	{
+		hint_cache_clear(cache);
+		cache->dict = dict;
+		cache->generation = dictionary_generation(dict);
+	}
+	size_t len = wcslen(word);
+	wchar_t local[LOCAL_WORD];
+	wchar_t *key = len < LOCAL_WORD ? local
+		: malloc((len + 1) * sizeof(wchar_t));
+	if (key == NULL)
+	{
+		dictionary_hints_into(dict, word, list);
+		return;
+	}
+	uint32_t hash = lowercase(word, key);
+	struct cache_entry **bucket =
+		&cache->buckets[hash & (cache->bucket_count - 1)];
+	struct cache_entry *entry;
+	for (entry = *bucket; entry; entry = entry->chain)
+		if (entry->hash == hash && wcscmp(entry->key, key) == 0)
+			break;
+	if (entry != NULL)
+	{
+		cache->hits++;
+		unlink_entry(cache, entry);
+	}
+	else if ((entry = take_entry(cache, key, len)) != NULL)
+	{
+		cache->misses++;
+		entry->hash = hash;
+		dictionary_hints_into(dict, key, &entry->hints);
+		entry->chain = *bucket;
+		*bucket = entry;
+		cache->size++;
+	}
+	else
+	{
+		cache->misses++;
+		dictionary_hints_into(dict, key, list);
+	}
+	if (entry != NULL)
+	{
+		push_front(cache, entry);
+		copy_hints(&entry->hints, list);
+	}
+	if (key != local)
+		free(key);
+}
+
+size_t hint_cache_hits(const struct hint_cache *cache)
+{
+	return cache->hits;
+}
+
+size_t hint_cache_misses(const struct hint_cache *cache)
+{
+	return cache->misses;
+}
+
+/**@}*/
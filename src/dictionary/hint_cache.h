@@ -0,0 +1,90 @@
+/** @file
+    Interfejs pamięci podręcznej podpowiedzi.
+
+    Pamięć podręczna trzyma podpowiedzi dla ostatnio używanych słów,
+    tak aby powtarzające się w tekście błędy nie wymagały ponownego
+    wywołania dictionary_hints(). Kluczem jest słowo zamienione na małe
+    litery. Gdy pamięć jest pełna, usuwane jest najdawniej używane słowo.
+    Zmiana słownika przez dictionary_insert() lub dictionary_delete()
+    unieważnia całą zawartość przy następnym odwołaniu.
+
+    @ingroup dictionary
+    @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+    @date 2015-07-05
+ */
+
+#ifndef __HINT_CACHE_H__
+#define __HINT_CACHE_H__
+
+#include "dictionary.h"
+#include "word_list.h"
+#include <stddef.h>
+#include <wchar.h>
+
+/**
+  Struktura przechowująca pamięć podręczną podpowiedzi.
+  */
+struct hint_cache;
+
+/**
+  Tworzy pustą pamięć podręczną.
+  Należy ją zniszczyć za pomocą hint_cache_done().
+  @param[in] capacity Największa liczba pamiętanych słów, większa od zera.
+  @return Nowa pamięć podręczna lub NULL, jeśli zabrakło pamięci.
+  */
+struct hint_cache * hint_cache_new(size_t capacity);
+
+/**
+  Destrukcja pamięci podręcznej.
+  @param[in,out] cache Pamięć podręczna lub NULL.
+  */
+void hint_cache_done(struct hint_cache *cache);
+
+/**
+  Usuwa całą zawartość pamięci podręcznej. Liczniki nie są zerowane.
+  @param[in,out] cache Pamięć podręczna.
+  */
+void hint_cache_clear(struct hint_cache *cache);
+
+/**
+  Wyszukuje podpowiedzi dla słowa, tak jak dictionary_hints() dla słowa
+  zamienionego na małe litery, korzystając z wcześniej zapamiętanych
+  wyników. Pamięć podręczna może być używana tylko z jednym słownikiem
+  naraz; użycie z innym słownikiem czyści ją.
+  @param[in,out] cache Pamięć podręczna.
+  @param[in] dict Słownik.
+  @param[in] word Słowo.
+  @param[in,out] list Lista, w której zostaną umieszczone podpowiedzi,
+  jak w dictionary_hints().
+  */
+void hint_cache_hints(struct hint_cache *cache, const struct dictionary *dict,
+                      const wchar_t *word, struct word_list *list);
+
+/**
+  Wyszukuje podpowiedzi jak hint_cache_hints(), ale w liście już
+  zainicjowanej, jak dictionary_hints_into().
+  @param[in,out] cache Pamięć podręczna.
+  @param[in] dict Słownik.
+  @param[in] word Słowo.
+  @param[in,out] list Lista zainicjowana przez word_list_init(), w której
+  zostaną umieszczone podpowiedzi.
+  */
+void hint_cache_hints_into(struct hint_cache *cache,
+                           const struct dictionary *dict, const wchar_t *word,
+                           struct word_list *list);
+
+/**
+  Zwraca liczbę wyszukań obsłużonych z pamięci podręcznej.
+  @param[in] cache Pamięć podręczna.
+  @return Liczba trafień.
+  */
+size_t hint_cache_hits(const struct hint_cache *cache);
+
+/**
+  Zwraca liczbę wyszukań, które wymagały wywołania dictionary_hints().
+  @param[in] cache Pamięć podręczna.
+  @return Liczba chybień.
+  */
+size_t hint_cache_misses(const struct hint_cache *cache);
+
+#endif /* __HINT_CACHE_H__ */
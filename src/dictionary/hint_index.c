@@ -0,0 +1,450 @@
+/** @file
+  Implementacja indeksu usunięć do szybkiego wyszukiwania podpowiedzi.
+
+  @ingroup dictionary
+  @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+  @date 2015-06-28
+ */
+
+#include "hint_index.h"
+#include "stats.h"
+#include "text_io.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+  Początkowy rozmiar tablicy haszującej.
+ */
+#define MIN_CAPACITY 1024
+
+/**
+  Liczba pozycji tablicy zapisywanych naraz.
+ */
+#define WRITE_CHUNK 4096
+
+/** @name Funkcje pomocnicze
+  @{
+ */
+
+/**
+ * Wylicza skrót wariantu słowa bez litery na pozycji 'skip'.
+ * @param[in] word Słowo.
+ * @param[in] len Długość słowa.
+ * @param[in] skip Pozycja usuwanej litery lub 'len' dla całego słowa.
+ * @return Skrót.
+ */
+static uint32_t variant_hash(const wchar_t *word, size_t len, size_t skip)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < len; i++)
+		if (i != skip)
+		{
+			hash ^= (uint32_t) word[i];
+			hash *= 16777619u;
+		}
+	/* Mieszamy starsze bity w młodsze, z których bierzemy pozycję. */
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	return hash;
+}
+
+/**
+ * Sprawdza, czy wariant bez litery na pozycji 'skip' jest potrzebny.
+ * Usunięcie jednej z kilku równych sąsiednich liter daje ten sam wariant,
+ * więc zostawiamy tylko usunięcie pierwszej z nich.
+ * @param[in] word Słowo.
+ * @param[in] skip Pozycja usuwanej litery.
+ * @return Wartość logiczna.
+ */
+static bool variant_needed(const wchar_t *word, size_t skip)
+{
+	return skip == 0 || word[skip] != word[skip - 1];
+}
+
+/**
+ * Sprawdza, czy słowa różnią się co najwyżej jednym wstawieniem,
+ * usunięciem lub zamianą litery.
+ * @param[in] a Pierwsze słowo.
+ * @param[in] len_a Długość pierwszego słowa.
+ * @param[in] b Drugie słowo.
+ * @return Wartość logiczna.
+ */
+static bool within_one(const wchar_t *a, size_t len_a, const wchar_t *b)
+{
+	size_t len_b = wcslen(b);
+	if (len_a > len_b + 1 || len_b > len_a + 1)
+		return false;
+	size_t p = 0;
+	while (p < len_a && p < len_b && a[p] == b[p])
+		p++;
+	if (len_a == len_b)
+		return p == len_a || wcscmp(a + p + 1, b + p + 1) == 0;
+	if (len_a > len_b)
+		return wcscmp(a + p + 1, b + p) == 0;
+	return wcscmp(a + p, b + p + 1) == 0;
+}
+
+/**
+ * Wstawia parę (skrót, numer słowa) do tablicy, w której jest miejsce.
+ * @param[in,out] table Tablica.
+ * @param[in] capacity Rozmiar tablicy.
+ * @param[in] entry Para do wstawienia.
+ */
+static void put_entry(struct hint_entry *table, uint32_t capacity,
+					  struct hint_entry entry)
+{
+	uint32_t mask = capacity - 1;
+	uint32_t slot = entry.hash & mask;
+	while (table[slot].id != HINT_INDEX_EMPTY)
+		slot = (slot + 1) & mask;
+	table[slot] = entry;
+}
+
+/**
+ * Tworzy tablicę z samymi wolnymi pozycjami.
+ * @param[in] capacity Rozmiar tablicy.
+ * @return Tablica lub NULL, jeśli zabrakło pamięci.
+ */
+static struct hint_entry * new_table(uint32_t capacity)
+{
+	struct hint_entry *table = malloc(capacity * sizeof(struct hint_entry));
+	if (table != NULL)
+		for (uint32_t i = 0; i < capacity; i++)
+			table[i].id = HINT_INDEX_EMPTY;
+	return table;
+}
+
+/**
+ * Zapewnia w tablicy miejsce na 'extra' nowych pozycji, utrzymując
+ * wypełnienie nie większe niż 3/4.
+ * @param[in,out] index Indeks.
+ * @param[in] extra Liczba nowych pozycji.
+ * @return true jeśli się udało, false jeśli zabrakło pamięci.
+ */
+static bool reserve_entries(struct hint_index *index, size_t extra)
+{
+	size_t need = index->size + extra;
+	uint64_t capacity = index->capacity;
+	while (4 * need > 3 * capacity)
+		capacity *= 2;
+	if (capacity == index->capacity)
+		return true;
+	if (capacity > UINT32_MAX)
+		return false;
+	struct hint_entry *table = new_table(capacity);
+	if (table == NULL)
+		return false;
+	for (uint32_t i = 0; i < index->capacity; i++)
+		if (index->table[i].id != HINT_INDEX_EMPTY)
+			put_entry(table, capacity, index->table[i]);
+	free(index->table);
+	index->table = table;
+	index->capacity = capacity;
+	return true;
+}
+
+/**
+ * Usuwa z tablicy parę (skrót, numer słowa), przesuwając wstecz
+ * pozycje z dalszej części ciągu sond.
+ * @param[in,out] index Indeks.
+ * @param[in] hash Skrót.
+ * @param[in] id Numer słowa.
+ */
+static void remove_entry(struct hint_index *index, uint32_t hash, uint32_t id)
+{
+	struct hint_entry *table = index->table;
+	uint32_t mask = index->capacity - 1;
+	uint32_t hole = hash & mask;
+	while (table[hole].hash != hash || table[hole].id != id)
+		hole = (hole + 1) & mask;
+	for (uint32_t slot = (hole + 1) & mask;
+		 table[slot].id != HINT_INDEX_EMPTY; slot = (slot + 1) & mask)
+	{
+		/* Pozycję można przesunąć do dziury, jeśli jej miejsce docelowe
+		   nie leży cyklicznie w przedziale (hole, slot]. */
+		uint32_t home = table[slot].hash & mask;
+		if (((slot - home) & mask) >= ((slot - hole) & mask))
+		{
+			table[hole] = table[slot];
+			hole = slot;
+		}
+	}
+	table[hole].id = HINT_INDEX_EMPTY;
+	index->size--;
+}
+
+/**
+ * Szuka numeru słowa w indeksie.
+ * @param[in] index Indeks.
+ * @param[in] word Słowo.
+ * @param[in] len Długość słowa.
+ * @return Numer słowa lub HINT_INDEX_EMPTY, jeśli go nie ma.
+ */
+static uint32_t find_id(const struct hint_index *index, const wchar_t *word,
+						size_t len)
+{
+	uint32_t hash = variant_hash(word, len, len);
+	uint32_t mask = index->capacity - 1;
+	for (uint32_t slot = hash & mask;
+		 index->table[slot].id != HINT_INDEX_EMPTY; slot = (slot + 1) & mask)
+	{
+		uint32_t id = index->table[slot].id;
+		if (index->table[slot].hash == hash
+			&& wcscmp(index->words[id], word) == 0)
+			return id;
+	}
+	return HINT_INDEX_EMPTY;
+}
+
+/**
+ * Przydziela wolny numer słowa.
+ * @param[in,out] index Indeks.
+ * @return Numer lub HINT_INDEX_EMPTY, jeśli zabrakło pamięci.
+ */
+static uint32_t take_id(struct hint_index *index)
+{
+	if (index->free_count > 0)
+		return index->free_ids[--index->free_count];
+	if (index->id_count == index->id_capacity)
+	{
+		uint64_t capacity = index->id_capacity ? 2 * (uint64_t) index->id_capacity
+											   : 64;
+		if (capacity >= HINT_INDEX_EMPTY)
+			return HINT_INDEX_EMPTY;
+		wchar_t **words = realloc(index->words, capacity * sizeof(wchar_t *));
+		if (words == NULL)
+			return HINT_INDEX_EMPTY;
+		index->words = words;
+		/* Wolnych numerów nie może być więcej niż wszystkich, więc
+		   odkładanie numeru nigdy nie wymaga przydziału pamięci. */
+		uint32_t *free_ids = realloc(index->free_ids,
+									 capacity * sizeof(uint32_t));
+		if (free_ids == NULL)
+			return HINT_INDEX_EMPTY;
+		index->free_ids = free_ids;
+		index->id_capacity = capacity;
+	}
+	return index->id_count++;
+}
+
+/**@}*/
+/** @name Elementy interfejsu
+  @{
+ */
+
+struct hint_index * hint_index_new(void)
+{
+	struct hint_index *index = calloc(1, sizeof(struct hint_index));
+	if (index == NULL)
+		return NULL;
+	index->table = new_table(MIN_CAPACITY);
+	if (index->table == NULL)
+	{
+		free(index);
+		return NULL;
+	}
+	index->capacity = MIN_CAPACITY;
+	arena_init(&index->arena);
+	return index;
+}
+
+void hint_index_done(struct hint_index *index)
+{
+	if (index == NULL)
+		return;
+	arena_done(&index->arena);
+	free(index->words);
+	free(index->free_ids);
+	free(index->table);
+	free(index);
+}
+
+bool hint_index_add(struct hint_index *index, const wchar_t *word)
+{
+	size_t len = wcslen(word);
+	if (!reserve_entries(index, len + 1))
+		return false;
+	wchar_t *copy = arena_alloc(&index->arena, (len + 1) * sizeof(wchar_t));
+	if (copy == NULL)
+		return false;
+	uint32_t id = take_id(index);
+	if (id == HINT_INDEX_EMPTY)
+	{
+		arena_free(&index->arena, copy, (len + 1) * sizeof(wchar_t));
+		return false;
+	}
+	wmemcpy(copy, word, len + 1);
+	index->words[id] = copy;
+	for (size_t i = 0; i <= len; i++)
+		if (i == len || variant_needed(word, i))
+		{
+			struct hint_entry entry = { variant_hash(word, len, i), id };
+			put_entry(index->table, index->capacity, entry);
+			index->size++;
+		}
+	index->word_count++;
+	return true;
+}
+
+bool hint_index_remove(struct hint_index *index, const wchar_t *word)
+{
+	size_t len = wcslen(word);
+	uint32_t id = find_id(index, word, len);
+	if (id == HINT_INDEX_EMPTY)
+		return false;
+	for (size_t i = 0; i <= len; i++)
+		if (i == len || variant_needed(word, i))
+			remove_entry(index, variant_hash(word, len, i), id);
+	arena_free(&index->arena, index->words[id], (len + 1) * sizeof(wchar_t));
+	index->words[id] = NULL;
+	index->free_ids[index->free_count++] = id;
+	index->word_count--;
+	return true;
+}
+
+bool hint_index_contains(const struct hint_index *index, const wchar_t *word)
+{
+	return find_id(index, word, wcslen(word)) != HINT_INDEX_EMPTY;
+}
+
+void hint_index_lookup(const struct hint_index *index, const wchar_t *word,
+					   struct word_list *list)
+{
+	size_t len = wcslen(word);
+	uint32_t mask = index->capacity - 1;
+	/* Słowo może być znalezione przez kilka wariantów. */
+	for (size_t i = 0; i <= len; i++)
+	{
+		if (i < len && !variant_needed(word, i))
+			continue;
+		uint32_t hash = variant_hash(word, len, i);
+		for (uint32_t slot = hash & mask;
+			 index->table[slot].id != HINT_INDEX_EMPTY; slot = (slot + 1) & mask)
+		{
+			uint32_t id = index->table[slot].id;
+			if (index->table[slot].hash != hash)
+				continue;
+			STATS_ADD(hint_candidates, 1);
+			if (within_one(word, len, index->words[id]))
+				word_list_add_unique(list, index->words[id]);
+		}
+	}
+}
+
+int hint_index_write(const struct hint_index *index, FILE *stream)
+{
+	/* Numery słów są przy zapisie zagęszczane, żeby pominąć wolne. */
+	uint32_t *remap = malloc((index->id_count + 1) * sizeof(uint32_t));
+	struct hint_entry *chunk = malloc(WRITE_CHUNK * sizeof(struct hint_entry));
+	bool valid = remap != NULL && chunk != NULL;
+	if (valid)
+	{
+		uint32_t next = 0;
+		for (uint32_t id = 0; id < index->id_count; id++)
+			remap[id] = index->words[id] ? next++ : HINT_INDEX_EMPTY;
+		struct hint_index_header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, HINT_INDEX_MAGIC, sizeof(header.magic));
+		header.version = HINT_INDEX_VERSION;
+		header.word_count = index->word_count;
+		header.capacity = index->capacity;
+		header.size = index->size;
+		valid = fwrite(&header, sizeof(header), 1, stream) == 1;
+	}
+	for (uint32_t begin = 0; valid && begin < index->capacity;
+		 begin += WRITE_CHUNK)
+	{
+		uint32_t n = index->capacity - begin;
+		if (n > WRITE_CHUNK)
+			n = WRITE_CHUNK;
+		for (uint32_t i = 0; i < n; i++)
+		{
+			chunk[i] = index->table[begin + i];
+			if (chunk[i].id != HINT_INDEX_EMPTY)
+				chunk[i].id = remap[chunk[i].id];
+		}
+		valid = fwrite(chunk, sizeof(struct hint_entry), n, stream) == n;
+	}
+	free(chunk);
+	free(remap);
+	struct text_writer writer;
+	if (!valid || !text_writer_init(&writer, stream))
+		return -1;
+	for (uint32_t id = 0; id < index->id_count; id++)
+	{
+		const wchar_t *word = index->words[id];
+		if (word == NULL)
+			continue;
+		text_write_int(&writer, wcslen(word));
+		text_write_char(&writer, L' ');
+		for (; *word; word++)
+			text_write_char(&writer, *word);
+		text_write_char(&writer, L'\n');
+	}
+	return text_writer_done(&writer);
+}
+
+struct hint_index * hint_index_read(FILE *stream)
+{
+	struct hint_index_header header;
+	if (fread(&header, sizeof(header), 1, stream) != 1
+		|| memcmp(header.magic, HINT_INDEX_MAGIC, sizeof(header.magic)) != 0
+		|| header.version != HINT_INDEX_VERSION
+		|| header.capacity < MIN_CAPACITY
+		|| (header.capacity & (header.capacity - 1)) != 0
+		|| header.size >= header.capacity
+		|| header.word_count >= HINT_INDEX_EMPTY)
+		return NULL;
+	struct hint_index *index = calloc(1, sizeof(struct hint_index));
+	if (index == NULL)
+		return NULL;
+	arena_init(&index->arena);
+	index->capacity = header.capacity;
+	index->table = malloc(header.capacity * sizeof(struct hint_entry));
+	index->words = malloc((header.word_count + 1) * sizeof(wchar_t *));
+	index->free_ids = malloc((header.word_count + 1) * sizeof(uint32_t));
+	bool valid = index->table && index->words && index->free_ids
+		&& fread(index->table, sizeof(struct hint_entry), header.capacity,
+				 stream) == header.capacity;
+	uint32_t size = 0;
+	for (uint32_t i = 0; valid && i < header.capacity; i++)
+		if (index->table[i].id != HINT_INDEX_EMPTY)
+		{
+			valid = index->table[i].id < header.word_count;
+			size++;
+		}
+	valid = valid && size == header.size;
+	index->size = size;
+	index->id_capacity = header.word_count + 1;
+	struct text_reader reader;
+	reader.buffer = NULL;
+	if (valid)
+		valid = text_reader_init(&reader, stream);
+	for (uint32_t id = 0; valid && id < header.word_count; id++)
+	{
+		int len;
+		wchar_t *word;
+		valid = text_read_int(&reader, &len)
+			&& (word = arena_alloc(&index->arena,
+								   ((size_t) len + 1) * sizeof(wchar_t)));
+		for (int i = 0; valid && i < len; i++)
+			valid = text_read_char(&reader, &word[i]);
+		if (!valid)
+			break;
+		word[len] = L'\0';
+		index->words[id] = word;
+		index->id_count++;
+	}
+	if (reader.buffer != NULL && !text_reader_done(&reader))
+		valid = false;
+	index->word_count = index->id_count;
+	if (!valid || index->word_count != header.word_count)
+	{
+		hint_index_done(index);
+		return NULL;
+	}
+	return index;
+}
+
+/**@}*/
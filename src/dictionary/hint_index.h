@@ -0,0 +1,172 @@
+/** @file
+    Interfejs indeksu usunięć do szybkiego wyszukiwania podpowiedzi.
+
+    Indeks przechowuje słowa słownika i dla każdego słowa jego warianty
+    powstałe przez usunięcie co najwyżej jednej litery. Każdy wariant
+    trafia do tablicy haszującej jako para (skrót wariantu, numer słowa).
+    Słowa odległe o jedną zmianę od szukanego mają wspólny wariant
+    z jednym z wariantów szukanego słowa, więc wyszukanie podpowiedzi to
+    kilka sond w tablicy i sprawdzenie znalezionych kandydatów.
+    Kolizje skrótów nie psują wyniku, bo kandydaci są zawsze sprawdzani.
+
+    Indeks zajmuje kilka razy więcej pamięci niż słownik; opłaca się,
+    gdy podpowiedzi są wyszukiwane bardzo często.
+
+    Układ pliku (w kolejności bajtów maszyny, która go zapisała):
+     - nagłówek struct hint_index_header,
+     - tablica `capacity` pozycji struct hint_entry,
+     - `word_count` słów w UTF-8, każde poprzedzone dziesiętnie zapisaną
+       długością i oddzielone odstępem.
+
+    @ingroup dictionary
+    @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+    @date 2015-06-28
+ */
+
+#ifndef __HINT_INDEX_H__
+#define __HINT_INDEX_H__
+
+#include "arena.h"
+#include "word_list.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <wchar.h>
+
+/**
+  Sygnatura pliku z indeksem.
+  */
+#define HINT_INDEX_MAGIC "\x7f" "DICTIDX"
+
+/**
+  Wersja formatu pliku.
+  */
+#define HINT_INDEX_VERSION 1
+
+/**
+  Nagłówek pliku z indeksem.
+  */
+struct hint_index_header
+{
+    /// Sygnatura HINT_INDEX_MAGIC.
+    char magic[8];
+    /// Wersja formatu.
+    uint32_t version;
+    /// Liczba słów.
+    uint32_t word_count;
+    /// Rozmiar tablicy haszującej, potęga dwójki.
+    uint32_t capacity;
+    /// Liczba zajętych pozycji tablicy.
+    uint32_t size;
+    /// Zarezerwowane, zawsze 0.
+    uint32_t reserved[4];
+};
+
+/**
+  Pozycja tablicy haszującej.
+  */
+struct hint_entry
+{
+    /// Skrót wariantu słowa.
+    uint32_t hash;
+    /// Numer słowa lub HINT_INDEX_EMPTY dla wolnej pozycji.
+    uint32_t id;
+};
+
+/**
+  Numer słowa oznaczający wolną pozycję tablicy.
+  */
+#define HINT_INDEX_EMPTY UINT32_MAX
+
+/**
+  Struktura przechowująca indeks.
+  */
+struct hint_index
+{
+    /// Słowa według numerów; NULL oznacza wolny numer.
+    wchar_t **words;
+    /// Liczba użytych numerów słów.
+    uint32_t id_count;
+    /// Rozmiar tablicy słów.
+    uint32_t id_capacity;
+    /// Wolne numery słów.
+    uint32_t *free_ids;
+    /// Liczba wolnych numerów.
+    uint32_t free_count;
+    /// Liczba słów w indeksie.
+    uint32_t word_count;
+    /// Tablica haszująca z adresowaniem otwartym.
+    struct hint_entry *table;
+    /// Rozmiar tablicy haszującej, potęga dwójki.
+    uint32_t capacity;
+    /// Liczba zajętych pozycji tablicy.
+    uint32_t size;
+    /// Arena, z której pochodzą słowa.
+    struct arena arena;
+};
+
+/**
+  Tworzy pusty indeks.
+  Indeks należy zniszczyć za pomocą hint_index_done().
+  @return Nowy indeks lub NULL, jeśli zabrakło pamięci.
+  */
+struct hint_index * hint_index_new(void);
+
+/**
+  Destrukcja indeksu.
+  @param[in,out] index Indeks lub NULL.
+  */
+void hint_index_done(struct hint_index *index);
+
+/**
+  Dodaje słowo do indeksu. Słowa nie może jeszcze być w indeksie.
+  @param[in,out] index Indeks.
+  @param[in] word Słowo.
+  @return true jeśli się udało, false jeśli zabrakło pamięci.
+  */
+bool hint_index_add(struct hint_index *index, const wchar_t *word);
+
+/**
+  Usuwa słowo z indeksu, jeśli w nim jest.
+  @param[in,out] index Indeks.
+  @param[in] word Słowo.
+  @return Wartość logiczna czy słowo było w indeksie.
+  */
+bool hint_index_remove(struct hint_index *index, const wchar_t *word);
+
+/**
+  Sprawdza, czy słowo jest w indeksie.
+  @param[in] index Indeks.
+  @param[in] word Słowo.
+  @return Wartość logiczna czy `word` jest w indeksie.
+  */
+bool hint_index_contains(const struct hint_index *index, const wchar_t *word);
+
+/**
+  Dodaje do listy wszystkie słowa indeksu odległe od danego o co najwyżej
+  jedno wstawienie, usunięcie lub zamianę litery. Każde słowo dodawane
+  jest raz, w dowolnej kolejności.
+  @param[in] index Indeks.
+  @param[in] word Szukane słowo.
+  @param[in,out] list Lista podpowiedzi.
+  */
+void hint_index_lookup(const struct hint_index *index, const wchar_t *word,
+                       struct word_list *list);
+
+/**
+  Zapisuje indeks do strumienia.
+  @param[in] index Indeks.
+  @param[in,out] stream Strumień.
+  @return <0 jeśli operacja się nie powiedzie, 0 w p.p.
+  */
+int hint_index_write(const struct hint_index *index, FILE *stream);
+
+/**
+  Wczytuje indeks zapisany przez hint_index_write().
+  Indeks należy zniszczyć za pomocą hint_index_done().
+  @param[in,out] stream Strumień.
+  @return Indeks lub NULL, jeśli strumień nie zawiera poprawnego indeksu.
+  */
+struct hint_index * hint_index_read(FILE *stream);
+
+#endif /* __HINT_INDEX_H__ */
@@ -0,0 +1,395 @@
+/** @file
+  Implementacja dziennika zmian słownika.
+
+  @ingroup dictionary
+  @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+  @date 2015-08-02
+ */
+
+#include "journal.h"
+#include "utf8.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+  Najmniejszy rozmiar dziennika w bajtach, od którego opłaca się
+  go zagęszczać.
+  */
+#define JOURNAL_COMPACT_MIN (64 * 1024)
+
+/**
+  Struktura przechowująca dziennik.
+ */
+struct journal
+{
+	char *path; ///< Ścieżka pliku bazowego.
+	char *log_path; ///< Ścieżka dziennika.
+	char *pending; ///< Niezatwierdzone wiersze dziennika.
+	size_t pending_size; ///< Długość niezatwierdzonych wierszy.
+	size_t pending_capacity; ///< Rozmiar bufora niezatwierdzonych wierszy.
+	pid_t compactor; ///< Proces zagęszczający dziennik lub 0.
+	off_t compact_from; ///< Długość dziennika zawartego w zagęszczanym pliku.
+};
+
+/** @name Funkcje pomocnicze
+  @{
+ */
+
+/**
+ * Tworzy ścieżkę z doklejoną końcówką.
+ * @param[in] path Ścieżka.
+ * @param[in] suffix Końcówka.
+ * @return Nowa ścieżka lub NULL, jeśli zabrakło pamięci.
+ */
+static char * suffixed(const char *path, const char *suffix)
+{
+	size_t len = strlen(path);
+	char *result = malloc(len + strlen(suffix) + 1);
+	if (result == NULL)
+		return NULL;
+	memcpy(result, path, len);
+	strcpy(result + len, suffix);
+	return result;
+}
+
+/**
+ * Zapisuje słownik do pliku tymczasowego, czeka, aż trafi na dysk,
+ * i podmienia nim plik docelowy.
+ * @param[in] dict Słownik.
+ * @param[in] tmp Ścieżka pliku tymczasowego.
+ * @param[in] path Ścieżka pliku docelowego.
+ * @return <0 jeśli operacja się nie powiedzie, 0 w p.p.
+ */
+static int replace_file(const struct dictionary *dict, const char *tmp,
+						const char *path)
+{
+	FILE *f = fopen(tmp, "w");
+	if (f == NULL)
+		return -1;
+	int result = dictionary_save(dict, f);
+	if (fflush(f) || fsync(fileno(f)))
+		result = -1;
+	if (fclose(f) || result < 0 || rename(tmp, path))
+	{
+		unlink(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Zapisuje bufor w całości.
+ * @param[in] fd Deskryptor.
+ * @param[in] data Dane.
+ * @param[in] size Długość danych.
+ * @return <0 jeśli operacja się nie powiedzie, 0 w p.p.
+ */
+static int write_all(int fd, const char *data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t n = write(fd, data, size);
+		if (n < 0)
+			return -1;
+		data += n;
+		size -= n;
+	}
+	return 0;
+}
+
+/**
+ * Obcina urwany ostatni wiersz dziennika, żeby dopisywane wiersze
+ * nie zostały z nim sklejone.
+ * @param[in] fd Deskryptor dziennika otwartego do odczytu i zapisu.
+ * @return Długość dziennika lub -1, jeśli operacja się nie powiedzie.
+ */
+static off_t drop_torn_line(int fd)
+{
+	off_t size = lseek(fd, 0, SEEK_END);
+	off_t end = size;
+	char buffer[4096];
+	while (end > 0)
+	{
+		size_t n = end < (off_t) sizeof(buffer) ? (size_t) end
+			: sizeof(buffer);
+		if (pread(fd, buffer, n, end - n) != (ssize_t) n)
+			return -1;
+		for (; n > 0 && buffer[n - 1] != '\n'; n--)
+			end--;
+		if (n > 0)
+			break;
+	}
+	if (end < size && ftruncate(fd, end))
+		return -1;
+	return end;
+}
+
+/**
+ * Kończy zagęszczanie: jeśli proces potomny podmienił plik bazowy,
+ * usuwa z dziennika zmiany, które ten plik już zawiera.
+ * Jeśli to się nie uda, zostaje pełny dziennik, co jest bezpieczne.
+ * @param[in,out] journal Dziennik.
+ * @param[in] wait Czy czekać na zakończenie procesu potomnego.
+ */
+static void finish_compaction(struct journal *journal, bool wait)
+{
+	if (journal->compactor == 0)
+		return;
+	int status;
+	pid_t pid = waitpid(journal->compactor, &status, wait ? 0 : WNOHANG);
+	if (pid == 0)
+		return;
+	journal->compactor = 0;
+	if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		return;
+	/* Plik bazowy zawiera już początek dziennika; przepisujemy resztę. */
+	char *tmp = suffixed(journal->log_path, ".tmp");
+	int in = open(journal->log_path, O_RDONLY);
+	int out = tmp ? open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+	int result = in >= 0 && out >= 0
+		&& lseek(in, journal->compact_from, SEEK_SET) >= 0 ? 0 : -1;
+	char buffer[65536];
+	ssize_t n;
+	while (result == 0 && (n = read(in, buffer, sizeof(buffer))) != 0)
+		if (n < 0 || write_all(out, buffer, n))
+			result = -1;
+	if (out >= 0 && fsync(out))
+		result = -1;
+	if (out >= 0 && close(out))
+		result = -1;
+	if (in >= 0)
+		close(in);
+	if (result == 0 && rename(tmp, journal->log_path))
+		result = -1;
+	if (result < 0 && tmp)
+		unlink(tmp);
+	free(tmp);
+}
+
+/**
+ * Rozpoczyna zagęszczanie dziennika, jeśli urósł on ponad połowę
+ * pliku bazowego.
+ * @param[in,out] journal Dziennik bez niezatwierdzonych zmian.
+ * @param[in] dict Słownik w stanie odpowiadającym dziennikowi.
+ * @param[in] log_size Długość dziennika.
+ */
+static void start_compaction(struct journal *journal,
+							 const struct dictionary *dict, off_t log_size)
+{
+	struct stat base;
+	if (journal->compactor != 0 || log_size < JOURNAL_COMPACT_MIN
+		|| (stat(journal->path, &base) == 0 && log_size <= base.st_size / 2))
+		return;
+	char *tmp = suffixed(journal->path, ".new");
+	if (tmp == NULL)
+		return;
+	pid_t pid = fork();
+	if (pid == 0)
+		_exit(replace_file(dict, tmp, journal->path) < 0 ? 1 : 0);
+	free(tmp);
+	if (pid > 0)
+	{
+		journal->compactor = pid;
+		journal->compact_from = log_size;
+	}
+}
+
+/**
+ * Odtwarza jeden wiersz dziennika.
+ * @param[in,out] dict Słownik.
+ * @param[in] line Wiersz bez znaku końca wiersza.
+ * @param[in] len Długość wiersza.
+ * @param[in,out] word Bufor na co najmniej `len + 1` znaków.
+ * @return <0 jeśli wiersz jest niepoprawny lub nie udało się wstawić
+ * słowa, 0 w p.p.
+ */
+static int replay_line(struct dictionary *dict, const char *line, size_t len,
+					   wchar_t *word)
+{
+	if (len < 2 || (line[0] != '+' && line[0] != '-'))
+		return -1;
+	size_t n = 0;
+	for (size_t i = 1; i < len; n++)
+	{
+		size_t used = utf8_decode(line + i, len - i, &word[n]);
+		if (used == 0)
+			return -1;
+		i += used;
+	}
+	word[n] = L'\0';
+	if (line[0] == '+')
+		return dictionary_insert(dict, word) < 0 ? -1 : 0;
+	dictionary_delete(dict, word);
+	return 0;
+}
+
+/**@}*/
+/** @name Elementy interfejsu
+  @{
+ */
+
+struct journal * journal_new(const char *path)
+{
+	struct journal *journal = calloc(1, sizeof(struct journal));
+	if (journal == NULL)
+		return NULL;
+	journal->path = suffixed(path, "");
+	journal->log_path = suffixed(path, ".log");
+	if (journal->path == NULL || journal->log_path == NULL)
+	{
+		journal_done(journal);
+		return NULL;
+	}
+	return journal;
+}
+
+void journal_done(struct journal *journal)
+{
+	if (journal == NULL)
+		return;
+	finish_compaction(journal, true);
+	free(journal->path);
+	free(journal->log_path);
+	free(journal->pending);
+	free(journal);
+}
+
+const char * journal_path(const struct journal *journal)
+{
+	return journal->path;
+}
+
+int journal_record(struct journal *journal, bool insert, const wchar_t *word)
+{
+	size_t needed = journal->pending_size + (wcslen(word) + 1) * UTF8_MAX + 1;
+	if (needed > journal->pending_capacity)
+	{
+		size_t capacity = 2 * journal->pending_capacity;
+		if (capacity < needed)
+			capacity = needed + 4096;
+		char *pending = realloc(journal->pending, capacity);
+		if (pending == NULL)
+			return -1;
+		journal->pending = pending;
+		journal->pending_capacity = capacity;
+	}
+	char *out = journal->pending + journal->pending_size;
+	*out++ = insert ? '+' : '-';
+	for (; *word; word++)
+		out += utf8_encode(*word, out);
+	*out++ = '\n';
+	journal->pending_size = out - journal->pending;
+	return 0;
+}
+
+int journal_commit(struct journal *journal, const struct dictionary *dict)
+{
+	finish_compaction(journal, false);
+	int fd = open(journal->log_path, O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (fd < 0)
+		return -1;
+	int result = 0;
+	off_t log_size = drop_torn_line(fd);
+	if (log_size < 0
+		|| (journal->pending_size > 0
+			&& (write_all(fd, journal->pending, journal->pending_size)
+				|| fsync(fd))))
+		result = -1;
+	log_size += journal->pending_size;
+	if (close(fd))
+		result = -1;
+	if (result < 0)
+		return -1;
+	journal->pending_size = 0;
+	start_compaction(journal, dict, log_size);
+	return 0;
+}
+
+int journal_save(const struct dictionary *dict, const char *path)
+{
+	char *tmp = suffixed(path, ".tmp");
+	char *log_path = suffixed(path, ".log");
+	/* Dziennik usuwamy dopiero po podmianie pliku bazowego: odtworzony
+	   na nowym pliku nie zmienia stanu słownika. */
+	int result = tmp && log_path ? replace_file(dict, tmp, path) : -1;
+	if (result == 0 && unlink(log_path) && access(log_path, F_OK) == 0)
+		result = -1;
+	free(tmp);
+	free(log_path);
+	return result;
+}
+
+long journal_replay(struct dictionary *dict, const char *path)
+{
+	char *log_path = suffixed(path, ".log");
+	if (log_path == NULL)
+		return -1;
+	FILE *f = fopen(log_path, "r");
+	free(log_path);
+	if (f == NULL)
+		return 0;
+	char *data = NULL;
+	size_t size = 0;
+	size_t capacity = 0;
+	size_t n;
+	do
+	{
+		if (size == capacity)
+		{
+			capacity = 2 * capacity + 65536;
+			char *grown = realloc(data, capacity);
+			if (grown == NULL)
+			{
+				free(data);
+				fclose(f);
+				return -1;
+			}
+			data = grown;
+		}
+		n = fread(data + size, 1, capacity - size, f);
+		size += n;
+	} while (n > 0);
+	bool failed = ferror(f);
+	fclose(f);
+	wchar_t *word = malloc((size + 1) * sizeof(wchar_t));
+	if (word == NULL)
+		failed = true;
+	long count = 0;
+	const char *line = data;
+	const char *end = data + size;
+	const char *eol;
+	/* Wiersz bez znaku końca wiersza jest urwanym ostatnim zapisem. */
+	while (!failed && (eol = memchr(line, '\n', end - line)))
+	{
+		if (replay_line(dict, line, eol - line, word) < 0)
+			failed = true;
+		count++;
+		line = eol + 1;
+	}
+	free(word);
+	free(data);
+	return failed ? -1 : count;
+}
+
+struct dictionary * journal_load(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		return NULL;
+	struct dictionary *dict = dictionary_load(f);
+	fclose(f);
+	if (dict && journal_replay(dict, path) < 0)
+	{
+		dictionary_done(dict);
+		dict = NULL;
+	}
+	return dict;
+}
+
+/**@}*/
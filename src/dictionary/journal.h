@@ -0,0 +1,104 @@
+/** @file
+    Interfejs dziennika zmian słownika.
+
+    Słownik zapisany w pliku `path` (plik bazowy) może mieć obok dziennik
+    `path.log`, do którego dopisywane są kolejne wstawienia i usunięcia
+    słów, po jednym w wierszu: `+słowo` lub `-słowo` w UTF-8. Zapis
+    zmian kosztuje więc tyle, ile same zmiany, a nie cały słownik.
+    Stan słownika to plik bazowy z odtworzonym na nim dziennikiem.
+
+    Gdy dziennik urośnie, jest zagęszczany w tle: proces potomny zapisuje
+    nowy plik bazowy ze stanu słownika, a po jego zakończeniu z dziennika
+    usuwane są zmiany, które już zawiera. Odtworzenie dziennika na pliku
+    bazowym, który zawiera już część jego zmian, daje ten sam stan,
+    więc przerwanie w dowolnej chwili niczego nie psuje.
+
+    @ingroup dictionary
+    @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+    @date 2015-08-02
+ */
+
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+#include "dictionary.h"
+#include <stdbool.h>
+#include <wchar.h>
+
+/**
+  Dziennik zmian słownika.
+  */
+struct journal;
+
+/**
+  Tworzy dziennik pliku bazowego. Plik dziennika tworzony jest dopiero
+  przy pierwszym zatwierdzeniu zmian.
+  Dziennik należy zniszczyć za pomocą journal_done().
+  @param[in] path Ścieżka pliku bazowego.
+  @return Nowy dziennik lub NULL, jeśli zabrakło pamięci.
+  */
+struct journal * journal_new(const char *path);
+
+/**
+  Destrukcja dziennika. Czeka na zakończenie zagęszczania;
+  niezatwierdzone zmiany są porzucane.
+  @param[in,out] journal Dziennik lub NULL.
+  */
+void journal_done(struct journal *journal);
+
+/**
+  Zwraca ścieżkę pliku bazowego dziennika.
+  @param[in] journal Dziennik.
+  @return Ścieżka.
+  */
+const char * journal_path(const struct journal *journal);
+
+/**
+  Zapamiętuje zmianę słownika do zatwierdzenia.
+  @param[in,out] journal Dziennik.
+  @param[in] insert true dla wstawienia, false dla usunięcia słowa.
+  @param[in] word Słowo.
+  @return <0 jeśli zabrakło pamięci, 0 w p.p.
+  */
+int journal_record(struct journal *journal, bool insert, const wchar_t *word);
+
+/**
+  Dopisuje zapamiętane zmiany do dziennika i czeka, aż trafią na dysk.
+  Jeśli dziennik urósł ponad połowę pliku bazowego, rozpoczyna jego
+  zagęszczanie w tle.
+  @param[in,out] journal Dziennik.
+  @param[in] dict Słownik, którego stan odpowiada plikowi bazowemu
+  z odtworzonym dziennikiem po zatwierdzeniu.
+  @return <0 jeśli operacja się nie powiedzie, 0 w p.p.
+  */
+int journal_commit(struct journal *journal, const struct dictionary *dict);
+
+/**
+  Zapisuje cały słownik jako nowy plik bazowy i usuwa jego dziennik.
+  Plik zapisywany jest obok i podmieniany, więc po przerwaniu zostaje
+  stary lub nowy plik.
+  @param[in] dict Słownik.
+  @param[in] path Ścieżka pliku bazowego.
+  @return <0 jeśli operacja się nie powiedzie, 0 w p.p.
+  */
+int journal_save(const struct dictionary *dict, const char *path);
+
+/**
+  Odtwarza na słowniku dziennik pliku bazowego `path`, jeśli istnieje.
+  Urwany ostatni wiersz, np. po awarii w trakcie zapisu, jest pomijany.
+  @param[in,out] dict Słownik wczytany z pliku bazowego.
+  @param[in] path Ścieżka pliku bazowego.
+  @return Liczba odtworzonych zmian lub <0, jeśli dziennika nie udało
+  się przeczytać.
+  */
+long journal_replay(struct dictionary *dict, const char *path);
+
+/**
+  Wczytuje słownik z pliku bazowego i odtwarza na nim dziennik.
+  Słownik ten należy zniszczyć za pomocą dictionary_done().
+  @param[in] path Ścieżka pliku bazowego.
+  @return Nowy słownik lub NULL, jeśli operacja się nie powiedzie.
+  */
+struct dictionary * journal_load(const char *path);
+
+#endif /* __JOURNAL_H__ */
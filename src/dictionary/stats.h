@@ -0,0 +1,65 @@
+/** @file
+    Liczniki pracy biblioteki dictionary w bieżącym wątku.
+
+    Liczniki są wkompilowane tylko wtedy, gdy zdefiniowane jest makro
+    DICTIONARY_STATS (opcja CMake -DSTATS=ON). W p.p. makra z tego pliku
+    rozwijają się do pustych instrukcji i nie kosztują nic.
+    Każdy wątek ma własne liczniki, więc nie trzeba ich synchronizować.
+    Zegar stats_clock() jest dostępny zawsze, bo korzysta z niego też
+    budżet czasu dictionary_hints_ex().
+
+    @ingroup dictionary
+    @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+    @date 2015-08-16
+ */
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include "dictionary.h"
+#include <time.h>
+
+/**
+  Zwraca bieżący czas monotoniczny.
+  @return Czas w nanosekundach.
+  */
+static inline
+uint64_t stats_clock(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+#ifdef DICTIONARY_STATS
+
+/**
+  Liczniki bieżącego wątku.
+  */
+extern __thread struct dictionary_stats dictionary_thread_stats;
+
+/**
+  Zwiększa licznik `field` o `n`.
+  */
+#define STATS_ADD(field, n) (dictionary_thread_stats.field += (n))
+
+/**
+  Zapamiętuje w nowej zmiennej `var` początek mierzonej fazy.
+  */
+#define STATS_START(var) uint64_t var = stats_clock()
+
+/**
+  Dolicza do licznika `field` czas od początku fazy `since`.
+  */
+#define STATS_TIME(field, since) \
+    (dictionary_thread_stats.field += stats_clock() - (since))
+
+#else
+
+#define STATS_ADD(field, n) ((void) 0)
+#define STATS_START(var) ((void) 0)
+#define STATS_TIME(field, since) ((void) 0)
+
+#endif /* DICTIONARY_STATS */
+
+#endif /* __STATS_H__ */
@@ -0,0 +1,171 @@
+/** @file
+  Implementacja tablicy symboli słownika.
+
+  @ingroup dictionary
+  @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+  @date 2015-07-19
+ */
+
+#include "symbol_table.h"
+#include <locale.h>
+#include <string.h>
+
+/** @name Funkcje pomocnicze
+  @{
+ */
+
+/**
+ * Wyznacza napis o numerze 'index' w ciągu wszystkich napisów z jednej
+ * lub dwóch liter tablicy, uporządkowanym według pozycji liter:
+ * a, aa, ab, ..., b, ba, bb, ...
+ * @param[in] table Tablica symboli.
+ * @param[in] index Numer napisu.
+ * @param[out] word Bufor na 3 znaki.
+ */
+static void chain_word(const struct symbol_table *table, size_t index,
+					   wchar_t *word)
+{
+	size_t width = table->size;
+	size_t row = index / width, column = index % width;
+	word[0] = table->letters[table->by_rank[row]];
+	word[1] = column ? table->letters[table->by_rank[column - 1]] : L'\0';
+	word[2] = L'\0';
+}
+
+/**
+ * Sprawdza, czy napis o numerze 'index' i jego sąsiedzi w ciągu napisów
+ * z chain_word() są uporządkowani rosnąco według wcscoll().
+ * @param[in] table Tablica symboli.
+ * @param[in] index Numer napisu.
+ * @return Wartość logiczna.
+ */
+static bool chain_fits(const struct symbol_table *table, size_t index)
+{
+	size_t length = (table->size - 1) * table->size;
+	wchar_t word[3], other[3];
+	chain_word(table, index, word);
+	if (index > 0)
+	{
+		chain_word(table, index - 1, other);
+		if (wcscoll(other, word) >= 0)
+			return false;
+	}
+	if (index + 1 < length)
+	{
+		chain_word(table, index + 1, other);
+		if (wcscoll(word, other) >= 0)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Wstawia literę o kodzie 'code' do porządku alfabetycznego pierwszych
+ * 'count' liter.
+ * @param[in,out] table Tablica symboli.
+ * @param[in] count Liczba uporządkowanych liter.
+ * @param[in] code Kod wstawianej litery.
+ * @return Pozycja litery w porządku, od 0.
+ */
+static unsigned place(struct symbol_table *table, unsigned count,
+					  uint8_t code)
+{
+	wchar_t letter[2] = { table->letters[code], L'\0' };
+	wchar_t other[2] = { L'\0', L'\0' };
+	unsigned l = 0, r = count;
+	while (l < r)
+	{
+		unsigned s = (l + r) / 2;
+		other[0] = table->letters[table->by_rank[s]];
+		if (wcscoll(other, letter) <= 0)
+			l = s + 1;
+		else
+			r = s;
+	}
+	memmove(table->by_rank + l + 1, table->by_rank + l, count - l);
+	table->by_rank[l] = code;
+	for (unsigned i = 0; i <= count; i++)
+		table->rank[table->by_rank[i]] = i + 1;
+	return l;
+}
+
+/**
+ * Wyznacza od nowa porządek alfabetyczny liter według bieżącego locale
+ * i sprawdza cały ciąg napisów z chain_word().
+ * @param[in,out] table Tablica symboli.
+ */
+static void collate(struct symbol_table *table)
+{
+	const char *locale = setlocale(LC_COLLATE, NULL);
+	table->collated = locale != NULL && strlen(locale) < SYMBOL_LOCALE;
+	strcpy(table->locale, table->collated ? locale : "");
+	for (unsigned code = 1; code < table->size; code++)
+		place(table, code - 1, code);
+	size_t length = (table->size - 1) * table->size;
+	/* Sprawdzenie co drugiego napisu obejmuje wszystkie pary sąsiadów. */
+	for (size_t i = 0; table->collated && i < length; i += 2)
+		table->collated = chain_fits(table, i);
+}
+
+/**@}*/
+/** @name Elementy interfejsu
+  @{
+ */
+
+void symbol_table_init(struct symbol_table *table, wchar_t marker)
+{
+	table->size = 1;
+	table->letters[0] = marker;
+	memset(table->direct, 0, sizeof(table->direct));
+	table->rank[0] = 0;
+	collate(table);
+}
+
+bool symbol_table_collated(const struct symbol_table *table)
+{
+	const char *locale = setlocale(LC_COLLATE, NULL);
+	return table->collated && locale != NULL
+		&& strcmp(locale, table->locale) == 0;
+}
+
+int symbol_table_add(struct symbol_table *table, wchar_t letter,
+					 uint8_t *code)
+{
+	if (symbol_table_find(table, letter, code))
+		return 0;
+	if (table->size == SYMBOL_LIMIT)
+		return -1;
+	/* Dla małych liter symbol_table_find() nie wyznacza pozycji. */
+	unsigned pos = 1;
+	while (pos < table->size && table->letters[pos] < letter)
+		pos++;
+	memmove(table->letters + pos + 1, table->letters + pos,
+			(table->size - pos) * sizeof(wchar_t));
+	table->letters[pos] = letter;
+	table->size++;
+	for (unsigned i = pos; i < table->size; i++)
+		if (table->letters[i] >= 0 && table->letters[i] < SYMBOL_DIRECT)
+			table->direct[table->letters[i]] = i;
+	*code = pos;
+	unsigned count = table->size - 2;
+	for (unsigned i = 0; i < count; i++)
+		if (table->by_rank[i] >= pos)
+			table->by_rank[i]++;
+	const char *locale = setlocale(LC_COLLATE, NULL);
+	if (locale == NULL || strcmp(locale, table->locale) != 0)
+	{
+		collate(table);
+		return 1;
+	}
+	/* Nowe sąsiedztwa w ciągu napisów mają tylko napisy z nową literą:
+	   cały jej wiersz i po jednym napisie w każdym wierszu. */
+	unsigned r = place(table, count, pos);
+	size_t width = table->size;
+	for (size_t i = 0; table->collated && i < width; i++)
+		table->collated = chain_fits(table, r * width + i);
+	for (size_t row = 0; table->collated && row < width - 1; row++)
+		table->collated = chain_fits(table, row * width + r + 1);
+	return 1;
+}
+
+/**@}*/
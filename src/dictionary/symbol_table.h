@@ -0,0 +1,152 @@
+/** @file
+    Interfejs tablicy symboli słownika.
+
+    Tablica przypisuje literom występującym w słowniku gęste, jednobajtowe
+    kody. Kod 0 należy do markera końca słowa, a kody liter rosną tak jak
+    same litery, więc porównywanie kodów daje ten sam porządek co
+    porównywanie znaków. Kody liter o małych wartościach (w tym wszystkich
+    polskich) odczytywane są z tablicy bezpośredniej, a pozostałych
+    wyszukiwane binarnie.
+
+    Tablica zna też porządek alfabetyczny liter według kategorii
+    LC_COLLATE bieżącego locale, uaktualniany przy dodaniu litery. Jeśli
+    porównywanie słów litera po literze według tego porządku daje ten sam
+    wynik co wcscoll(), słowa można porządkować bez wywoływania wcscoll().
+
+    @ingroup dictionary
+    @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+    @date 2015-07-19
+ */
+
+#ifndef __SYMBOL_TABLE_H__
+#define __SYMBOL_TABLE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wchar.h>
+
+/**
+  Największa liczba kodów, łącznie z kodem markera.
+  */
+#define SYMBOL_LIMIT 256
+
+/**
+  Litery mniejsze od tej wartości mają kod w tablicy bezpośredniej.
+  Obejmuje ASCII, Latin-1 i Latin Extended-A.
+  */
+#define SYMBOL_DIRECT 0x180
+
+/**
+  Rozmiar bufora na nazwę locale, według którego wyznaczono porządek liter.
+  */
+#define SYMBOL_LOCALE 64
+
+/**
+  Struktura przechowująca tablicę symboli.
+  */
+struct symbol_table
+{
+    /// Liczba przypisanych kodów, łącznie z kodem markera.
+    unsigned size;
+    /// Litery według kodów; pod kodem 0 jest marker.
+    wchar_t letters[SYMBOL_LIMIT];
+    /// Kandydaci na kod dla małych liter, do sprawdzenia w `letters`.
+    uint8_t direct[SYMBOL_DIRECT];
+    /// Kody liter w porządku alfabetycznym locale; marker jest pominięty.
+    uint8_t by_rank[SYMBOL_LIMIT];
+    /// Pozycje liter w porządku alfabetycznym locale, od 1, według kodów.
+    uint8_t rank[SYMBOL_LIMIT];
+    /// Czy porządek liter wyznacza porządek słów zgodny z wcscoll().
+    bool collated;
+    /// Nazwa kategorii LC_COLLATE locale, według którego wyznaczono porządek.
+    char locale[SYMBOL_LOCALE];
+};
+
+/**
+  Inicjuje tablicę zawierającą tylko marker.
+  @param[out] table Tablica symboli.
+  @param[in] marker Znak markera końca słowa, o kodzie 0.
+  */
+void symbol_table_init(struct symbol_table *table, wchar_t marker);
+
+/**
+  Szuka kodu litery.
+  @param[in] table Tablica symboli.
+  @param[in] letter Litera.
+  @param[out] code Kod litery.
+  @return Wartość logiczna czy litera jest w tablicy.
+  */
+static inline
+bool symbol_table_find(const struct symbol_table *table, wchar_t letter,
+                       uint8_t *code)
+{
+    if (letter >= 0 && letter < SYMBOL_DIRECT)
+    {
+        *code = table->direct[letter];
+        return table->letters[*code] == letter;
+    }
+    unsigned l = 1, r = table->size;
+    while (l < r)
+    {
+        unsigned s = (l + r) / 2;
+        if (table->letters[s] < letter)
+            l = s + 1;
+        else
+            r = s;
+    }
+    *code = l;
+    return l < table->size && table->letters[l] == letter;
+}
+
+/**
+  Zwraca literę o podanym kodzie.
+  @param[in] table Tablica symboli.
+  @param[in] code Przypisany kod.
+  @return Litera.
+  */
+static inline
+wchar_t symbol_table_letter(const struct symbol_table *table, uint8_t code)
+{
+    return table->letters[code];
+}
+
+/**
+  Zwraca pozycję litery w porządku alfabetycznym locale.
+  @param[in] table Tablica symboli.
+  @param[in] code Kod litery, różny od kodu markera.
+  @return Pozycja, od 1.
+  */
+static inline
+uint8_t symbol_table_rank(const struct symbol_table *table, uint8_t code)
+{
+    return table->rank[code];
+}
+
+/**
+  Sprawdza, czy porządek słów z liter tablicy wyznaczony przez
+  symbol_table_rank() jest zgodny z wcscoll() w bieżącym locale.
+  Słowo jest wtedy mniejsze od każdego swojego przedłużenia, a słowa
+  różniące się pierwszy raz na tej samej pozycji porównują się tak jak
+  ich litery na tej pozycji.
+  @param[in] table Tablica symboli.
+  @return Wartość logiczna.
+  */
+bool symbol_table_collated(const struct symbol_table *table);
+
+/**
+  Dodaje literę do tablicy, jeśli jeszcze jej w niej nie ma.
+  Nowa litera dostaje kod zgodny z porządkiem liter, więc kody wszystkich
+  większych liter zwiększają się o jeden; użytkownik tablicy musi wtedy
+  przenumerować przechowywane kody od `*code` wzwyż.
+  Porządek alfabetyczny liter jest uzupełniany o nową literę w czasie
+  liniowym względem liczby liter, a po zmianie locale wyznaczany od nowa.
+  @param[in,out] table Tablica symboli.
+  @param[in] letter Litera.
+  @param[out] code Kod litery.
+  @return 0 jeśli litera już była w tablicy, 1 jeśli została dodana,
+  <0 jeśli tablica jest pełna.
+  */
+int symbol_table_add(struct symbol_table *table, wchar_t letter,
+                     uint8_t *code);
+
+#endif /* __SYMBOL_TABLE_H__ */
@@ -0,0 +1,119 @@
+/** @file
+  Implementacja buforowanego czytania i pisania tekstu.
+
+  @ingroup dictionary
+  @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+  @date 2015-06-21
+ */
+
+#include "text_io.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** @name Elementy interfejsu
+  @{
+ */
+
+bool text_reader_init(struct text_reader *reader, FILE *stream)
+{
+	reader->stream = stream;
+	reader->buffer = malloc(TEXT_IO_BUFFER_SIZE);
+	reader->pos = reader->end = 0;
+	reader->eof = false;
+	return reader->buffer != NULL;
+}
+
+bool text_reader_done(struct text_reader *reader)
+{
+	size_t unread = reader->end - reader->pos;
+	if (unread > 0)
+		fseek(reader->stream, -(long) unread, SEEK_CUR);
+	free(reader->buffer);
+	reader->buffer = NULL;
+	return !ferror(reader->stream);
+}
+
+bool text_reader_fill(struct text_reader *reader, size_t need)
+{
+	size_t left = reader->end - reader->pos;
+	if (left >= need)
+		return true;
+	if (reader->eof)
+		return false;
+	memmove(reader->buffer, reader->buffer + reader->pos, left);
+	reader->pos = 0;
+	reader->end = left;
+	while (reader->end < need && !reader->eof)
+	{
+		size_t n = fread(reader->buffer + reader->end, 1,
+						 TEXT_IO_BUFFER_SIZE - reader->end, reader->stream);
+		reader->end += n;
+		if (n == 0)
+			reader->eof = true;
+	}
+	return reader->end >= need;
+}
+
+int text_read_word(struct text_reader *reader, wchar_t **word,
+				   size_t *capacity)
+{
+	if (!text_skip_space(reader))
+		return 0;
+	size_t len = 0;
+	for (;;)
+	{
+		if (len + 1 >= *capacity)
+		{
+			size_t new_capacity = *capacity ? 2 * *capacity : 64;
+			wchar_t *new_word =
+				realloc(*word, new_capacity * sizeof(wchar_t));
+			if (new_word == NULL)
+				return -1;
+			*word = new_word;
+			*capacity = new_capacity;
+		}
+		if (reader->end - reader->pos < UTF8_MAX)
+			text_reader_fill(reader, UTF8_MAX);
+		if (reader->pos == reader->end)
+			break;
+		char c = reader->buffer[reader->pos];
+		if (c == ' ' || (c >= '\t' && c <= '\r'))
+			break;
+		size_t n = utf8_decode(reader->buffer + reader->pos,
+							   reader->end - reader->pos, *word + len);
+		if (n == 0)
+			return -1;
+		reader->pos += n;
+		len++;
+	}
+	(*word)[len] = L'\0';
+	return 1;
+}
+
+bool text_writer_init(struct text_writer *writer, FILE *stream)
+{
+	writer->stream = stream;
+	writer->buffer = malloc(TEXT_IO_BUFFER_SIZE);
+	writer->len = 0;
+	writer->error = writer->buffer == NULL;
+	return !writer->error;
+}
+
+void text_writer_flush(struct text_writer *writer)
+{
+	if (writer->len > 0
+		&& fwrite(writer->buffer, 1, writer->len, writer->stream) != writer->len)
+		writer->error = true;
+	writer->len = 0;
+}
+
+int text_writer_done(struct text_writer *writer)
+{
+	if (writer->buffer != NULL)
+		text_writer_flush(writer);
+	free(writer->buffer);
+	writer->buffer = NULL;
+	return writer->error ? -1 : 0;
+}
+
+/**@}*/
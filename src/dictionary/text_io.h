@@ -0,0 +1,230 @@
+/** @file
+    Interfejs buforowanego czytania i pisania tekstu.
+
+    Czytnik i pisarz operują na dużych blokach pamięci zamiast na
+    pojedynczych wywołaniach funkcji stdio, a znaki i liczby kodują
+    samodzielnie (UTF-8 i zapis dziesiętny).
+
+    @ingroup dictionary
+    @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+    @date 2015-06-21
+ */
+
+#ifndef __TEXT_IO_H__
+#define __TEXT_IO_H__
+
+#include "utf8.h"
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <wchar.h>
+
+/**
+  Rozmiar bufora czytnika i pisarza w bajtach.
+  */
+#define TEXT_IO_BUFFER_SIZE (256 * 1024)
+
+/**
+  Struktura buforowanego czytnika.
+  */
+struct text_reader
+{
+    /// Strumień źródłowy.
+    FILE *stream;
+    /// Bufor.
+    char *buffer;
+    /// Pozycja pierwszego nieprzeczytanego bajtu.
+    size_t pos;
+    /// Koniec danych w buforze.
+    size_t end;
+    /// Czy strumień się skończył.
+    bool eof;
+};
+
+/**
+  Struktura buforowanego pisarza.
+  */
+struct text_writer
+{
+    /// Strumień docelowy.
+    FILE *stream;
+    /// Bufor.
+    char *buffer;
+    /// Liczba bajtów w buforze.
+    size_t len;
+    /// Czy wystąpił błąd zapisu.
+    bool error;
+};
+
+/**
+  Inicjuje czytnik.
+  @param[out] reader Czytnik.
+  @param[in,out] stream Strumień źródłowy.
+  @return true jeśli się udało, false jeśli zabrakło pamięci.
+  */
+bool text_reader_init(struct text_reader *reader, FILE *stream);
+
+/**
+  Kończy czytanie.
+  Jeśli strumień na to pozwala, cofa go za ostatni przeczytany bajt,
+  tak aby dane za przeczytanym fragmentem pozostały w strumieniu.
+  @param[in,out] reader Czytnik.
+  @return true jeśli nie wystąpił błąd odczytu, false w p.p.
+  */
+bool text_reader_done(struct text_reader *reader);
+
+/**
+  Dopełnia bufor czytnika.
+  @param[in,out] reader Czytnik.
+  @param[in] need Potrzebna liczba bajtów, nie większa niż UTF8_MAX.
+  @return Wartość logiczna czy w buforze jest co najmniej `need` bajtów.
+  */
+bool text_reader_fill(struct text_reader *reader, size_t need);
+
+/**
+  Pomija białe znaki.
+  @param[in,out] reader Czytnik.
+  @return Wartość logiczna czy po białych znakach są jeszcze dane.
+  */
+static inline
+bool text_skip_space(struct text_reader *reader)
+{
+    for (;;)
+    {
+        if (reader->pos == reader->end && !text_reader_fill(reader, 1))
+            return false;
+        char c = reader->buffer[reader->pos];
+        if (c != ' ' && (c < '\t' || c > '\r'))
+            return true;
+        reader->pos++;
+    }
+}
+
+/**
+  Czyta jeden znak UTF-8, pomijając poprzedzające go białe znaki.
+  @param[in,out] reader Czytnik.
+  @param[out] c Przeczytany znak.
+  @return true jeśli się udało, false przy końcu danych lub błędzie kodowania.
+  */
+static inline
+bool text_read_char(struct text_reader *reader, wchar_t *c)
+{
+    if (!text_skip_space(reader))
+        return false;
+    if (reader->end - reader->pos < UTF8_MAX)
+        text_reader_fill(reader, UTF8_MAX);
+    size_t n = utf8_decode(reader->buffer + reader->pos,
+                           reader->end - reader->pos, c);
+    reader->pos += n;
+    return n > 0;
+}
+
+/**
+  Czyta nieujemną liczbę całkowitą zapisaną dziesiętnie, pomijając
+  poprzedzające ją białe znaki.
+  @param[in,out] reader Czytnik.
+  @param[out] value Przeczytana liczba.
+  @return true jeśli się udało, false w p.p.
+  */
+static inline
+bool text_read_int(struct text_reader *reader, int *value)
+{
+    if (!text_skip_space(reader))
+        return false;
+    bool digits = false;
+    int result = 0;
+    for (;;)
+    {
+        if (reader->pos == reader->end && !text_reader_fill(reader, 1))
+            break;
+        unsigned d = (unsigned char) reader->buffer[reader->pos] - '0';
+        if (d > 9)
+            break;
+        if (result > (INT_MAX - (int) d) / 10)
+            return false;
+        result = result * 10 + d;
+        digits = true;
+        reader->pos++;
+    }
+    *value = result;
+    return digits;
+}
+
+/**
+  Czyta słowo, czyli ciąg znaków bez białych znaków, pomijając
+  poprzedzające je białe znaki.
+  @param[in,out] reader Czytnik.
+  @param[in,out] word Bufor na słowo, powiększany w razie potrzeby
+  (na początku może być NULL); należy go zwolnić przez free().
+  @param[in,out] capacity Rozmiar bufora w znakach.
+  @return 1 jeśli przeczytano słowo, 0 przy końcu danych,
+  <0 przy błędzie kodowania lub braku pamięci.
+  */
+int text_read_word(struct text_reader *reader, wchar_t **word,
+                   size_t *capacity);
+
+/**
+  Inicjuje pisarza.
+  @param[out] writer Pisarz.
+  @param[in,out] stream Strumień docelowy.
+  @return true jeśli się udało, false jeśli zabrakło pamięci.
+  */
+bool text_writer_init(struct text_writer *writer, FILE *stream);
+
+/**
+  Zapisuje zawartość bufora do strumienia.
+  @param[in,out] writer Pisarz.
+  */
+void text_writer_flush(struct text_writer *writer);
+
+/**
+  Kończy pisanie, zapisując resztę bufora.
+  @param[in,out] writer Pisarz.
+  @return <0 jeśli którykolwiek zapis się nie powiódł, 0 w p.p.
+  */
+int text_writer_done(struct text_writer *writer);
+
+/**
+  Zapewnia miejsce w buforze pisarza na znak lub liczbę.
+  @param[in,out] writer Pisarz.
+  */
+static inline
+void text_writer_reserve(struct text_writer *writer)
+{
+    if (writer->len + 16 > TEXT_IO_BUFFER_SIZE)
+        text_writer_flush(writer);
+}
+
+/**
+  Zapisuje znak w UTF-8.
+  @param[in,out] writer Pisarz.
+  @param[in] c Znak.
+  */
+static inline
+void text_write_char(struct text_writer *writer, wchar_t c)
+{
+    text_writer_reserve(writer);
+    writer->len += utf8_encode(c, writer->buffer + writer->len);
+}
+
+/**
+  Zapisuje nieujemną liczbę całkowitą dziesiętnie.
+  @param[in,out] writer Pisarz.
+  @param[in] value Liczba.
+  */
+static inline
+void text_write_int(struct text_writer *writer, unsigned value)
+{
+    char digits[10];
+    int n = 0;
+    text_writer_reserve(writer);
+    do
+    {
+        digits[n++] = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (n)
+        writer->buffer[writer->len++] = digits[--n];
+}
+
+#endif /* __TEXT_IO_H__ */
@@ -0,0 +1,108 @@
+/** @file
+    Kodowanie i dekodowanie znaków UTF-8.
+
+    Funkcje nie zależą od ustawień locale, dzięki czemu pliki słownika
+    i teksty wejściowe czytane są tak samo niezależnie od środowiska.
+
+    @ingroup dictionary
+    @author Artur Myszkowski <am347189@students.mimuw.edu.pl>
+    @date 2015-06-21
+ */
+
+#ifndef __UTF8_H__
+#define __UTF8_H__
+
+#include <stddef.h>
+#include <wchar.h>
+
+/**
+  Maksymalna liczba bajtów jednego znaku w UTF-8.
+  */
+#define UTF8_MAX 4
+
+/**
+  Koduje znak w UTF-8.
+  @param[in] c Znak.
+  @param[out] out Bufor na co najmniej UTF8_MAX bajtów.
+  @return Liczba zapisanych bajtów.
+  */
+static inline
+size_t utf8_encode(wchar_t c, char *out)
+{
+    unsigned long u = (unsigned long) c;
+    if (u < 0x80)
+    {
+        out[0] = (char) u;
+        return 1;
+    }
+    if (u < 0x800)
+    {
+        out[0] = (char) (0xc0 | (u >> 6));
+        out[1] = (char) (0x80 | (u & 0x3f));
+        return 2;
+    }
+    if (u < 0x10000)
+    {
+        out[0] = (char) (0xe0 | (u >> 12));
+        out[1] = (char) (0x80 | ((u >> 6) & 0x3f));
+        out[2] = (char) (0x80 | (u & 0x3f));
+        return 3;
+    }
+    out[0] = (char) (0xf0 | ((u >> 18) & 0x07));
+    out[1] = (char) (0x80 | ((u >> 12) & 0x3f));
+    out[2] = (char) (0x80 | ((u >> 6) & 0x3f));
+    out[3] = (char) (0x80 | (u & 0x3f));
+    return 4;
+}
+
+/**
+  Dekoduje jeden znak UTF-8.
+  @param[in] in Bajty wejściowe.
+  @param[in] len Liczba dostępnych bajtów.
+  @param[out] c Zdekodowany znak.
+  @return Liczba przeczytanych bajtów lub 0, jeśli sekwencja jest
+  niepoprawna albo urwana.
+  */
+static inline
+size_t utf8_decode(const char *in, size_t len, wchar_t *c)
+{
+    const unsigned char *s = (const unsigned char *) in;
+    if (len == 0)
+        return 0;
+    if (s[0] < 0x80)
+    {
+        *c = s[0];
+        return 1;
+    }
+    size_t n;
+    unsigned long u;
+    if ((s[0] & 0xe0) == 0xc0)
+    {
+        n = 2;
+        u = s[0] & 0x1f;
+    }
+    else if ((s[0] & 0xf0) == 0xe0)
+    {
+        n = 3;
+        u = s[0] & 0x0f;
+    }
+    else if ((s[0] & 0xf8) == 0xf0)
+    {
+        n = 4;
+        u = s[0] & 0x07;
+    }
+    else
+        return 0;
+    if (len < n)
+        return 0;
+    for (size_t i = 1; i < n; i++)
+    {
+        if ((s[i] & 0xc0) != 0x80)
+            return 0;
+        u = (u << 6) | (s[i] & 0x3f);
+    }
+    *c = (wchar_t) u;
+    return n;
+}
+
+#endif /* __UTF8_H__ */
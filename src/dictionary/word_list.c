@@ -7,42 +7,224 @@
   @date 2015-05-10
  */
 
+#define _GNU_SOURCE
+
 #include "word_list.h"
+#include "stats.h"
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+/**
+  Kawałek puli napisów. Kawałki nie są przenoszone, więc wskaźniki
+  na słowa pozostają ważne do wyczyszczenia listy.
+  */
+struct word_pool
+{
+	struct word_pool *prev; ///< Poprzednio przydzielony kawałek.
+	size_t size; ///< Liczba znaków kawałka.
+	wchar_t text[]; ///< Znaki słów.
+};
+
+/** @name Funkcje pomocnicze
+   @{
+ */
+
+/**
+ * Liczy skrót słowa (FNV-1a).
+ * @param[in] word Słowo.
+ * @return Skrót.
+ */
+static size_t hash(const wchar_t *word)
+{
+	uint32_t h = 2166136261u;
+	for (; *word; word++)
+	{
+		h ^= (uint32_t) *word;
+		h *= 16777619u;
+	}
+	return h ^ (h >> 16);
+}
+
+/**
+ * Zwraca miejsce słowa w zbiorze haszującym: pozycję, na której słowo
+ * jest, albo pierwszą wolną pozycję, na której powinno być.
+ * @param[in] list Lista słów ze zbiorem haszującym.
+ * @param[in] word Słowo.
+ * @return Pozycja w zbiorze.
+ */
+static size_t set_slot(const struct word_list *list, const wchar_t *word)
+{
+	size_t mask = list->set_size - 1;
+	size_t slot = hash(word) & mask;
+	while (list->set[slot] != NULL && wcscmp(list->set[slot], word) != 0)
+		slot = (slot + 1) & mask;
+	return slot;
+}
+
+/**
+ * Przebudowuje zbiór haszujący tak, żeby zmieścił wszystkie słowa listy
+ * i jeszcze jedno, wypełniając go co najwyżej w połowie.
+ * @param[in,out] list Lista słów.
+ * @return 1 jeśli się udało, 0 jeśli zabrakło pamięci.
+ */
+static int set_reserve(struct word_list *list)
+{
+	if (2 * (list->size + 1) <= list->set_size)
+		return 1;
+	size_t size = list->set_size ? 2 * list->set_size : WORD_LIST_SET_SIZE;
+	while (2 * (list->size + 1) > size)
+		size *= 2;
+	const wchar_t **set = calloc(size, sizeof(wchar_t *));
+	if (set == NULL)
+		return 0;
+	STATS_ADD(allocations, 1);
+	STATS_ADD(allocated_bytes, size * sizeof(wchar_t *));
+	free(list->set);
+	list->set = set;
+	list->set_size = size;
+	for (size_t i = 0; i < list->size; i++)
+		list->set[set_slot(list, list->array[i])] = list->array[i];
+	return 1;
+}
+
+/**
+ * Kopiuje słowo do puli napisów, przydzielając w razie potrzeby nowy
+ * kawałek, dwa razy większy od poprzedniego.
+ * @param[in,out] list Lista słów.
+ * @param[in] word Słowo.
+ * @return Kopia słowa lub NULL, jeśli zabrakło pamięci.
+ */
+static wchar_t * pool_copy(struct word_list *list, const wchar_t *word)
+{
+	size_t len = wcslen(word) + 1;
+	if (list->pool == NULL || list->pool_used + len > list->pool->size)
+	{
+		size_t size = list->pool ? 2 * list->pool->size : WORD_LIST_POOL_SIZE;
+		while (size < len)
+			size *= 2;
+		size_t bytes = sizeof(struct word_pool) + size * sizeof(wchar_t);
+		struct word_pool *pool = malloc(bytes);
+		if (pool == NULL)
+			return NULL;
+		STATS_ADD(allocations, 1);
+		STATS_ADD(allocated_bytes, bytes);
+		pool->prev = list->pool;
+		pool->size = size;
+		list->pool = pool;
+		list->pool_used = 0;
+	}
+	wchar_t *copy = list->pool->text + list->pool_used;
+	wmemcpy(copy, word, len);
+	list->pool_used += len;
+	return copy;
+}
 
+/**@}*/
 /** @name Elementy interfejsu 
    @{
  */
 
 void word_list_init(struct word_list *list)
 {
-    list->size = 0;
-	list->buffer_size = STD_BUFFER_SIZE;
-	list->array = malloc(STD_BUFFER_SIZE * sizeof(wchar_t *));
+	list->size = 0;
+	list->buffer_size = 0;
+	list->array = NULL;
+	list->pool = NULL;
+	list->pool_used = 0;
+	list->set = NULL;
+	list->set_size = 0;
 }
 
 void word_list_done(struct word_list *list)
 {
-	for (int i = 0; i < list->size; i++)
-		free(list->array[i]);
+	while (list->pool != NULL)
+	{
+		struct word_pool *prev = list->pool->prev;
+		free(list->pool);
+		list->pool = prev;
+	}
 	free(list->array);
+	free(list->set);
+}
+
+void word_list_clear(struct word_list *list)
+{
+	/* Zostaje tylko ostatni, największy kawałek puli; jest on co najmniej
+	   tak duży jak wszystkie poprzednie razem, więc po kilku użyciach
+	   mieści całą zawartość listy. */
+	if (list->pool != NULL)
+	{
+		while (list->pool->prev != NULL)
+		{
+			struct word_pool *prev = list->pool->prev;
+			list->pool->prev = prev->prev;
+			free(prev);
+		}
+	}
+	list->pool_used = 0;
+	if (list->set != NULL)
+		memset(list->set, 0, list->set_size * sizeof(wchar_t *));
+	list->size = 0;
 }
 
 int word_list_add(struct word_list *list, const wchar_t *word)
 {
 	if (list->size >= list->buffer_size)
 	{
-		list->array = realloc (list->array,
-			(list->buffer_size + STD_BUFFER_SIZE) * sizeof(wchar_t *));
-		if (list->array == NULL)
+		size_t size = list->buffer_size ? 2 * list->buffer_size
+			: STD_BUFFER_SIZE;
+		wchar_t **array = realloc(list->array, size * sizeof(wchar_t *));
+		if (array == NULL)
 			return 0;
+		list->array = array;
+		list->buffer_size = size;
+		STATS_ADD(allocations, 1);
+		STATS_ADD(allocated_bytes, size * sizeof(wchar_t *));
 	}
-	size_t len = wcslen(word) + 1;
-	wchar_t *word_array = malloc(len * sizeof(wchar_t *));
-	wcscpy(word_array, word);
-	list->array[list->size] = word_array;
-	list->size++;
-    return 1;
+	if (list->set != NULL && !set_reserve(list))
+		return 0;
+	wchar_t *copy = pool_copy(list, word);
+	if (copy == NULL)
+		return 0;
+	if (list->set != NULL)
+		list->set[set_slot(list, copy)] = copy;
+	list->array[list->size++] = copy;
+	return 1;
+}
+
+int word_list_add_unique(struct word_list *list, const wchar_t *word)
+{
+	if (!set_reserve(list))
+		return -1;
+	if (list->set[set_slot(list, word)] != NULL)
+		return 0;
+	return word_list_add(list, word) ? 1 : -1;
+}
+
+bool word_list_contains(const struct word_list *list, const wchar_t *word)
+{
+	if (list->set != NULL)
+		return list->set[set_slot(list, word)] != NULL;
+	for (size_t i = 0; i < list->size; i++)
+		if (wcscmp(list->array[i], word) == 0)
+			return true;
+	return false;
+}
+
+void word_list_sort(struct word_list *list,
+                    int (*compare)(const void *, const void *))
+{
+	if (list->size > 1)
+		qsort(list->array, list->size, sizeof(wchar_t *), compare);
+}
+
+void word_list_sort_r(struct word_list *list,
+                      int (*compare)(const void *, const void *, void *),
+                      void *data)
+{
+	if (list->size > 1)
+		qsort_r(list->array, list->size, sizeof(wchar_t *), compare, data);
 }
 
 /**@}*/
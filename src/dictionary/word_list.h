@@ -1,17 +1,23 @@
 /** @file
     Interfejs listy słów.
 
+    Słowa trzymane są w puli napisów przydzielanej dużymi kawałkami,
+    a tablica słów rośnie geometrycznie. Lista może mieć zbiór
+    haszujący jej słów, tworzony przy pierwszym pytaniu o obecność słowa.
+    Wyczyszczona lista zachowuje pamięć, więc jedna lista używana
+    wielokrotnie przestaje przydzielać pamięć, gdy osiągnie potrzebny
+    rozmiar.
+
     @ingroup dictionary
     @author Jakub Pawlewicz <pan@mimuw.edu.pl>
     @copyright Uniwerstet Warszawski
     @date 2015-05-10
-    @todo Poszerzyć implementację, aby można było trzymać dowolną
-      liczbę słów.
  */
 
 #ifndef __WORD_LIST_H__
 #define __WORD_LIST_H__
 
+#include <stdbool.h>
 #include <wchar.h>
 
 /**
@@ -19,6 +25,21 @@
   */
 # define STD_BUFFER_SIZE 50
 
+/**
+  Początkowa liczba znaków w puli napisów.
+  */
+# define WORD_LIST_POOL_SIZE 1024
+
+/**
+  Początkowy rozmiar zbioru haszującego, potęga dwójki.
+  */
+# define WORD_LIST_SET_SIZE 64
+
+/**
+  Kawałek puli napisów.
+  */
+struct word_pool;
+
 /**
   Struktura przechowująca listę słów.
   */
@@ -30,10 +51,18 @@ struct word_list
     size_t buffer_size;
     /// Tablica słów.
 	wchar_t **array;
+    /// Ostatnio przydzielony kawałek puli napisów.
+    struct word_pool *pool;
+    /// Liczba zajętych znaków ostatniego kawałka puli.
+    size_t pool_used;
+    /// Zbiór haszujący słów lub NULL, jeśli nie był potrzebny.
+    const wchar_t **set;
+    /// Rozmiar zbioru haszującego, potęga dwójki.
+    size_t set_size;
 };
 
 /**
-  Inicjuje listę słów.
+  Inicjuje listę słów. Nie przydziela pamięci.
   @param[in,out] list Lista słów.
   */
 void word_list_init(struct word_list *list);
@@ -44,6 +73,13 @@ void word_list_init(struct word_list *list);
   */
 void word_list_done(struct word_list *list);
 
+/**
+  Usuwa wszystkie słowa z listy, zachowując przydzieloną pamięć
+  do ponownego użycia.
+  @param[in,out] list Lista słów.
+  */
+void word_list_clear(struct word_list *list);
+
 /**
   Dodaje słowo do listy.
   @param[in,out] list Lista słów.
@@ -52,6 +88,46 @@ void word_list_done(struct word_list *list);
   */
 int word_list_add(struct word_list *list, const wchar_t *word);
 
+/**
+  Dodaje słowo do listy, jeśli jeszcze go w niej nie ma.
+  Przy pierwszym wywołaniu tworzy zbiór haszujący słów listy, który
+  jest potem uaktualniany przy każdym dodaniu słowa.
+  @param[in,out] list Lista słów.
+  @param[in] word Dodawane słowo.
+  @return 1 jeśli słowo zostało dodane, 0 jeśli już było w liście,
+  -1 jeśli zabrakło pamięci.
+  */
+int word_list_add_unique(struct word_list *list, const wchar_t *word);
+
+/**
+  Sprawdza, czy słowo jest w liście. Jeśli lista ma zbiór haszujący,
+  działa w czasie stałym, a w p.p. przegląda całą listę.
+  @param[in] list Lista słów.
+  @param[in] word Szukane słowo.
+  @return Wartość logiczna.
+  */
+bool word_list_contains(const struct word_list *list, const wchar_t *word);
+
+/**
+  Sortuje słowa w liście.
+  @param[in,out] list Lista słów.
+  @param[in] compare Komparator dla qsort, otrzymujący wskaźniki
+  na elementy tablicy słów.
+  */
+void word_list_sort(struct word_list *list,
+                    int (*compare)(const void *, const void *));
+
+/**
+  Sortuje słowa w liście komparatorem z dodatkowym argumentem.
+  @param[in,out] list Lista słów.
+  @param[in] compare Komparator dla qsort_r, otrzymujący wskaźniki
+  na elementy tablicy słów i `data`.
+  @param[in] data Dodatkowy argument komparatora.
+  */
+void word_list_sort_r(struct word_list *list,
+                      int (*compare)(const void *, const void *, void *),
+                      void *data);
+
 /**
   Zwraca liczę słów w liście.
   @param[in] list Lista słów.